@@ -0,0 +1,30 @@
+/*
+ * affinity.c - CPU 고정 도우미
+ *
+ * CPU_SET, pthread_setaffinity_np는 _GNU_SOURCE가 필요한데,
+ * _GNU_SOURCE를 켜면 netdb.h의 gai_error와 csapp.h의 gai_error가 충돌한다.
+ * 그래서 csapp.h를 include하지 않는 파일로 따로 분리함.
+ */
+#define _GNU_SOURCE
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/*
+ * pin_to_cpu - 호출한 스레드를 cpu번 CPU에 고정 (성공 0, 실패시 에러 번호)
+ */
+int pin_to_cpu(int cpu) {
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/*
+ * online_cpus - 사용 가능한 CPU 개수 (최소 1)
+ */
+int online_cpus(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+}
@@ -0,0 +1,81 @@
+/*
+ * arena.c - 요청 하나 동안 쓰는 bump 할당기
+ *
+ * 요청을 처리하는 동안 필요한 작은 메모리(파싱한 헤더 배열, 파이프라인으로
+ * 같이 처리하는 요청들의 상태 등)를 포인터만 앞으로 밀면서 나눠주고,
+ * 요청이 끝나면 arena_reset 한 번으로 전부 돌려받는다. 하나씩 free하지 않으므로
+ * 헤더마다 malloc/free를 부를 일이 없다.
+ *
+ * 처음 블록은 호출한 쪽이 준 버퍼(request_t 안의 배열 등)라서 보통의 요청은
+ * malloc 없이 끝난다. 넘치면 ARENA_BLOCK 이상의 블록을 Malloc해서 이어 쓰고,
+ * reset할 때 그 블록들만 해제한다.
+ */
+#include "proxy.h"
+#include <stdint.h> // uintptr_t (첫 블록 주소 정렬)
+
+#define ARENA_ALIGN 16 // 나눠주는 메모리 정렬 (어떤 구조체를 담아도 되게)
+
+struct arena_block {
+  struct arena_block *next; // 먼저 만든 블록
+  size_t size;              // data 크기
+  char data[];
+};
+
+/*
+ * align_up - n을 ARENA_ALIGN의 배수로 올림
+ */
+static size_t align_up(size_t n) {
+  return (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+/*
+ * arena_init - 호출한 쪽 버퍼 buf[0..size)를 처음 블록으로 arena 준비
+ */
+void arena_init(arena_t *a, void *buf, size_t size) {
+  a->buf = buf;
+  a->size = size;
+  a->used = align_up((uintptr_t)buf) - (uintptr_t)buf; // 첫 주소 정렬
+  if (a->used > size)
+    a->used = size;
+  a->first = buf;
+  a->first_size = size;
+  a->blocks = NULL;
+}
+
+/*
+ * arena_alloc - n바이트 할당 (다음 arena_reset까지 유효)
+ *   지금 블록에 안 들어가면 ARENA_BLOCK(더 크게 달라면 그만큼) 블록을 새로 Malloc
+ */
+void *arena_alloc(arena_t *a, size_t n) {
+  struct arena_block *b;
+  size_t size;
+  void *p;
+
+  n = align_up(n);
+  if (a->size - a->used < n) { // 지금 블록에 안 들어감: 새 블록으로 (남은 자리는 버림)
+    size = n > ARENA_BLOCK ? n : ARENA_BLOCK;
+    b = Malloc(sizeof(struct arena_block) + size);
+    b->next = a->blocks;
+    b->size = size;
+    a->blocks = b;
+    a->buf = b->data;
+    a->size = size;
+    a->used = 0;
+  }
+  p = a->buf + a->used;
+  a->used += n;
+  return p;
+}
+
+/*
+ * arena_reset - 지금까지 나눠준 것을 한꺼번에 돌려받기 (넘친 블록은 해제, 처음 블록은 다시 씀)
+ */
+void arena_reset(arena_t *a) {
+  struct arena_block *b;
+
+  while ((b = a->blocks) != NULL) {
+    a->blocks = b->next;
+    Free(b);
+  }
+  arena_init(a, a->first, a->first_size);
+}
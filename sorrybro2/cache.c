@@ -0,0 +1,1408 @@
+/*
+ * cache.c - 공유 메모리 웹 객체 캐시 (샤드로 나눔, 읽기는 잠금 없이)
+ *
+ * 캐시 전체(잠금, 항목 표, 슬랩 페이지들)가 mmap(MAP_SHARED|MAP_ANONYMOUS)
+ * 한 덩어리 안에 있다. fork 전에 만들면 prefork 자식들이 주소까지 같은
+ * 영역을 보므로, 프로세스마다 따로 식은 캐시를 갖는 대신 적중률 하나를 공유한다.
+ * 스레드 모드에서도 같은 코드가 그대로 쓰인다.
+ *
+ * 키(URL) 해시의 아래 CACHE_SHARD_BITS 비트로 고른 샤드 2^k개로 나눈다.
+ * 샤드마다 쓰는 쪽 잠금, 해시 버킷, 정책 큐, 예산(budget)이 따로 있다.
+ *
+ * 읽는 쪽(cache_pin)은 잠그지도, 공유 카운터를 고치지도, 다시 읽지도 않는다 (RCU 방식).
+ * 쓰는 쪽은 항목과 chunk를 다 채운 뒤에 버킷에 release로 걸고, 내보낼 때는 버킷에서
+ * 떼어내기만 하고(retire) 항목과 chunk는 그대로 둔다. 그래서 읽는 쪽이 떼어낸 항목을
+ * 보고 있어도 그 내용은 멀쩡하다. 떼어낸 것을 실제로 돌려받는 것(reclaim)은
+ * 두 조건이 다 맞을 때다.
+ *   - epoch: 읽는 쪽은 찾는 동안 자기 슬롯에 전역 epoch를 적어 둔다. 떼어낸 뒤에
+ *     epoch를 올리고, 그 전 epoch로 들어와 있던 읽는 쪽이 다 나가야 돌려받는다.
+ *   - refcount: 적중하면 항목을 고정(pin)하고, 호출한 쪽은 캐시 chunk에서 소켓으로
+ *     바로 보낸 뒤에 푼다(unpin). 고정이 남아 있으면 돌려받지 않는다.
+ * 읽다가 프로세스가 죽어서 epoch 슬롯이 남으면 쓰는 쪽이 그 스레드가 없어진 것을
+ * 확인하고 치운다. (죽은 프로세스가 고정한 채로 남긴 객체는 돌려받지 못한다.)
+ *
+ * 쓰는 쪽(cache_put)은 샤드의 PTHREAD_PROCESS_SHARED + ROBUST mutex로 서로 막는다.
+ * 잠금을 쥔 채로 죽으면 다음에 잠그는 쪽이 그 샤드의 항목을 전부 떼어내고,
+ * 어느 항목에도 안 걸린 chunk(넣다 만 객체)는 바로 돌려받는다.
+ *
+ * 객체는 [url\0][객체]를 슬랩 할당기의 chunk들에 이어서 담는다. 객체마다 malloc하지
+ * 않고, 캐시를 만들 때 한 번 잡아 둔 arena(가능하면 huge page)를 CACHE_SLAB 크기
+ * 페이지로 나눠 쓴다. 페이지 하나는 크기 등급(class) 하나의 chunk들로 나뉜다.
+ * 큰 객체는 페이지 하나짜리 chunk 여러 개에 담고 남는 꼬리만 맞는 등급의 chunk에
+ * 담아서, 100KB 객체도 iovec 몇 개로 보낸다. 크기 분포가 바뀌면 다 빈 페이지를 다른
+ * 등급으로 옮기고, 바이트는 남는데 맞는 chunk가 없으면(조각남) 가장 적게 쓴 페이지의
+ * 객체들을 내보내서 그 페이지를 비운다 (draining). 페이지와 chunk는 모든 샤드가 같이
+ * 쓰고 (전역 잠금, 쓰는 쪽만) chunk마다 주인 항목을 적어 둔다. arena 크기는 예산에
+ * 등급마다의 자투리 몫만 더한 것이라 RSS가 예산 근처에서 멈춘다.
+ *
+ * 전역 계층은 MAX_CACHE_SIZE를 샤드들의 예산으로 나눈다. 예산은 상한이 아니라
+ * 몫이어서, 전체에 자리가 있으면 어느 샤드든 예산을 넘어 채울 수 있고, 자리가
+ * 모자랄 때만 예산을 가장 많이 넘은 샤드가 내놓는다. CACHE_REBALANCE번 넣을
+ * 때마다 최근에 넣은 바이트에 비례해서 예산을 다시 나눈다 (최소 몫은 보장).
+ *
+ * 무엇을 내보낼지는 시작할 때 고른 정책(policy_t)이 정한다 (-e 옵션).
+ *   lru      마지막으로 읽은 시각이 가장 오래된 것 (내보낼 때 샤드를 훑어서 고름)
+ *   clock    FIFO를 돌면서 참조 비트가 켜진 것은 끄고 한 번 더 기회 (second chance)
+ *   s3fifo   작은 FIFO(10%)에 넣고 두 번 이상 읽힌 것만 큰 FIFO로, 작은 FIFO에서
+ *            나간 것의 해시는 ghost에 남겨서 곧 다시 오면 바로 큰 FIFO로
+ *   tinylfu  W-TinyLFU: 창(1%) LRU에서 밀려난 후보와 본 영역(probation/protected
+ *            SLRU)의 꼬리 중에서 count-min sketch로 센 빈도가 낮은 쪽을 내보냄
+ *   gdsf     크기까지 보는 GreedyDual-Size-Frequency: L + 빈도 / 크기가 가장 작은 것
+ * 정책은 샤드마다 큐 NQUEUES개를 쓴다 (잠근 상태에서만 고침). 읽는 쪽은 큐를
+ * 건드리지 않고 항목의 시각, 빈도 등만 잠그지 않고 적는다 (policy_t.lookup).
+ *
+ * 적중률과 바이트 적중률은 읽는 스레드마다 자기 epoch 슬롯(자기 캐시 라인)에
+ * 세고, 미스로 원서버에서 받아온 바이트는 cache_put에서 샤드마다 센다.
+ *
+ * 키는 호출한 쪽이 정규화한 URL이다 (parser.c의 http_cache_key).
+ */
+#include "cache.h"
+#include <limits.h>      // LONG_MIN, ULONG_MAX, UCHAR_MAX
+#include <sys/syscall.h> // SYS_gettid (epoch 슬롯 주인)
+
+#define CACHE_SHARDS (1 << CACHE_SHARD_BITS)
+#define SHARD_ENTRIES 128   // 샤드 하나의 최대 객체 수 (떼어냈지만 아직 못 돌려받은 것 포함)
+#define SHARD_BUCKETS 64    // 샤드 하나의 해시 버킷 수 (2의 거듭제곱)
+#define SLAB_CLASSES 14     // chunk 크기 등급 수 (slab_size 표)
+#define SLAB_MAX_CHUNKS 128 // 페이지 하나의 최대 chunk 수 (가장 작은 등급)
+#define SLAB_PAGES (MAX_CACHE_SIZE / CACHE_SLAB * 5 / 4 + SLAB_CLASSES) // 꼬리 chunk의 자투리와 등급마다 덜 찬 페이지 몫까지
+#define HUGE_PAGE (2 << 20) // arena를 이 크기로 올려 잡음 (x86-64 huge page)
+#define CACHE_REBALANCE 64  // 이만큼 넣을 때마다 샤드 예산 다시 나누기
+#define SHARD_MIN_BUDGET (MAX_CACHE_SIZE / CACHE_SHARDS / 4) // 예산을 다시 나눠도 남기는 최소 몫
+#define EPOCH_SLOTS 1024    // 동시에 캐시를 읽을 수 있는 스레드 수 (프로세스 전체)
+#define NIL (-1)            // 없는 항목/chunk/페이지 번호
+#define NQUEUES 3           // 정책이 쓰는 샤드마다의 큐 수
+#define GHOST_SIZE SHARD_ENTRIES // S3-FIFO ghost (작은 FIFO에서 나간 것의 해시) 수
+#define CMS_DEPTH 4         // W-TinyLFU count-min sketch 줄 수
+#define CMS_BITS 9          // 줄마다의 카운터 수 (2^CMS_BITS)
+#define CMS_MAX 15          // 카운터 상한
+#define CMS_RESET SHARD_ENTRIES // 이만큼 넣을 때마다 카운터를 전부 반으로 (오래된 빈도 잊기)
+#define GDSF_SCALE (1UL << 20) // GDSF 우선순위 = L + 빈도 * GDSF_SCALE / 크기 (정수로)
+
+/* 항목 상태 */
+enum {
+  E_FREE,    // 빈 항목
+  E_LIVE,    // 버킷에 걸려 있음 (찾을 수 있음)
+  E_RETIRED  // 떼어냄: epoch가 지나고 고정이 풀리면 돌려받음
+};
+
+/* 캐시 항목 하나 (cache_pin이 고정해서 돌려주는 것) */
+struct cobj {
+  int state;           // E_FREE, E_LIVE, E_RETIRED
+  unsigned int hash;   // url 해시 (비교 전에 빠르게 거르기)
+  int chunk;           // 첫 chunk ([url\0][객체] 시작)
+  size_t keylen;       // url 길이 ('\0' 포함)
+  size_t size;         // 객체 크기
+  int refs;            // 고정(pin) 수 (atomic, 읽는 쪽이 올리고 내림)
+  unsigned long stamp; // 마지막으로 읽은 시각 (밀리초, 읽는 쪽이 잠그지 않고 적음, lru)
+  unsigned long lval;  // 마지막으로 읽혔을 때 샤드의 L (gdsf, 읽는 쪽이 잠그지 않고 적음)
+  unsigned char freq;  // 읽힌 횟수 (정책마다 상한이 다름, 읽는 쪽이 잠그지 않고 올림)
+  unsigned char q;     // 들어 있는 정책 큐
+  unsigned long retired; // 떼어낼 때의 epoch (이 epoch 이하로 들어온 읽는 쪽이 다 나가야 함)
+  int hnext;           // 같은 버킷의 다음 항목 (떼어낸 뒤에도 그대로 둬서 읽는 쪽이 계속 따라감)
+  int prev, next;      // 정책 큐 (prev가 머리 쪽), 떼어낸 것은 next로 retired 리스트
+};
+typedef struct cobj centry_t;
+
+/* 정책 큐 하나 (head에 넣고 tail에서 꺼냄) */
+typedef struct {
+  int head, tail;
+  size_t bytes;             // 들어 있는 객체 바이트 합
+} queue_t;
+
+/* 샤드 하나 (샤드끼리 같은 캐시 라인을 쓰지 않도록 정렬) */
+typedef struct {
+  pthread_mutex_t lock;     // 이 샤드에 쓰는 쪽끼리 막는 프로세스 공유 robust mutex
+  size_t used;              // 이 샤드 객체들의 바이트 ([url\0][객체] 합, 못 돌려받은 것 포함)
+  size_t budget;            // 이 샤드의 몫 (자리가 모자랄 때 이보다 많이 쓴 샤드가 내놓음)
+  size_t inserted;          // 최근에 넣은 바이트 (예산을 나눌 때 수요로 씀, 나눌 때마다 반으로, atomic)
+  int live;                 // 큐에 든 (내보낼 수 있는) 항목 수
+  queue_t q[NQUEUES];       // 정책 큐 (정책마다 쓰는 뜻이 다름)
+  int retired;              // 떼어낸 항목 리스트
+  unsigned long gdsf_l;     // GDSF 물가(inflation) L: 마지막으로 내보낸 것의 우선순위
+  unsigned int ghost[GHOST_SIZE]; // S3-FIFO ghost (링 버퍼, 0은 빈 칸)
+  int ghost_pos;
+  int cms_puts;             // 지난번에 sketch를 반으로 줄인 뒤에 넣은 수
+  unsigned char cms[CMS_DEPTH][1 << CMS_BITS]; // W-TinyLFU count-min sketch (읽는 쪽도 잠그지 않고 올림)
+  unsigned long misses;     // 원서버에서 받아와 넣으려 한 객체 수
+  unsigned long miss_bytes; // 그 바이트 합
+  unsigned long evictions;  // 내보낸 객체 수
+  int buckets[SHARD_BUCKETS];
+  centry_t entries[SHARD_ENTRIES];
+} __attribute__((aligned(64))) shard_t;
+
+/* 읽는 스레드 하나의 epoch 슬롯 (슬롯끼리 같은 캐시 라인을 쓰지 않도록 정렬) */
+typedef struct {
+  int tid;                  // 주인 스레드 (0이면 빈 슬롯)
+  unsigned long epoch;      // 찾는 중이면 들어올 때의 전역 epoch, 아니면 0
+  unsigned long lookups;    // 찾은 횟수 (주인 스레드만 올림)
+  unsigned long hits;       // 적중 횟수
+  unsigned long hit_bytes;  // 적중한 객체 바이트 합
+} __attribute__((aligned(64))) eslot_t;
+
+/* 내보내기 정책 (cache_init에서 하나 고름) */
+typedef struct {
+  char *name;
+  void (*insert)(shard_t *s, centry_t *e);  // 새 항목을 큐에 넣기 (잠근 상태)
+  void (*lookup)(shard_t *s, unsigned int h, centry_t *e); // 찾은 뒤 (e는 고정한 항목, 미스면 NULL, 잠그지 않음)
+  centry_t *(*victim)(shard_t *s);          // 내보낼 항목을 골라 큐에서 빼기 (잠근 상태, 없으면 NULL)
+} policy_t;
+
+/* 슬랩 페이지 하나 */
+typedef struct {
+  signed char cls;            // 크기 등급 (-1이면 빈 페이지)
+  signed char last;           // 빈 페이지가 되기 전의 등급 (옮긴 횟수 세기, 처음엔 -1)
+  char draining;              // 비우는 중 (새 chunk를 내주지 않음)
+  short used;                 // 쓰는 chunk 수
+  int free;                   // 빈 chunk 리스트 (cnext로 이어짐)
+} spage_t;
+
+/* 공유 메모리에 올라가는 캐시 전체 (arena 하나) */
+typedef struct {
+  pthread_mutex_t lock;       // 슬랩 페이지와 전체 사용량 (쓰는 쪽만, 샤드 잠금 다음에 잡음)
+  size_t used;                // 전체 객체 바이트 (MAX_CACHE_SIZE 이하)
+  int free_pages;             // 빈 페이지 수
+  unsigned long moves;        // 다른 등급으로 옮긴 페이지 수
+  unsigned long drains;       // 조각나서 비우기 시작한 페이지 수
+  unsigned long puts;         // 넣은 횟수 (CACHE_REBALANCE마다 예산 다시 나누기)
+  unsigned long epoch;        // 전역 epoch (1부터, 떼어낼 때마다 증가)
+  shard_t shards[CACHE_SHARDS];
+  eslot_t slots[EPOCH_SLOTS];
+  spage_t pages[SLAB_PAGES];
+  unsigned short cowner[SLAB_PAGES * SLAB_MAX_CHUNKS]; // chunk 주인 항목 (샤드 * SHARD_ENTRIES + 항목 + 1, 0이면 빈 chunk)
+  int cnext[SLAB_PAGES * SLAB_MAX_CHUNKS];             // 객체 안에서 (빈 chunk는 페이지의 빈 리스트에서) 다음 chunk
+  char data[SLAB_PAGES][CACHE_SLAB] __attribute__((aligned(4096)));
+} cache_t;
+
+/* 등급마다의 chunk 크기 (CACHE_SLAB을 n등분해서 64바이트로 내림, 대략 1.5배씩) */
+static const int slab_size[SLAB_CLASSES] = {
+  128, 192, 256, 384, 512, 768, 1024, 1600, 2048, 3264, 4096, 5440, 8192, CACHE_SLAB
+};
+
+static cache_t *cache;
+static policy_t *policy; // 내보내기 정책 (fork 전에 정해서 자식도 같음)
+static char *backing;    // arena를 받친 페이지 종류 (통계 출력용)
+static __thread int my_slot = NIL; // 이 스레드의 epoch 슬롯 (fork한 자식은 다시 얻음)
+static __thread int my_tid;
+
+/*
+ * hash_url - url 문자열 해시 (FNV-1a)
+ */
+static unsigned int hash_url(char *url) {
+  unsigned int h = 2166136261u;
+  while (*url)
+    h = (h ^ (unsigned char)*url++) * 16777619u;
+  return h;
+}
+
+/*
+ * now_ms - LRU용 거친 시각 (밀리초, vDSO라 syscall 없음)
+ */
+static unsigned long now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000;
+}
+
+/*
+ * shard_of - url 해시로 샤드 고르기 (버킷은 위쪽 비트로 골라서 서로 겹치지 않게)
+ */
+static shard_t *shard_of(unsigned int h) {
+  return &cache->shards[h & (CACHE_SHARDS - 1)];
+}
+
+/*
+ * bucket_of - 샤드 안에서의 버킷
+ */
+static int *bucket_of(shard_t *s, unsigned int h) {
+  return &s->buckets[(h >> CACHE_SHARD_BITS) & (SHARD_BUCKETS - 1)];
+}
+
+/*
+ * tid_dead - 스레드 tid가 없어졌는지 (읽다가 죽은 프로세스의 슬롯 치우기)
+ */
+static int tid_dead(int tid) {
+  return kill(tid, 0) < 0 && errno == ESRCH;
+}
+
+/*
+ * slot_get - 이 스레드의 epoch 슬롯 (처음이면 빈 슬롯이나 죽은 스레드의 슬롯을 얻음)
+ *   반환: 슬롯, 모자라면 NULL (그 요청은 캐시 미스로)
+ */
+static eslot_t *slot_get(void) {
+  int i, tid, dead;
+
+  if (my_slot != NIL)
+    return &cache->slots[my_slot];
+  my_tid = syscall(SYS_gettid);
+  for (dead = 0; dead < 2; dead++) // 빈 슬롯부터, 없으면 주인이 없어진 슬롯
+    for (i = 0; i < EPOCH_SLOTS; i++) {
+      tid = __atomic_load_n(&cache->slots[i].tid, __ATOMIC_RELAXED);
+      if ((dead ? tid != 0 && tid_dead(tid) : tid == 0) &&
+          __atomic_compare_exchange_n(&cache->slots[i].tid, &tid, my_tid, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&cache->slots[i].epoch, 0, __ATOMIC_RELEASE);
+        my_slot = i;
+        return &cache->slots[i];
+      }
+    }
+  return NULL;
+}
+
+/*
+ * after_fork - fork한 자식은 부모 스레드의 슬롯을 물려받으므로 새로 얻게
+ */
+static void after_fork(void) {
+  my_slot = NIL;
+}
+
+/*
+ * epoch_enter - 찾기 시작 (슬롯에 적은 뒤 전역 epoch가 그대로인지 확인)
+ *   적기 전에 쓰는 쪽이 슬롯들을 훑고 지나갔으면 epoch가 올라 있으므로 다시 적는다.
+ *   그러고 나면 슬롯의 epoch보다 나중에 떼어낸 항목만 볼 수 있다.
+ */
+static void epoch_enter(eslot_t *slot) {
+  unsigned long e;
+
+  do {
+    e = __atomic_load_n(&cache->epoch, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&slot->epoch, e, __ATOMIC_SEQ_CST);
+  } while (__atomic_load_n(&cache->epoch, __ATOMIC_SEQ_CST) != e);
+}
+
+static void epoch_exit(eslot_t *slot) {
+  __atomic_store_n(&slot->epoch, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * epoch_min - 찾는 중인 읽는 쪽들의 가장 오래된 epoch (없으면 ULONG_MAX)
+ *   주인 스레드가 없어진 슬롯은 치움
+ */
+static unsigned long epoch_min(void) {
+  unsigned long min = ULONG_MAX, e;
+  eslot_t *slot;
+  int tid;
+
+  __atomic_thread_fence(__ATOMIC_SEQ_CST); // 떼어낸 것이 슬롯 읽기보다 먼저 보이게
+  for (slot = cache->slots; slot < cache->slots + EPOCH_SLOTS; slot++) {
+    if ((e = __atomic_load_n(&slot->epoch, __ATOMIC_SEQ_CST)) == 0 || e >= min)
+      continue;
+    tid = __atomic_load_n(&slot->tid, __ATOMIC_RELAXED);
+    if (tid != 0 && tid_dead(tid)) { // 찾다가 죽음
+      __atomic_store_n(&slot->epoch, 0, __ATOMIC_RELEASE);
+      __atomic_compare_exchange_n(&slot->tid, &tid, 0, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+      continue;
+    }
+    min = e;
+  }
+  return min;
+}
+
+/*
+ * queues_reset - 정책 큐들을 비우기 (항목은 그대로)
+ */
+static void queues_reset(shard_t *s) {
+  int i;
+
+  for (i = 0; i < NQUEUES; i++) {
+    s->q[i].head = s->q[i].tail = NIL;
+    s->q[i].bytes = 0;
+  }
+  s->live = 0;
+}
+
+/*
+ * shard_reset - 샤드를 빈 상태로 (항목, 버킷, 정책 큐)
+ */
+static void shard_reset(shard_t *s) {
+  int i;
+
+  memset(s->entries, 0, sizeof(s->entries));
+  for (i = 0; i < SHARD_BUCKETS; i++)
+    s->buckets[i] = NIL;
+  queues_reset(s);
+  s->retired = NIL;
+  s->used = 0;
+}
+
+/*
+ * slab_recount - 슬랩 페이지 상태를 chunk 주인 표로 다시 만들기 (전역 잠금을 쥔 채로 죽은 뒤)
+ *   빈 chunk 리스트와 쓰는 chunk 수는 고치다 만 상태일 수 있으므로 주인 표만 믿는다.
+ */
+static void slab_recount(void) {
+  spage_t *pg;
+  int p, i, id;
+
+  for (cache->free_pages = p = 0; p < SLAB_PAGES; p++) {
+    pg = &cache->pages[p];
+    pg->used = 0;
+    pg->free = NIL;
+    if (pg->cls < 0) {
+      cache->free_pages++;
+      continue;
+    }
+    for (i = CACHE_SLAB / slab_size[pg->cls] - 1; i >= 0; i--) {
+      id = p * SLAB_MAX_CHUNKS + i;
+      if (cache->cowner[id])
+        pg->used++;
+      else {
+        cache->cnext[id] = pg->free;
+        pg->free = id;
+      }
+    }
+    if (pg->used == 0) {
+      pg->last = pg->cls;
+      pg->cls = -1;
+      pg->draining = 0;
+      cache->free_pages++;
+    }
+  }
+}
+
+/*
+ * global_lock - 슬랩 잠그기 (쥔 프로세스가 죽었으면 페이지 상태를 주인 표로 다시 만듦)
+ */
+static void global_lock(void) {
+  int rc = pthread_mutex_lock(&cache->lock);
+
+  if (rc == EOWNERDEAD) {
+    fprintf(stderr, "cache: slab owner died, recounting pages\n");
+    slab_recount();
+    pthread_mutex_consistent(&cache->lock);
+  }
+  else if (rc != 0)
+    posix_error(rc, "pthread_mutex_lock error");
+}
+
+static void global_unlock(void) {
+  pthread_mutex_unlock(&cache->lock);
+}
+
+/*
+ * chunk_size, chunk_ptr - chunk 번호 id의 크기 / 주소
+ *   페이지 등급은 그 페이지가 다 빈 뒤에만 바뀌므로, 고정한 객체의 chunk는 잠그지 않고 봐도 된다
+ */
+static size_t chunk_size(int id) {
+  return slab_size[cache->pages[id / SLAB_MAX_CHUNKS].cls];
+}
+
+static char *chunk_ptr(int id) {
+  return cache->data[id / SLAB_MAX_CHUNKS] + (size_t)(id % SLAB_MAX_CHUNKS) * chunk_size(id);
+}
+
+/*
+ * size_class - n 바이트가 들어가는 가장 작은 등급
+ */
+static int size_class(size_t n) {
+  int c;
+
+  for (c = 0; c < SLAB_CLASSES - 1 && slab_size[c] < n; c++)
+    ;
+  return c;
+}
+
+/*
+ * page_take - 빈 페이지 하나를 등급 c로 (전역 잠금 상태에서)
+ *   반환: 페이지 번호, 빈 페이지가 없으면 NIL
+ */
+static int page_take(int c) {
+  spage_t *pg;
+  int p, i;
+
+  for (p = 0; p < SLAB_PAGES && cache->pages[p].cls >= 0; p++)
+    ;
+  if (p == SLAB_PAGES)
+    return NIL;
+  pg = &cache->pages[p];
+  if (pg->last >= 0 && pg->last != c) // 크기 분포가 바뀌어서 다른 등급으로 감
+    cache->moves++;
+  pg->cls = c;
+  pg->draining = 0;
+  pg->used = 0;
+  pg->free = NIL;
+  for (i = CACHE_SLAB / slab_size[c] - 1; i >= 0; i--) {
+    cache->cnext[p * SLAB_MAX_CHUNKS + i] = pg->free;
+    pg->free = p * SLAB_MAX_CHUNKS + i;
+  }
+  cache->free_pages--;
+  return p;
+}
+
+/*
+ * chunk_alloc - 등급 c의 chunk 하나 빌리기 (전역 잠금 상태, slab_fits로 확인한 뒤)
+ *   이미 그 등급인 페이지의 빈 chunk부터, 없으면 빈 페이지를 가져옴
+ */
+static int chunk_alloc(int c, unsigned short owner) {
+  spage_t *pg;
+  int p, id;
+
+  for (p = 0; p < SLAB_PAGES; p++) {
+    pg = &cache->pages[p];
+    if (pg->cls == c && !pg->draining && pg->free != NIL)
+      break;
+  }
+  if (p == SLAB_PAGES && (p = page_take(c)) == NIL)
+    return NIL;
+  pg = &cache->pages[p];
+  id = pg->free;
+  pg->free = cache->cnext[id];
+  pg->used++;
+  cache->cowner[id] = owner;
+  cache->cnext[id] = NIL;
+  return id;
+}
+
+/*
+ * chunk_free - chunk 하나를 페이지에 돌려주기 (전역 잠금 상태에서), 페이지가 다 비면 빈 페이지로
+ */
+static void chunk_free(int id) {
+  spage_t *pg = &cache->pages[id / SLAB_MAX_CHUNKS];
+
+  cache->cowner[id] = 0;
+  cache->cnext[id] = pg->free;
+  pg->free = id;
+  if (--pg->used == 0) {
+    pg->last = pg->cls;
+    pg->cls = -1;
+    pg->draining = 0;
+    cache->free_pages++;
+  }
+}
+
+/*
+ * class_free - 등급 c에서 바로 빌릴 수 있는 chunk 수 (비우는 중인 페이지는 빼고)
+ */
+static int class_free(int c) {
+  spage_t *pg;
+  int n = 0;
+
+  for (pg = cache->pages; pg < cache->pages + SLAB_PAGES; pg++)
+    if (pg->cls == c && !pg->draining)
+      n += CACHE_SLAB / slab_size[c] - pg->used;
+  return n;
+}
+
+/*
+ * slab_fits - need 바이트 객체의 chunk들을 지금 빌릴 수 있는지 (전역 잠금 상태에서)
+ *   페이지 하나짜리 chunk need / CACHE_SLAB개와 꼬리 chunk 하나
+ */
+static int slab_fits(size_t need) {
+  int top = SLAB_CLASSES - 1, full = need / CACHE_SLAB, tail = NIL, pages;
+
+  if (need % CACHE_SLAB)
+    tail = size_class(need % CACHE_SLAB);
+  if (tail == top) {
+    full++;
+    tail = NIL;
+  }
+  pages = full - class_free(top);
+  if (pages < 0)
+    pages = 0;
+  if (tail != NIL && class_free(tail) == 0)
+    pages++;
+  return pages <= cache->free_pages;
+}
+
+/*
+ * chain_alloc - need 바이트 객체의 chunk들을 이어서 빌리기 (전역 잠금 상태, slab_fits로 확인한 뒤)
+ *   페이지 하나짜리 chunk들 다음에 꼬리를 맞는 등급 chunk 하나에
+ *   반환: 첫 chunk
+ */
+static int chain_alloc(size_t need, unsigned short owner) {
+  int first = NIL, last = NIL, id;
+  size_t k;
+
+  for (; need > 0; need -= k) {
+    k = need < CACHE_SLAB ? need : CACHE_SLAB;
+    id = chunk_alloc(size_class(k), owner);
+    if (last == NIL)
+      first = id;
+    else
+      cache->cnext[last] = id;
+    last = id;
+  }
+  return first;
+}
+
+/*
+ * chain_free - chunk id부터 이어진 객체의 chunk들을 돌려주기 (전역 잠금 상태에서)
+ */
+static void chain_free(int id) {
+  int next;
+
+  for (; id != NIL; id = next) {
+    next = cache->cnext[id];
+    chunk_free(id);
+  }
+}
+
+/*
+ * owner_of - 항목 e의 chunk 주인 번호 (샤드 * SHARD_ENTRIES + 항목 + 1)
+ */
+static unsigned short owner_of(shard_t *s, centry_t *e) {
+  return (s - cache->shards) * SHARD_ENTRIES + (e - s->entries) + 1;
+}
+
+/*
+ * retire - 항목을 떼어낸 것으로 표시하고 retired 리스트에 넣기 (버킷, 정책 큐에서는 이미 뺀 상태)
+ */
+static void retire(shard_t *s, centry_t *e) {
+  e->retired = __atomic_fetch_add(&cache->epoch, 1, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&e->state, E_RETIRED, __ATOMIC_RELAXED);
+  e->next = s->retired;
+  s->retired = e - s->entries;
+}
+
+/*
+ * shard_clear - 잠금을 쥔 채로 죽은 프로세스가 남긴 샤드 복구 (잠근 상태에서)
+ *   리스트들은 고치다 만 상태일 수 있으므로 항목 표만 보고 살아있는 항목을 다 떼어내고
+ *   (읽는 쪽이 보고 있을 수 있어서 바로 돌려받지는 않음) 버킷과 정책 큐를 비운다.
+ *   이 샤드의 빈 항목 앞으로 적힌 chunk(넣다 만 객체)는 바로 돌려준다.
+ */
+static void shard_clear(shard_t *s) {
+  unsigned short base = (s - cache->shards) * SHARD_ENTRIES, o;
+  size_t used = 0;
+  centry_t *e;
+  int i;
+
+  for (i = 0; i < SHARD_BUCKETS; i++)
+    __atomic_store_n(&s->buckets[i], NIL, __ATOMIC_RELEASE);
+  queues_reset(s);
+  s->retired = NIL;
+  for (e = s->entries; e < s->entries + SHARD_ENTRIES; e++) {
+    if (e->state == E_FREE)
+      continue;
+    if (e->state == E_LIVE)
+      retire(s, e);
+    else {
+      e->next = s->retired;
+      s->retired = e - s->entries;
+    }
+    used += e->keylen + e->size;
+  }
+  global_lock();
+  for (i = 0; i < SLAB_PAGES * SLAB_MAX_CHUNKS; i++)
+    if ((o = cache->cowner[i]) > base && o <= base + SHARD_ENTRIES && s->entries[o - base - 1].state == E_FREE)
+      chunk_free(i);
+  if (s->used > used) // 넣다 만 객체 몫
+    cache->used -= s->used - used < cache->used ? s->used - used : cache->used;
+  global_unlock();
+  s->used = used;
+}
+
+/*
+ * shard_lock - 샤드 잠그기 (잠금을 쥔 프로세스가 죽었으면 그 샤드를 비우고 복구)
+ *   try: 1이면 다른 샤드가 잡고 있을 때 기다리지 않음
+ *   반환: 잠갔으면 0, try인데 못 잠갔으면 -1
+ */
+static int shard_lock(shard_t *s, int try) {
+  int rc = try ? pthread_mutex_trylock(&s->lock) : pthread_mutex_lock(&s->lock);
+
+  if (rc == EBUSY)
+    return -1;
+  if (rc == EOWNERDEAD) {
+    fprintf(stderr, "cache: shard %d lock owner died, clearing shard\n", (int)(s - cache->shards));
+    shard_clear(s);
+    pthread_mutex_consistent(&s->lock);
+  }
+  else if (rc != 0)
+    posix_error(rc, "pthread_mutex_lock error");
+  return 0;
+}
+
+static void shard_unlock(shard_t *s) {
+  pthread_mutex_unlock(&s->lock);
+}
+
+/*
+ * chain_seek - chunk b부터 이어진 객체에서 *off 바이트째가 있는 chunk (*off는 그 chunk 안의 위치로)
+ */
+static int chain_seek(int b, size_t *off) {
+  for (; b != NIL && *off >= chunk_size(b); b = cache->cnext[b])
+    *off -= chunk_size(b);
+  return b;
+}
+
+/*
+ * chain_write - src[0..n)를 chunk b부터 이어진 객체의 off 바이트 뒤에 쓰기 (잠근 상태에서)
+ */
+static void chain_write(int b, size_t off, char *src, size_t n) {
+  size_t k;
+
+  for (b = chain_seek(b, &off); n > 0; b = cache->cnext[b], off = 0) {
+    k = chunk_size(b) - off < n ? chunk_size(b) - off : n;
+    memcpy(chunk_ptr(b) + off, src, k);
+    src += k;
+    n -= k;
+  }
+}
+
+/*
+ * key_eq - 항목 e의 키가 url인지 (keylen은 '\0' 포함, chunk 경계에 걸쳐도 됨)
+ *   찾는 중(epoch 안)이라 e와 그 chunk들은 돌려받지 않으므로 그대로 읽어도 된다
+ */
+static int key_eq(centry_t *e, char *url, size_t keylen) {
+  size_t off, k;
+  int b;
+
+  for (b = e->chunk, off = 0; off < keylen; off += k, b = cache->cnext[b]) {
+    k = keylen - off < chunk_size(b) ? keylen - off : chunk_size(b);
+    if (memcmp(chunk_ptr(b), url + off, k))
+      return 0;
+  }
+  return 1;
+}
+
+/*
+ * find - 샤드 s에서 url 항목 찾기 (쓰는 쪽은 잠근 상태에서, 읽는 쪽은 epoch 안에서)
+ *   버킷과 hnext는 항목을 다 채운 뒤에 release로 걸리므로 acquire로 따라가면
+ *   걸린 항목의 내용은 다 보인다. 떼어낸 항목을 지나가도 hnext가 그대로라 계속 간다.
+ */
+static centry_t *find(shard_t *s, char *url, size_t keylen, unsigned int h) {
+  centry_t *e;
+  int i;
+
+  for (i = __atomic_load_n(bucket_of(s, h), __ATOMIC_ACQUIRE); i != NIL;
+       i = __atomic_load_n(&e->hnext, __ATOMIC_ACQUIRE)) {
+    e = &s->entries[i];
+    if (e->hash == h && e->keylen == keylen && __atomic_load_n(&e->state, __ATOMIC_RELAXED) == E_LIVE &&
+        key_eq(e, url, keylen))
+      return e;
+  }
+  return NULL;
+}
+
+/*
+ * q_unlink, q_push - 항목을 정책 큐에서 빼기 / 큐 qi의 머리에 넣기 (잠근 상태에서)
+ */
+static void q_unlink(shard_t *s, centry_t *e) {
+  queue_t *q = &s->q[e->q];
+
+  if (e->prev != NIL)
+    s->entries[e->prev].next = e->next;
+  else
+    q->head = e->next;
+  if (e->next != NIL)
+    s->entries[e->next].prev = e->prev;
+  else
+    q->tail = e->prev;
+  q->bytes -= e->keylen + e->size;
+  s->live--;
+}
+
+static void q_push(shard_t *s, centry_t *e, int qi) {
+  queue_t *q = &s->q[qi];
+  int i = e - s->entries;
+
+  e->q = qi;
+  e->prev = NIL;
+  e->next = q->head;
+  if (q->head != NIL)
+    s->entries[q->head].prev = i;
+  else
+    q->tail = i;
+  q->head = i;
+  q->bytes += e->keylen + e->size;
+  s->live++;
+}
+
+/*
+ * q_move - 항목을 큐 qi의 머리로 옮기기 (같은 큐여도 됨)
+ */
+static void q_move(shard_t *s, centry_t *e, int qi) {
+  q_unlink(s, e);
+  q_push(s, e, qi);
+}
+
+/*
+ * q_tail - 큐 qi의 꼬리 항목 (비었으면 NULL)
+ */
+static centry_t *q_tail(shard_t *s, int qi) {
+  return s->q[qi].tail == NIL ? NULL : &s->entries[s->q[qi].tail];
+}
+
+/*
+ * freq_get, freq_set, freq_bump - 읽는 쪽과 같이 쓰는 빈도 (잠그지 않으므로 가끔 하나 잃어도 됨)
+ */
+static unsigned char freq_get(centry_t *e) {
+  return __atomic_load_n(&e->freq, __ATOMIC_RELAXED);
+}
+
+static void freq_set(centry_t *e, unsigned char f) {
+  __atomic_store_n(&e->freq, f, __ATOMIC_RELAXED);
+}
+
+static void freq_bump(centry_t *e, unsigned char max) {
+  unsigned char f = freq_get(e);
+
+  if (f < max) // 상한에 닿으면 더 적지 않음 (적중마다 캐시 라인을 더럽히지 않게)
+    freq_set(e, f + 1);
+}
+
+/*
+ * lru - 읽을 때 시각만 적고, 내보낼 때 샤드를 훑어서 가장 오래 안 읽힌 것
+ *   큐 0은 넣은 순서 (시각이 같으면 먼저 넣은 것부터)
+ */
+static void lru_insert(shard_t *s, centry_t *e) {
+  e->stamp = now_ms(); // 넣은 것도 한 번 쓴 것으로
+  q_push(s, e, 0);
+}
+
+static void lru_lookup(shard_t *s, unsigned int h, centry_t *e) {
+  unsigned long stamp;
+
+  if (e == NULL)
+    return;
+  stamp = now_ms(); // 바뀔 때만 적음
+  if (__atomic_load_n(&e->stamp, __ATOMIC_RELAXED) != stamp)
+    __atomic_store_n(&e->stamp, stamp, __ATOMIC_RELAXED);
+}
+
+static centry_t *lru_victim(shard_t *s) {
+  unsigned long min = ULONG_MAX, stamp;
+  centry_t *e, *victim = NULL;
+  int i;
+
+  for (i = s->q[0].tail; i != NIL; i = e->prev) {
+    e = &s->entries[i];
+    if ((stamp = __atomic_load_n(&e->stamp, __ATOMIC_RELAXED)) < min) {
+      min = stamp;
+      victim = e;
+    }
+  }
+  if (victim != NULL)
+    q_unlink(s, victim);
+  return victim;
+}
+
+/*
+ * clock - 큐 0을 시곗바늘처럼 돌면서 참조 비트(freq)가 켜진 것은 끄고 머리로 보냄
+ */
+static void clock_insert(shard_t *s, centry_t *e) {
+  e->freq = 0;
+  q_push(s, e, 0);
+}
+
+static void clock_lookup(shard_t *s, unsigned int h, centry_t *e) {
+  if (e != NULL)
+    freq_bump(e, 1);
+}
+
+static centry_t *clock_victim(shard_t *s) {
+  centry_t *e;
+  int n;
+
+  for (n = 0; (e = q_tail(s, 0)) != NULL; n++) {
+    if (n < 2 * SHARD_ENTRIES && freq_get(e)) { // 읽혔음: 한 바퀴 더 (계속 읽혀도 두 바퀴면 멈춤)
+      freq_set(e, 0);
+      q_move(s, e, 0);
+      continue;
+    }
+    q_unlink(s, e);
+    return e;
+  }
+  return NULL;
+}
+
+/*
+ * s3fifo - 작은 FIFO(S3_SMALL)와 큰 FIFO(S3_MAIN), 작은 FIFO에서 나간 것의 해시(ghost)
+ *   새 객체는 작은 FIFO로 (ghost에 있으면 곧 다시 온 것이라 바로 큰 FIFO로).
+ *   작은 FIFO가 예산의 10%를 넘으면 거기서 내보내는데, 두 번 넘게 읽힌 것은 큰 FIFO로 옮긴다.
+ *   큰 FIFO 꼬리는 읽힌 적이 있으면 빈도를 하나 줄이고 머리로 보낸다.
+ */
+enum { S3_SMALL, S3_MAIN };
+
+static int ghost_has(shard_t *s, unsigned int h) {
+  int i;
+
+  for (i = 0; i < GHOST_SIZE; i++)
+    if (s->ghost[i] == (h | 1)) { // 0은 빈 칸이라 가장 아래 비트는 켜서 저장
+      s->ghost[i] = 0;
+      return 1;
+    }
+  return 0;
+}
+
+static void ghost_add(shard_t *s, unsigned int h) {
+  s->ghost[s->ghost_pos] = h | 1;
+  s->ghost_pos = (s->ghost_pos + 1) % GHOST_SIZE;
+}
+
+static void s3_insert(shard_t *s, centry_t *e) {
+  e->freq = 0;
+  q_push(s, e, ghost_has(s, e->hash) ? S3_MAIN : S3_SMALL);
+}
+
+static void s3_lookup(shard_t *s, unsigned int h, centry_t *e) {
+  if (e != NULL)
+    freq_bump(e, 3);
+}
+
+static centry_t *s3_victim(shard_t *s) {
+  centry_t *e;
+  int n;
+
+  for (n = 0;; n++) {
+    if ((e = q_tail(s, S3_SMALL)) != NULL && (s->q[S3_SMALL].bytes > s->budget / 10 || s->q[S3_MAIN].tail == NIL)) {
+      if (n < 4 * SHARD_ENTRIES && freq_get(e) > 1) { // 자주 읽힘: 큰 FIFO로
+        freq_set(e, 0);
+        q_move(s, e, S3_MAIN);
+        continue;
+      }
+      ghost_add(s, e->hash);
+    }
+    else if ((e = q_tail(s, S3_MAIN)) == NULL)
+      return NULL;
+    else if (n < 4 * SHARD_ENTRIES && freq_get(e) > 0) {
+      freq_set(e, freq_get(e) - 1);
+      q_move(s, e, S3_MAIN);
+      continue;
+    }
+    q_unlink(s, e);
+    return e;
+  }
+}
+
+/*
+ * tinylfu - W-TinyLFU: 창(TLFU_WINDOW, 예산의 1%) LRU와 본 영역 SLRU(TLFU_PROBATION,
+ *   TLFU_PROTECTED는 본 영역의 80%까지). 새 객체는 창에 넣고, 창이 넘치면 창의 꼬리가
+ *   본 영역에 들어갈 후보가 된다. 본 영역에 자리가 없으면 후보와 probation 꼬리 중에서
+ *   count-min sketch로 센 빈도가 더 낮은 쪽을 내보낸다 (같으면 후보를 내보냄).
+ *   sketch는 찾을 때마다 (미스도) 센다. probation에 있다가 다시 읽힌 것은 내보낼 차례에
+ *   protected로 올린다 (읽는 쪽은 freq만 켬).
+ */
+enum { TLFU_WINDOW, TLFU_PROBATION, TLFU_PROTECTED };
+
+static unsigned int cms_slot(unsigned int h, int row) {
+  static const unsigned int seed[CMS_DEPTH] = {0x9e3779b1u, 0x85ebca77u, 0xc2b2ae3du, 0x27d4eb2fu};
+
+  return (h * seed[row]) >> (32 - CMS_BITS);
+}
+
+static void cms_add(shard_t *s, unsigned int h) {
+  unsigned char *c;
+  int i;
+
+  for (i = 0; i < CMS_DEPTH; i++) {
+    c = &s->cms[i][cms_slot(h, i)];
+    if (__atomic_load_n(c, __ATOMIC_RELAXED) < CMS_MAX)
+      __atomic_store_n(c, __atomic_load_n(c, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+  }
+}
+
+static unsigned int cms_est(shard_t *s, unsigned int h) {
+  unsigned int min = CMS_MAX, c;
+  int i;
+
+  for (i = 0; i < CMS_DEPTH; i++)
+    if ((c = __atomic_load_n(&s->cms[i][cms_slot(h, i)], __ATOMIC_RELAXED)) < min)
+      min = c;
+  return min;
+}
+
+/*
+ * cms_age - sketch 카운터를 전부 반으로 (예전 빈도가 최근 것을 누르지 않게)
+ */
+static void cms_age(shard_t *s) {
+  unsigned char *c;
+
+  for (c = &s->cms[0][0]; c < &s->cms[0][0] + sizeof(s->cms); c++)
+    __atomic_store_n(c, __atomic_load_n(c, __ATOMIC_RELAXED) / 2, __ATOMIC_RELAXED);
+}
+
+static void tlfu_insert(shard_t *s, centry_t *e) {
+  e->freq = 0;
+  q_push(s, e, TLFU_WINDOW);
+  if (++s->cms_puts >= CMS_RESET) {
+    s->cms_puts = 0;
+    cms_age(s);
+  }
+}
+
+static void tlfu_lookup(shard_t *s, unsigned int h, centry_t *e) {
+  cms_add(s, h);
+  if (e != NULL)
+    freq_bump(e, 1);
+}
+
+/*
+ * tlfu_main_tail - 본 영역에서 내보낼 차례인 항목 (큐에서 빼지는 않음, 비었으면 NULL)
+ *   probation 꼬리가 다시 읽혔으면 protected로 올리고, protected가 넘치면 그 꼬리를
+ *   probation으로 내린다 (protected 꼬리도 읽혔으면 한 번 더 기회).
+ */
+static centry_t *tlfu_main_tail(shard_t *s) {
+  size_t max = (s->budget - s->budget / 100) / 10 * 8;
+  centry_t *e, *d;
+  int n, k = 0;
+
+  for (n = 0; n < 2 * SHARD_ENTRIES; n++) {
+    if ((e = q_tail(s, TLFU_PROBATION)) == NULL) { // probation이 비었으면 protected 꼬리를 내림
+      if ((e = q_tail(s, TLFU_PROTECTED)) == NULL)
+        return NULL;
+      freq_set(e, 0);
+      q_move(s, e, TLFU_PROBATION);
+      return e;
+    }
+    if (!freq_get(e))
+      return e;
+    freq_set(e, 0);
+    q_move(s, e, TLFU_PROTECTED);
+    while (s->q[TLFU_PROTECTED].bytes > max && (d = q_tail(s, TLFU_PROTECTED)) != NULL) {
+      if (k++ < SHARD_ENTRIES && freq_get(d)) {
+        freq_set(d, 0);
+        q_move(s, d, TLFU_PROTECTED);
+        continue;
+      }
+      q_move(s, d, TLFU_PROBATION);
+    }
+  }
+  return q_tail(s, TLFU_PROBATION);
+}
+
+static centry_t *tlfu_victim(shard_t *s) {
+  size_t window = s->budget / 100;
+  centry_t *cand, *v;
+
+  while ((cand = q_tail(s, TLFU_WINDOW)) != NULL && s->q[TLFU_WINDOW].bytes > window) {
+    if ((v = tlfu_main_tail(s)) == NULL ||
+        s->q[TLFU_PROBATION].bytes + s->q[TLFU_PROTECTED].bytes + cand->keylen + cand->size <= s->budget - window) {
+      freq_set(cand, 0); // 본 영역에 자리가 있음: 그냥 들어감
+      q_move(s, cand, TLFU_PROBATION);
+      continue;
+    }
+    if (cms_est(s, cand->hash) > cms_est(s, v->hash)) { // 후보가 더 자주 쓰임: 본 영역 꼬리를 내보냄
+      freq_set(cand, 0);
+      q_move(s, cand, TLFU_PROBATION);
+      q_unlink(s, v);
+      return v;
+    }
+    q_unlink(s, cand); // 들이지 않음
+    return cand;
+  }
+  if ((v = tlfu_main_tail(s)) != NULL || (v = cand) != NULL)
+    q_unlink(s, v);
+  return v;
+}
+
+/*
+ * gdsf - 우선순위 H = L + 빈도 * GDSF_SCALE / 크기 가 가장 작은 것을 내보내고 L = H
+ *   (작고 자주 읽히는 객체를 남겨서 적중률을 올림). 읽는 쪽은 빈도를 올리고 그때의 L을
+ *   적어 두며, H는 내보낼 때 훑으면서 계산한다.
+ */
+static unsigned long gdsf_prio(centry_t *e) {
+  return __atomic_load_n(&e->lval, __ATOMIC_RELAXED) + freq_get(e) * GDSF_SCALE / (e->keylen + e->size);
+}
+
+static void gdsf_insert(shard_t *s, centry_t *e) {
+  e->freq = 1;
+  e->lval = s->gdsf_l;
+  q_push(s, e, 0);
+}
+
+static void gdsf_lookup(shard_t *s, unsigned int h, centry_t *e) {
+  unsigned long l;
+
+  if (e == NULL)
+    return;
+  freq_bump(e, UCHAR_MAX);
+  l = __atomic_load_n(&s->gdsf_l, __ATOMIC_RELAXED);
+  if (__atomic_load_n(&e->lval, __ATOMIC_RELAXED) != l)
+    __atomic_store_n(&e->lval, l, __ATOMIC_RELAXED);
+}
+
+static centry_t *gdsf_victim(shard_t *s) {
+  unsigned long min = ULONG_MAX, h;
+  centry_t *e, *victim = NULL;
+  int i;
+
+  for (i = s->q[0].tail; i != NIL; i = e->prev) {
+    e = &s->entries[i];
+    if ((h = gdsf_prio(e)) < min) {
+      min = h;
+      victim = e;
+    }
+  }
+  if (victim == NULL)
+    return NULL;
+  __atomic_store_n(&s->gdsf_l, min, __ATOMIC_RELAXED);
+  q_unlink(s, victim);
+  return victim;
+}
+
+/* 정책 표 (cache_policy_t 순서) */
+static policy_t policies[] = {
+  [CACHE_LRU] = {"lru", lru_insert, lru_lookup, lru_victim},
+  [CACHE_CLOCK] = {"clock", clock_insert, clock_lookup, clock_victim},
+  [CACHE_S3FIFO] = {"s3fifo", s3_insert, s3_lookup, s3_victim},
+  [CACHE_TINYLFU] = {"tinylfu", tlfu_insert, tlfu_lookup, tlfu_victim},
+  [CACHE_GDSF] = {"gdsf", gdsf_insert, gdsf_lookup, gdsf_victim},
+};
+
+/*
+ * reclaim - 샤드 s에서 떼어낸 항목 중 epoch가 지났고 고정이 풀린 것을 돌려받기 (잠근 상태에서)
+ *   반환: 돌려받은 항목 수
+ */
+static int reclaim(shard_t *s) {
+  unsigned long min;
+  centry_t *e;
+  int *p, n = 0;
+
+  if (s->retired == NIL)
+    return 0;
+  min = epoch_min();
+  for (p = &s->retired; *p != NIL;) {
+    e = &s->entries[*p];
+    if (e->retired >= min || __atomic_load_n(&e->refs, __ATOMIC_ACQUIRE) > 0) { // 아직 보고 있을 수 있음
+      p = &e->next;
+      continue;
+    }
+    *p = e->next;
+    s->used -= e->keylen + e->size;
+    global_lock();
+    cache->used -= e->keylen + e->size;
+    chain_free(e->chunk);
+    global_unlock();
+    e->state = E_FREE;
+    n++;
+  }
+  return n;
+}
+
+/*
+ * unlink_entry - 정책 큐에서 뺀 항목을 버킷에서 떼어내고 retire (잠근 상태에서)
+ *   떼어낸 항목은 바로 돌려받을 수 있으면 돌려받는다.
+ */
+static void unlink_entry(shard_t *s, centry_t *e) {
+  int *p, i = e - s->entries;
+
+  for (p = bucket_of(s, e->hash); *p != i; p = &s->entries[*p].hnext) // 버킷에서 떼기 (e->hnext는 그대로)
+    ;
+  __atomic_store_n(p, e->hnext, __ATOMIC_RELEASE);
+  retire(s, e);
+  s->evictions++;
+  reclaim(s);
+}
+
+/*
+ * evict_one - 정책이 고른 샤드 s의 항목 하나를 떼어내기 (잠근 상태에서)
+ *   반환: 떼어냈으면 0, 샤드에 살아있는 항목이 없으면 -1
+ */
+static int evict_one(shard_t *s) {
+  centry_t *e;
+
+  if ((e = policy->victim(s)) == NULL)
+    return -1;
+  unlink_entry(s, e);
+  return 0;
+}
+
+/*
+ * slab_drain - 바이트는 남는데 맞는 chunk가 없을 때(조각남) 가장 적게 쓴 페이지를 비우기 (s를 잠근 상태)
+ *   그 페이지에 chunk가 있는 객체들을 정책과 상관없이 내보낸다. 다른 샤드의 객체는
+ *   trylock으로 잡힐 때만. 고정된 객체가 있으면 다 놓은 뒤에 페이지가 비고, 그동안
+ *   그 페이지에서는 새 chunk를 내주지 않는다. 빈 페이지는 필요한 등급이 가져간다.
+ *   반환: 하나라도 내보냈으면 0, 아니면 -1
+ */
+static int slab_drain(shard_t *s) {
+  unsigned short owners[SLAB_MAX_CHUNKS], o;
+  int p, best = NIL, i, k, n = 0, evicted = 0;
+  shard_t *sh;
+  centry_t *e;
+
+  global_lock();
+  for (p = 0; p < SLAB_PAGES; p++)
+    if (cache->pages[p].cls >= 0 && (best == NIL || cache->pages[p].used < cache->pages[best].used))
+      best = p;
+  if (best != NIL) {
+    if (!cache->pages[best].draining) {
+      cache->pages[best].draining = 1;
+      cache->drains++;
+    }
+    for (i = 0; i < SLAB_MAX_CHUNKS; i++) { // 주인 항목들 (객체 하나가 chunk 여럿일 수 있음)
+      if ((o = cache->cowner[best * SLAB_MAX_CHUNKS + i]) == 0)
+        continue;
+      for (k = 0; k < n && owners[k] != o; k++)
+        ;
+      if (k == n)
+        owners[n++] = o;
+    }
+  }
+  global_unlock();
+
+  for (i = 0; i < n; i++) {
+    sh = &cache->shards[(owners[i] - 1) / SHARD_ENTRIES];
+    if (sh != s && shard_lock(sh, 1) < 0)
+      continue;
+    e = &sh->entries[(owners[i] - 1) % SHARD_ENTRIES];
+    if (e->state == E_LIVE) { // 넣는 중(E_FREE)이거나 이미 떼어낸 것은 그대로
+      q_unlink(sh, e);
+      unlink_entry(sh, e);
+      evicted++;
+    }
+    if (sh != s)
+      shard_unlock(sh);
+  }
+  return evicted ? 0 : -1;
+}
+
+/*
+ * rebalance - 최근에 넣은 바이트에 비례해서 샤드 예산 다시 나누기 (전역 잠금 상태에서)
+ *   최소 몫은 SHARD_MIN_BUDGET, 수요는 나눌 때마다 반으로 줄여서 최근 것이 더 무겁게
+ */
+static void rebalance(void) {
+  size_t demand = 0, spare = MAX_CACHE_SIZE - CACHE_SHARDS * SHARD_MIN_BUDGET, d;
+  int i;
+
+  for (i = 0; i < CACHE_SHARDS; i++)
+    demand += __atomic_load_n(&cache->shards[i].inserted, __ATOMIC_RELAXED);
+  if (demand == 0)
+    return;
+  for (i = 0; i < CACHE_SHARDS; i++) { // 다른 샤드의 값은 잠그지 않고 읽으므로 대략적
+    d = __atomic_load_n(&cache->shards[i].inserted, __ATOMIC_RELAXED);
+    __atomic_store_n(&cache->shards[i].budget,
+                     SHARD_MIN_BUDGET + (size_t)((double)spare * d / demand), __ATOMIC_RELAXED);
+    __atomic_store_n(&cache->shards[i].inserted, d / 2, __ATOMIC_RELAXED);
+  }
+}
+
+/*
+ * make_room - 샤드 s에 need 바이트짜리 객체가 들어갈 빈 항목과 chunk 만들기 (s를 잠근 상태)
+ *   전체에 자리가 모자라면 예산을 가장 많이 넘은 샤드가 내놓는다.
+ *   바이트는 남는데 chunk가 조각나서 모자라면 페이지 하나를 비운다.
+ *   다른 샤드는 trylock으로만 잡고 (샤드끼리 서로 기다리다 막히지 않게) 못 잡으면 s에서 내보냄.
+ *   고정된 객체는 떼어내도 바로 자리가 안 나므로 몇 번 해보고 안 되면 포기한다.
+ *   반환: 빈 항목 (확인한 자리를 다른 샤드가 먼저 가져가지 않게 전역 잠금을 쥔 채로),
+ *   자리를 못 만들면 NULL
+ */
+static centry_t *make_room(shard_t *s, size_t need) {
+  shard_t *victim, *v;
+  centry_t *e;
+  long over, most;
+  int room, fits, tries;
+
+  reclaim(s);
+  for (tries = 0; tries < 2 * SHARD_ENTRIES; tries++) {
+    for (e = s->entries; e < s->entries + SHARD_ENTRIES && e->state != E_FREE; e++)
+      ;
+    if (e == s->entries + SHARD_ENTRIES) { // 샤드의 항목 표가 꽉 참
+      if (evict_one(s) < 0 && reclaim(s) == 0)
+        return NULL;
+      continue;
+    }
+    global_lock();
+    room = cache->used + need <= MAX_CACHE_SIZE;
+    fits = room && slab_fits(need);
+    if (fits)
+      return e;
+    global_unlock();
+    if (room && slab_drain(s) == 0)
+      continue;
+
+    for (victim = s, most = LONG_MIN, v = cache->shards; v < cache->shards + CACHE_SHARDS; v++) {
+      over = (long)__atomic_load_n(&v->used, __ATOMIC_RELAXED) + (v == s ? (long)need : 0) -
+             (long)__atomic_load_n(&v->budget, __ATOMIC_RELAXED);
+      if (__atomic_load_n(&v->live, __ATOMIC_RELAXED) > 0 && over > most) {
+        most = over;
+        victim = v;
+      }
+    }
+    if (victim != s && shard_lock(victim, 1) == 0) {
+      fits = evict_one(victim) == 0;
+      shard_unlock(victim);
+      if (fits)
+        continue;
+    }
+    if (evict_one(s) < 0 && reclaim(s) == 0) { // s에는 내보낼 것이 없음
+      if (victim == s)
+        return NULL;
+      sched_yield(); // victim을 쥔 쪽이 끝날 때까지
+    }
+  }
+  return NULL;
+}
+
+/*
+ * cache_init - 캐시를 공유 arena 하나에 만들기 (가능하면 huge page, fork 전에 호출)
+ */
+void cache_init(cache_policy_t p) {
+  size_t len = (sizeof(cache_t) + HUGE_PAGE - 1) & ~(size_t)(HUGE_PAGE - 1);
+  pthread_mutexattr_t attr;
+  shard_t *s;
+  int i;
+
+  backing = "explicit huge pages";
+  cache = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (cache == MAP_FAILED) { // 예약된 huge page가 없음: 보통 페이지로 잡고 THP를 부탁
+    cache = Mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    backing = madvise(cache, len, MADV_HUGEPAGE) == 0 ? "4 KB pages, THP advised" : "4 KB pages";
+  }
+  memset(cache, 0, sizeof(cache_t)); // 미리 다 만져 둠 (적중할 때 page fault 없이, RSS는 여기서 고정)
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED); // fork한 프로세스끼리 공유
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);    // 쥔 채로 죽어도 복구 가능
+  pthread_mutex_init(&cache->lock, &attr);
+  for (s = cache->shards; s < cache->shards + CACHE_SHARDS; s++) {
+    pthread_mutex_init(&s->lock, &attr);
+    s->budget = MAX_CACHE_SIZE / CACHE_SHARDS; // 처음엔 똑같이
+    s->inserted = 0;
+    shard_reset(s);
+  }
+  pthread_mutexattr_destroy(&attr);
+  for (i = 0; i < SLAB_PAGES; i++)
+    cache->pages[i].cls = cache->pages[i].last = -1;
+  cache->free_pages = SLAB_PAGES;
+  cache->epoch = 1;
+  policy = &policies[p];
+  pthread_atfork(NULL, NULL, after_fork);
+}
+
+/*
+ * stat_add - 슬롯 주인만 올리는 카운터 (cache_stats가 잠그지 않고 읽음)
+ */
+static void stat_add(unsigned long *p, unsigned long n) {
+  __atomic_store_n(p, *p + n, __ATOMIC_RELAXED);
+}
+
+/*
+ * cache_pin - url에 캐시된 객체를 고정해서 반환 (제자리에서 보낼 수 있게, 잠금 없이)
+ *   반환: 객체, 없으면 NULL (*size에 객체 크기)
+ */
+cobj_t *cache_pin(char *url, size_t *size) {
+  unsigned int h = hash_url(url);
+  shard_t *s = shard_of(h);
+  eslot_t *slot = slot_get();
+  centry_t *e;
+
+  if (slot == NULL)
+    return NULL;
+  epoch_enter(slot);
+  if ((e = find(s, url, strlen(url) + 1, h)) != NULL)
+    __atomic_fetch_add(&e->refs, 1, __ATOMIC_ACQ_REL); // epoch를 나가도 돌려받지 않게
+  epoch_exit(slot);
+  policy->lookup(s, h, e); // 고정했으므로 epoch 밖에서 적어도 됨
+  stat_add(&slot->lookups, 1);
+  if (e == NULL)
+    return NULL;
+  stat_add(&slot->hits, 1);
+  stat_add(&slot->hit_bytes, e->size);
+  *size = e->size;
+  return e;
+}
+
+/*
+ * cache_unpin - cache_pin으로 잡은 고정 풀기
+ */
+void cache_unpin(cobj_t *o) {
+  __atomic_fetch_sub(&o->refs, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * cache_read - 고정한 객체의 off부터 최대 n바이트를 dst에 복사
+ *   반환: 복사한 바이트 수
+ */
+size_t cache_read(cobj_t *o, size_t off, char *dst, size_t n) {
+  size_t k, done = 0;
+  int b;
+
+  if (off >= o->size)
+    return 0;
+  if (n > o->size - off)
+    n = o->size - off;
+  off += o->keylen;
+  for (b = chain_seek(o->chunk, &off); done < n; b = cache->cnext[b], off = 0) {
+    k = chunk_size(b) - off < n - done ? chunk_size(b) - off : n - done;
+    memcpy(dst + done, chunk_ptr(b) + off, k);
+    done += k;
+  }
+  return n;
+}
+
+/*
+ * cache_iov - 고정한 객체의 off부터 끝까지를 복사 없이 iov로 가리키기
+ *   반환: 채운 iovec 개수 (최대 max)
+ */
+int cache_iov(cobj_t *o, size_t off, struct iovec *iov, int max) {
+  size_t k, left;
+  int b, n = 0;
+
+  if (off >= o->size)
+    return 0;
+  left = o->size - off;
+  off += o->keylen;
+  for (b = chain_seek(o->chunk, &off); left > 0 && n < max; b = cache->cnext[b], off = 0) {
+    k = chunk_size(b) - off < left ? chunk_size(b) - off : left;
+    iov[n].iov_base = chunk_ptr(b) + off;
+    iov[n++].iov_len = k;
+    left -= k;
+  }
+  return n;
+}
+
+/*
+ * cache_put - obj의 복사본을 url로 저장 (자리가 없으면 정책이 고른 객체를 내보냄)
+ */
+void cache_put(char *url, char *obj, size_t size) {
+  unsigned int h = hash_url(url);
+  shard_t *s = shard_of(h);
+  size_t keylen = strlen(url) + 1, need = keylen + size;
+  centry_t *e;
+  int *bucket;
+
+  if (size > MAX_OBJECT_SIZE || need > MAX_CACHE_SIZE)
+    return;
+
+  shard_lock(s, 0);
+  __atomic_store_n(&s->misses, s->misses + 1, __ATOMIC_RELAXED); // 원서버에서 받아온 것 (바이트 적중률의 분모)
+  __atomic_store_n(&s->miss_bytes, s->miss_bytes + size, __ATOMIC_RELAXED);
+  if (find(s, url, keylen, h) != NULL || (e = make_room(s, need)) == NULL) { // 먼저 넣었거나 자리가 없음
+    shard_unlock(s);
+    return;
+  }
+  __atomic_fetch_add(&s->inserted, need, __ATOMIC_RELAXED);
+  e->chunk = chain_alloc(need, owner_of(s, e)); // make_room이 잡아 온 전역 잠금 안에서
+  cache->used += need;
+  if (++cache->puts % CACHE_REBALANCE == 0)
+    rebalance();
+  global_unlock();
+
+  chain_write(e->chunk, 0, url, keylen);
+  chain_write(e->chunk, keylen, obj, size);
+  e->hash = h;
+  e->keylen = keylen;
+  e->size = size;
+  e->refs = 0;
+  e->state = E_LIVE;
+  policy->insert(s, e);
+  s->used += need;
+  bucket = bucket_of(s, h);
+  e->hnext = *bucket;
+  __atomic_store_n(bucket, e - s->entries, __ATOMIC_RELEASE); // 다 채운 뒤에 걸어서 읽는 쪽에 보이게
+  shard_unlock(s);
+}
+
+/*
+ * cache_stats - 지금까지의 정책별 적중률과 바이트 적중률 출력
+ */
+void cache_stats(void) {
+  unsigned long lookups = 0, hits = 0, hit_bytes = 0, miss_bytes = 0, evictions = 0;
+  eslot_t *slot;
+  shard_t *s;
+
+  for (slot = cache->slots; slot < cache->slots + EPOCH_SLOTS; slot++) {
+    lookups += __atomic_load_n(&slot->lookups, __ATOMIC_RELAXED);
+    hits += __atomic_load_n(&slot->hits, __ATOMIC_RELAXED);
+    hit_bytes += __atomic_load_n(&slot->hit_bytes, __ATOMIC_RELAXED);
+  }
+  for (s = cache->shards; s < cache->shards + CACHE_SHARDS; s++) {
+    miss_bytes += __atomic_load_n(&s->miss_bytes, __ATOMIC_RELAXED);
+    evictions += __atomic_load_n(&s->evictions, __ATOMIC_RELAXED);
+  }
+  printf("cache (%s): %lu lookups, hit ratio %.1f%%, byte hit ratio %.1f%%, %lu evicted, %zu bytes used\n",
+         policy->name, lookups, lookups ? 100.0 * hits / lookups : 0.0,
+         hit_bytes + miss_bytes ? 100.0 * hit_bytes / (hit_bytes + miss_bytes) : 0.0, evictions,
+         __atomic_load_n(&cache->used, __ATOMIC_RELAXED));
+  printf("cache slabs: %d/%d pages free, %lu moved between classes, %lu drained, %zu KB arena on %s\n",
+         __atomic_load_n(&cache->free_pages, __ATOMIC_RELAXED), SLAB_PAGES,
+         __atomic_load_n(&cache->moves, __ATOMIC_RELAXED), __atomic_load_n(&cache->drains, __ATOMIC_RELAXED),
+         sizeof(cache_t) >> 10, backing);
+}
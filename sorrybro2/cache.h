@@ -0,0 +1,75 @@
+/*
+ * cache.h - 웹 객체 캐시 (공유 메모리에 있어서 스레드끼리도, fork한 프로세스끼리도 공유)
+ */
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include "csapp.h"
+
+/* 캐시 최대 크기와 객체 최대 크기 정의 (문제 3에서 사용함) */
+#define MAX_CACHE_SIZE 1049000 // 캐시 최대 크기 정의
+#define MAX_OBJECT_SIZE 102400 // 캐시할 객체 최대 크기 정의
+#define CACHE_SHARD_BITS 3     // 캐시를 2^k개 샤드로 나눔 (샤드마다 잠금, 정책 큐, 예산)
+#define CACHE_SLAB 16384       // 슬랩 페이지 크기 (가장 큰 chunk, 더 작은 chunk 등급은 이것을 나눔)
+#define CACHE_MAX_IOV (MAX_OBJECT_SIZE / CACHE_SLAB + 2) // 객체 하나를 가리키는 데 필요한 최대 iovec 수
+
+/* 내보내기 정책 (-e 옵션, 자세한 것은 cache.c 머리 주석) */
+typedef enum {
+  CACHE_LRU,     // 가장 오래 안 읽힌 것
+  CACHE_CLOCK,   // 참조 비트로 한 번 더 기회를 주는 FIFO
+  CACHE_S3FIFO,  // 작은 FIFO + 큰 FIFO + ghost
+  CACHE_TINYLFU, // W-TinyLFU (count-min sketch로 들일지 정함)
+  CACHE_GDSF     // 크기와 빈도를 같이 보는 GreedyDual-Size-Frequency
+} cache_policy_t;
+
+void cache_init(cache_policy_t policy);
+/*
+  캐시를 공유 메모리(MAP_SHARED) arena 하나에 만들고 내보내기 정책을 정함
+  arena는 예약된 huge page(MAP_HUGETLB)가 있으면 거기에, 없으면 THP를 부탁한 보통 페이지에
+  fork 전에 한 번 호출하면 자식 프로세스들이 같은 캐시를 쓴다
+*/
+
+void cache_stats(void);
+/*
+  정책 이름과 지금까지의 적중률, 바이트 적중률, 슬랩 페이지 상태 출력 (SIGUSR1 통계에서)
+  적중률 = 적중 / 찾은 횟수, 바이트 적중률 = 적중 바이트 / (적중 바이트 + 원서버에서
+  받아와 cache_put한 바이트). MAX_OBJECT_SIZE보다 커서 넣지 않은 응답은 세지 않음
+*/
+
+typedef struct cobj cobj_t; // cache_pin으로 고정한 캐시 객체 (내용은 cache.c만 앎)
+
+cobj_t *cache_pin(char *url, size_t *size);
+/*
+  url(정규화한 키)에 해당하는 객체를 찾아서 고정(pin)
+  잠그지 않으므로 여러 스레드/프로세스의 적중이 동시에 진행됨
+  고정한 동안에는 내보내져도 chunk를 돌려받지 않으므로 cache_iov로 제자리에서 보내면 됨
+  반환: 고정한 객체 (다 쓰면 cache_unpin), 없으면 NULL
+  size: 객체 크기 (출력)
+*/
+
+void cache_unpin(cobj_t *o);
+/*
+  cache_pin한 객체를 놓기 (내보낸 객체면 다른 읽는 쪽도 다 놓은 뒤에 돌려받음)
+*/
+
+size_t cache_read(cobj_t *o, size_t off, char *dst, size_t n);
+/*
+  고정한 객체의 off부터 n 바이트까지를 dst로 복사 (헤더를 고쳐 쓸 때처럼 조금만)
+  반환: 복사한 바이트 수 (객체 끝에서 짧아짐)
+*/
+
+int cache_iov(cobj_t *o, size_t off, struct iovec *iov, int max);
+/*
+  고정한 객체의 off부터 끝까지를 복사하지 않고 가리키는 iovec을 최대 max개 채움
+  (chunk마다 하나, 객체 전체는 CACHE_MAX_IOV개면 충분)
+  반환: 채운 iovec 수 (max개로 모자라면 max, 나머지는 off를 옮겨서 다시)
+*/
+
+void cache_put(char *url, char *obj, size_t size);
+/*
+  객체를 url 해시로 고른 샤드에 저장 (그 샤드만 잠금)
+  자리가 모자라면 예산을 가장 많이 넘은 샤드가 정책이 고른 객체를 내보냄
+  이미 있거나 MAX_OBJECT_SIZE보다 크면 아무 것도 안 함
+*/
+
+#endif /* __CACHE_H__ */
@@ -0,0 +1,133 @@
+/*
+ * chunked.c - Transfer-Encoding: chunked 스트리밍 디코더/인코더
+ *
+ * 디코더는 바이트 단위 상태 기계라서 chunk 크기 줄이나 CRLF가 읽기 버퍼
+ * 경계에서 잘려도 상관없다. 본문 데이터는 복사하지 않고 입력 버퍼 안의
+ * 위치(data, dlen)로만 알려주므로, 호출한 쪽은 Rio 버퍼를 그대로 가리켜서
+ * 클라이언트로 보내거나 캐시에 모으면 된다. 본문 전체를 모아둘 필요가 없다.
+ *
+ * 인코더는 chunk 크기 줄만 만들어 주고, 데이터는 호출한 쪽이
+ * [크기 줄][데이터][CRLF]를 iovec으로 묶어 writev 한 번에 보낸다.
+ */
+#include "proxy.h"
+#include <limits.h>
+
+/* 디코더 상태 */
+enum {
+  CH_SIZE,     // chunk 크기 (16진수)
+  CH_EXT,      // chunk 확장 (";name=value") - CR까지 무시 (제어 문자는 오류)
+  CH_SIZE_LF,  // 크기 줄의 CR 다음 LF
+  CH_DATA,     // chunk 데이터
+  CH_DATA_CR,  // 데이터 뒤 CR
+  CH_DATA_LF,  // 데이터 뒤 LF
+  CH_TRAILER,  // trailer 줄의 시작 (빈 줄이면 끝)
+  CH_TRAILER_LINE, // trailer 줄 나머지
+  CH_END_LF,   // 마지막 빈 줄의 LF
+  CH_DONE,     // 끝 (0 chunk + trailer + 빈 줄까지 읽음)
+  CH_ERROR     // 형식 오류
+};
+
+/*
+ * chunk_init - 디코더를 chunked 본문의 처음 상태로
+ */
+void chunk_init(chunk_decoder_t *d) {
+  d->state = CH_SIZE;
+  d->size = 0;
+  d->digits = 0;
+}
+
+/*
+ * chunk_decode - in에서 최대 len 바이트 소비, 본문 데이터가 나오면 그 위치를 알려주고 멈춤
+ *   (복사하지 않으므로 *data는 in 안을 가리킴)
+ */
+size_t chunk_decode(chunk_decoder_t *d, char *in, size_t len, char **data, size_t *dlen) {
+  char *p = in, *end = in + len;
+  size_t n;
+  int v;
+
+  *data = NULL;
+  *dlen = 0;
+  while (p < end && d->state != CH_DONE && d->state != CH_ERROR) {
+    switch (d->state) {
+    case CH_SIZE:
+      if ((v = hexval(*p)) >= 0) {
+        if (d->size > (LONG_MAX >> 4)) { // 말도 안 되게 큰 chunk
+          d->state = CH_ERROR;
+          break;
+        }
+        d->size = d->size * 16 + v;
+        d->digits++;
+      }
+      else if (d->digits == 0)
+        d->state = CH_ERROR;
+      else if (*p == ';' || *p == ' ' || *p == '\t')
+        d->state = CH_EXT;
+      else if (*p == '\r')
+        d->state = CH_SIZE_LF;
+      else
+        d->state = CH_ERROR;
+      p++;
+      break;
+    case CH_EXT: // 맨 LF나 CR 아닌 제어 문자는 앞뒤 프록시가 줄 끝을 다르게 볼 수 있어서 거부
+      if (*p == '\r')
+        d->state = CH_SIZE_LF;
+      else if (((unsigned char)*p < 0x20 && *p != '\t') || *p == 0x7f)
+        d->state = CH_ERROR;
+      p++;
+      break;
+    case CH_SIZE_LF:
+      d->state = *p++ != '\n' ? CH_ERROR : d->size > 0 ? CH_DATA : CH_TRAILER;
+      break;
+    case CH_DATA: // 데이터는 복사하지 않고 위치만 알려주고 멈춤
+      n = end - p < d->size ? end - p : d->size;
+      *data = p;
+      *dlen = n;
+      d->size -= n;
+      if (d->size == 0)
+        d->state = CH_DATA_CR;
+      return p + n - in;
+    case CH_DATA_CR:
+      d->state = *p++ == '\r' ? CH_DATA_LF : CH_ERROR;
+      break;
+    case CH_DATA_LF:
+      if (*p++ != '\n')
+        d->state = CH_ERROR;
+      else
+        chunk_init(d); // 다음 chunk
+      break;
+    case CH_TRAILER:
+      d->state = *p == '\r' ? CH_END_LF : CH_TRAILER_LINE;
+      p++;
+      break;
+    case CH_TRAILER_LINE:
+      if (*p++ == '\n')
+        d->state = CH_TRAILER;
+      break;
+    case CH_END_LF:
+      d->state = *p++ == '\n' ? CH_DONE : CH_ERROR;
+      break;
+    }
+  }
+  return p - in;
+}
+
+/*
+ * chunk_done - 마지막 0 chunk와 trailer까지 다 읽었는지
+ */
+int chunk_done(chunk_decoder_t *d) {
+  return d->state == CH_DONE;
+}
+
+/*
+ * chunk_error - chunked 형식이 틀렸는지
+ */
+int chunk_error(chunk_decoder_t *d) {
+  return d->state == CH_ERROR;
+}
+
+/*
+ * chunk_header - n 바이트짜리 chunk 앞에 붙일 크기 줄("<16진수>\r\n")을 buf에 쓰기
+ */
+int chunk_header(char *buf, size_t n) {
+  return sprintf(buf, "%zx\r\n", n);
+}
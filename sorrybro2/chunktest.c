@@ -0,0 +1,110 @@
+/*
+ * chunktest.c - chunked 디코더 테스트 (make test)
+ *
+ * 케이스마다 입력을 모든 바이트 경계에서 두 조각으로 나눠서, 그리고 한 바이트씩
+ * chunk_decode에 넣어 본다. 읽기 버퍼가 어디서 잘리든 결과가 같아야 한다:
+ *   정상 입력: 본문이 기대값과 같고, 마지막 바이트에서야 끝나고, 뒤에 붙은 바이트는 안 먹음
+ *   틀린 입력: 오류로 끝나고 끝(done)으로 보지 않음
+ */
+#include "proxy.h"
+
+/* 본문 뒤에 붙여서 디코더가 끝에서 멈추는지 보는 다음 요청 */
+#define NEXT "GET / HTTP/1.1\r\n"
+
+typedef struct {
+  char *name;
+  char *in;   // chunked 본문 (끝까지)
+  char *body; // 풀어낸 본문, NULL이면 오류여야 함
+} chunk_case_t;
+
+static chunk_case_t cases[] = {
+  {"one chunk", "5\r\nhello\r\n0\r\n\r\n", "hello"},
+  {"two chunks", "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n", "hello world"},
+  {"upper/lower hex", "a\r\n0123456789\r\nA\r\nabcdefghij\r\n0\r\n\r\n", "0123456789abcdefghij"},
+  {"leading zeros", "0005\r\nhello\r\n000\r\n\r\n", "hello"},
+  {"empty body", "0\r\n\r\n", ""},
+  {"extension", "5;name=value\r\nhello\r\n0;last\r\n\r\n", "hello"},
+  {"quoted extension", "5;a=\"x y\"\r\nhello\r\n0\r\n\r\n", "hello"},
+  {"space before extension", "5 ;a\r\nhello\r\n0\r\n\r\n", "hello"},
+  {"trailer", "5\r\nhello\r\n0\r\nX-Checksum: 1\r\nX-Other: 2\r\n\r\n", "hello"},
+  {"no size", "\r\nhello\r\n0\r\n\r\n", NULL},
+  {"bad size digit", "5g\r\nhello\r\n0\r\n\r\n", NULL},
+  {"bare LF after size", "5\nhello\r\n0\r\n\r\n", NULL},
+  {"bare LF in extension", "5;a=b\nhello\r\n0\r\n\r\n", NULL},
+  {"bare LF in last extension", "5\r\nhello\r\n0;a\n\r\n", NULL},
+  {"CR in extension", "5;a\rb\r\nhello\r\n0\r\n\r\n", NULL},
+  {"control char in extension", "5;a\001\r\nhello\r\n0\r\n\r\n", NULL},
+  {"chunk size overflow", "8000000000000000\r\nhello\r\n0\r\n\r\n", NULL},
+  {"chunk size overflow (f)", "fffffffffffffffff\r\nhello\r\n0\r\n\r\n", NULL},
+  {"data longer than size", "4\r\nhello\r\n0\r\n\r\n", NULL},
+  {"no CRLF after data", "5\r\nhello0\r\n\r\n", NULL},
+  {"bare LF after data", "5\r\nhello\n0\r\n\r\n", NULL},
+  {"bad last line", "0\r\n\rX", NULL},
+};
+
+/*
+ * feed - in[0..len)을 디코더에 다 넣기 (데이터가 나올 때마다 out에 모음)
+ *   반환: 소비한 바이트 수 (끝이나 오류에서 멈추면 len보다 작음)
+ */
+static size_t feed(chunk_decoder_t *d, char *in, size_t len, char *out, size_t *olen) {
+  size_t used = 0, n, dlen;
+  char *data;
+
+  while (used < len && !chunk_done(d) && !chunk_error(d)) {
+    n = chunk_decode(d, in + used, len - used, &data, &dlen);
+    if (data) {
+      memcpy(out + *olen, data, dlen);
+      *olen += dlen;
+    }
+    used += n;
+  }
+  return used;
+}
+
+/*
+ * run_case - c->in(+NEXT)을 split 위치에서 나눠 넣어 보기 (split이 0이면 한 바이트씩)
+ *   반환: 맞으면 0
+ */
+static int run_case(chunk_case_t *c, size_t split) {
+  char in[256], out[256];
+  size_t len = strlen(c->in), total = len + strlen(NEXT), olen = 0, used = 0, i;
+  chunk_decoder_t d;
+
+  sprintf(in, "%s%s", c->in, NEXT);
+  chunk_init(&d);
+  if (split == 0) {
+    for (i = 0; i < total && !chunk_done(&d) && !chunk_error(&d); i++) {
+      used += feed(&d, in + i, 1, out, &olen);
+      if (c->body && i < len - 1 && chunk_done(&d))
+        return -1;
+    }
+  }
+  else {
+    used = feed(&d, in, split, out, &olen);
+    if (c->body && split < len && chunk_done(&d)) // 마지막 바이트 전에 끝났다고 함
+      return -1;
+    if (used == split)
+      used += feed(&d, in + split, total - split, out, &olen);
+  }
+  if (c->body == NULL)
+    return chunk_error(&d) && !chunk_done(&d) ? 0 : -1;
+  return chunk_done(&d) && used == len && olen == strlen(c->body) &&
+         memcmp(out, c->body, olen) == 0 ? 0 : -1;
+}
+
+int main(void) {
+  int i, fails = 0, runs = 0;
+  size_t split;
+
+  for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    for (split = 0; split < strlen(cases[i].in) + strlen(NEXT); split++, runs++) {
+      if (run_case(&cases[i], split) < 0) {
+        printf("FAIL %s (split %zu)\n", cases[i].name, split);
+        fails++;
+        break;
+      }
+    }
+  }
+  printf("chunktest: %d cases, %d runs, %d failed\n", i, runs, fails);
+  return fails > 0;
+}
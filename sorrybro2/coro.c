@@ -0,0 +1,382 @@
+/*
+ * coro.c - stackful 코루틴 엔진 (-m coro)
+ *
+ * event.c는 handle_request를 상태 기계로 다시 짰지만, 여기서는
+ * handle_request -> forward_request -> forward_response를 그대로 둔 채
+ * 연결마다 작은 스택을 가진 코루틴 하나에서 실행한다.
+ *
+ * 소켓은 전부 non-blocking이고, Rio 함수(csapp.c)가 EAGAIN을 만나면
+ * rio_set_wait_hook으로 걸어둔 coro_wait가 불린다. coro_wait는 fd를 epoll에
+ * EPOLLONESHOT으로 걸고 스케줄러로 yield 했다가, fd가 준비되면 다시 이어서
+ * 돌아온다. (ONESHOT이라 기다리지 않는 fd, 예를 들어 터널 스레드로 넘긴
+ * CONNECT 소켓은 스케줄러를 깨우지 않음)
+ * 그래서 핸들러 코드 입장에서는 블록되는 read/write처럼 보이지만
+ * 스레드 하나가 수많은 연결을 번갈아 처리한다. (connect도 같은 방식)
+ *
+ * 스택은 mmap으로 STACK_SIZE만큼 예약만 하고(MAP_NORESERVE) 실제로 쓴
+ * 페이지만 물리 메모리를 차지하므로 필요한 만큼 자라는 것과 같다.
+ * 맨 아래 한 페이지는 넘침 감지용 guard page. 끝난 코루틴의 스택은
+ * STACK_POOL개까지 버리지 않고 다음 연결에 재사용한다.
+ *
+ * 문맥 전환은 처음 시작할 때만 makecontext/setcontext를 쓰고, 그 뒤로는
+ * _setjmp/_longjmp를 쓴다 (swapcontext는 전환마다 시그널 마스크 syscall을 함).
+ * getaddrinfo는 여전히 스레드를 블록한다.
+ *
+ * 시간 제한이 있는 기다림(keep-alive idle timeout)은 마감 시각 순으로 정렬된
+ * 타이머 목록에 걸어두고, epoll_wait의 timeout을 가장 이른 마감까지로 잡는다.
+ * 마감이 지나면 fd를 기다리던 코루틴을 깨우고 coro_wait가 -1을 반환한다.
+ */
+#undef _FORTIFY_SOURCE // __longjmp_chk는 다른 스택으로의 longjmp를 막으므로 끔
+#include "proxy.h"
+#include <ucontext.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <poll.h>
+#include <time.h>
+
+#define STACK_SIZE (256 * 1024) // 코루틴 하나의 스택 예약 크기 (handle_request가 ~90KB 사용)
+#define STACK_POOL 1024         // 재사용을 위해 남겨둘 스택 개수
+#define MAXEVENTS 1024          // epoll_wait 한 번에 받을 최대 이벤트 수
+
+/* 코루틴 하나 = 연결 하나 */
+typedef struct coro {
+  jmp_buf ctx;       // yield한 지점 (다시 이어서 실행할 곳)
+  char *stack;       // 스택 (guard page 포함, STACK_SIZE)
+  int connfd;        // 처리할 클라이언트 소켓
+  int started;       // 한 번이라도 실행됐는지
+  int done;          // handle_request가 끝났는지
+  int wait_fd;       // 기다리는 fd (타이머가 만료되면 waiters에서 빼야 함)
+  int timed_out;     // 마감이 지나서 깨어났는지
+  long deadline;     // 기다림 마감 시각 (ms, CLOCK_MONOTONIC)
+  struct coro *next; // 실행 대기 큐 링크
+  struct coro *tprev, *tnext; // 타이머 목록 링크
+} coro_t;
+
+static jmp_buf sched_ctx;         // 스케줄러로 돌아갈 지점
+static coro_t *current;           // 지금 실행 중인 코루틴 (스케줄러면 NULL)
+static coro_t *runq_head, *runq_tail; // 실행 대기 큐 (FIFO)
+static coro_t **waiters;          // fd -> 그 fd를 기다리는 코루틴
+static char *registered;          // fd -> epoll에 등록한 적이 있는지 (MOD/ADD 고르기)
+static coro_t *timers_head, *timers_tail; // 마감이 있는 기다림 (마감 순)
+static int maxfds;                // waiters 크기 (RLIMIT_NOFILE)
+static int epfd;                  // epoll 인스턴스
+static char *stack_pool[STACK_POOL]; // 재사용할 스택들
+static int nstacks;               // stack_pool에 든 스택 수
+static size_t pagesize;           // guard page 크기
+static unsigned long active, peak; // 살아있는 코루틴 수, 최대치
+static volatile sig_atomic_t stats_requested; // SIGUSR1을 받으면 1
+
+/*
+ * stack_get - 스택 하나 얻기 (풀에 있으면 재사용, 없으면 새로 예약)
+ */
+static char *stack_get(void) {
+  char *s;
+
+  if (nstacks > 0)
+    return stack_pool[--nstacks];
+  s = mmap(NULL, STACK_SIZE, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (s == MAP_FAILED)
+    return NULL;
+  if (mprotect(s, pagesize, PROT_NONE) < 0) // 맨 아래 페이지는 guard
+    unix_error("mprotect error");
+  return s;
+}
+
+/*
+ * stack_put - 다 쓴 스택을 풀에 돌려주기 (풀이 가득 차면 해제)
+ */
+static void stack_put(char *s) {
+  if (nstacks < STACK_POOL)
+    stack_pool[nstacks++] = s;
+  else
+    Munmap(s, STACK_SIZE);
+}
+
+/*
+ * runq_push - 코루틴을 실행 대기 큐 뒤에 넣기
+ */
+static void runq_push(coro_t *c) {
+  c->next = NULL;
+  if (runq_tail)
+    runq_tail->next = c;
+  else
+    runq_head = c;
+  runq_tail = c;
+}
+
+/*
+ * now_ms - 단조 시계 (ms)
+ */
+static long now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * timer_add - 마감 순서를 지키며 타이머 목록에 넣기
+ *   (timeout이 거의 다 같으므로 뒤에서부터 찾으면 보통 바로 끝남)
+ */
+static void timer_add(coro_t *c) {
+  coro_t *p = timers_tail;
+
+  while (p && p->deadline > c->deadline)
+    p = p->tprev;
+  c->tprev = p;
+  c->tnext = p ? p->tnext : timers_head;
+  if (c->tnext)
+    c->tnext->tprev = c;
+  else
+    timers_tail = c;
+  if (p)
+    p->tnext = c;
+  else
+    timers_head = c;
+}
+
+/*
+ * timer_del - 타이머 목록에서 빼기
+ */
+static void timer_del(coro_t *c) {
+  if (c->tprev)
+    c->tprev->tnext = c->tnext;
+  else
+    timers_head = c->tnext;
+  if (c->tnext)
+    c->tnext->tprev = c->tprev;
+  else
+    timers_tail = c->tprev;
+  c->tprev = c->tnext = NULL;
+}
+
+/*
+ * expire_timers - 마감이 지난 기다림을 끝내고 코루틴 깨우기
+ */
+static void expire_timers(void) {
+  long now = now_ms();
+  coro_t *c;
+
+  while ((c = timers_head) != NULL && c->deadline <= now) {
+    timer_del(c);
+    waiters[c->wait_fd] = NULL;
+    c->timed_out = 1;
+    runq_push(c);
+  }
+}
+
+/*
+ * next_timeout - epoll_wait에 줄 timeout (가장 이른 마감까지, 없으면 -1)
+ */
+static int next_timeout(void) {
+  long left;
+
+  if (timers_head == NULL)
+    return -1;
+  left = timers_head->deadline - now_ms();
+  return left > 0 ? (int)left : 0;
+}
+
+/*
+ * coro_main - 코루틴 본체: 평소와 똑같이 요청 처리 후 스케줄러로 복귀
+ */
+static void coro_main(void) {
+  coro_t *c = current;
+
+  if (!handle_request(c->connfd)) // 터널로 넘겼으면 닫지 않음
+    Close(c->connfd);
+  c->done = 1;
+  _longjmp(sched_ctx, 1); // 돌아오지 않음 (스택은 스케줄러가 회수)
+}
+
+/*
+ * coro_resume - 코루틴을 다음 yield(또는 끝)까지 실행
+ */
+static void coro_resume(coro_t *c) {
+  ucontext_t uc;
+
+  current = c;
+  if (_setjmp(sched_ctx) == 0) {
+    if (c->started) {
+      _longjmp(c->ctx, 1);
+    }
+    else { // 처음: 새 스택 위에서 coro_main 시작
+      c->started = 1;
+      getcontext(&uc);
+      uc.uc_stack.ss_sp = c->stack + pagesize;
+      uc.uc_stack.ss_size = STACK_SIZE - pagesize;
+      uc.uc_link = NULL;
+      makecontext(&uc, coro_main, 0);
+      setcontext(&uc);
+    }
+  }
+  current = NULL;
+  if (c->done) { // 끝난 코루틴 정리
+    stack_put(c->stack);
+    Free(c);
+    active--;
+  }
+}
+
+/*
+ * coro_wait - Rio wait hook: fd가 준비될 때까지(최대 timeout ms, -1은 무한) 스케줄러로 yield
+ *   (코루틴 밖에서 불리면 poll로 그냥 기다림) 준비되면 0, 마감이 지나면 -1
+ */
+static int coro_wait(int fd, int what, int timeout) {
+  struct epoll_event ev;
+  struct pollfd pfd;
+  int rc;
+
+  if (current == NULL) {
+    pfd.fd = fd;
+    pfd.events = what == RIO_WAIT_READ ? POLLIN : POLLOUT;
+    rc = poll(&pfd, 1, timeout);
+    if (rc == 0)
+      errno = ETIMEDOUT;
+    return rc > 0 ? 0 : -1;
+  }
+
+  // 기다릴 때마다 필요한 방향으로 한 번만 깨우도록(EPOLLONESHOT) 무장한다.
+  // 깨어난 뒤에는 무장이 풀려서, 터널 스레드에 넘긴 소켓 등이 이벤트를 더 만들지 않음.
+  // 닫힌 fd는 epoll에서 자동으로 빠지므로 번호가 재사용되면 MOD가 ENOENT -> ADD
+  ev.events = (what == RIO_WAIT_READ ? EPOLLIN : EPOLLOUT) | EPOLLONESHOT;
+  ev.data.fd = fd;
+  if (epoll_ctl(epfd, registered[fd] ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) < 0) {
+    if (errno != ENOENT && errno != EEXIST)
+      return -1;
+    if (epoll_ctl(epfd, errno == ENOENT ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev) < 0)
+      return -1;
+  }
+  registered[fd] = 1;
+
+  waiters[fd] = current;
+  current->wait_fd = fd;
+  current->timed_out = 0;
+  if (timeout >= 0) {
+    current->deadline = now_ms() + timeout;
+    timer_add(current);
+  }
+  if (_setjmp(current->ctx) == 0)
+    _longjmp(sched_ctx, 1); // yield
+
+  if (current->timed_out) { // 타이머가 깨움 (목록에서는 이미 빠짐)
+    errno = ETIMEDOUT;
+    return -1;
+  }
+  if (timeout >= 0)
+    timer_del(current);
+  return 0; // 깨어남: 호출한 Rio 함수가 read/write를 다시 시도
+}
+
+/*
+ * coro_spawn - 연결 하나를 처리할 코루틴 만들어 실행 대기 큐에 넣기
+ */
+static void coro_spawn(int connfd) {
+  coro_t *c = Malloc(sizeof(coro_t));
+
+  if ((c->stack = stack_get()) == NULL) { // 메모리가 모자라면 이 연결만 포기
+    fprintf(stderr, "coroutine stack: %s\n", strerror(errno));
+    Close(connfd);
+    Free(c);
+    return;
+  }
+  c->connfd = connfd;
+  c->started = 0;
+  c->done = 0;
+  c->tprev = c->tnext = NULL;
+  runq_push(c);
+  if (++active > peak)
+    peak = active;
+}
+
+/*
+ * accept_all - 들어온 연결을 EAGAIN이 날 때까지 받아서 코루틴 생성
+ */
+static void accept_all(int listenfd) {
+  int connfd, flags;
+
+  while ((connfd = accept(listenfd, NULL, NULL)) >= 0) {
+    if (connfd >= maxfds) { // waiters 범위 밖 (RLIMIT_NOFILE을 넘는 일은 없어야 함)
+      close(connfd);
+      continue;
+    }
+    flags = fcntl(connfd, F_GETFL, 0);
+    fcntl(connfd, F_SETFL, flags | O_NONBLOCK);
+    coro_spawn(connfd);
+  }
+  if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+    fprintf(stderr, "accept error: %s\n", strerror(errno)); // EMFILE 등, 다음 이벤트 때 다시
+}
+
+/*
+ * sigusr1_handler - 통계 출력 요청 표시만 하고, 출력은 epoll_wait가 EINTR로 깨어났을 때
+ */
+static void sigusr1_handler(int sig) {
+  stats_requested = 1;
+}
+
+/*
+ * coro_loop - 코루틴 스케줄러 (반환하지 않음)
+ */
+void coro_loop(int listenfd) {
+  struct epoll_event ev, events[MAXEVENTS];
+  struct rlimit rl;
+  coro_t *c;
+  int i, n, fd, flags;
+
+  pagesize = sysconf(_SC_PAGESIZE);
+  if (getrlimit(RLIMIT_NOFILE, &rl) < 0)
+    unix_error("getrlimit error");
+  maxfds = rl.rlim_cur == RLIM_INFINITY ? 1 << 20 : rl.rlim_cur;
+  waiters = Calloc(maxfds, sizeof(coro_t *));
+  registered = Calloc(maxfds, 1);
+
+  if ((epfd = epoll_create1(0)) < 0)
+    unix_error("epoll_create1 error");
+  flags = fcntl(listenfd, F_GETFL, 0);
+  fcntl(listenfd, F_SETFL, flags | O_NONBLOCK);
+  ev.events = EPOLLIN | EPOLLET | EPOLLEXCLUSIVE; // prefork 자식들이 같은 소켓을 볼 때 하나만 깨움
+  ev.data.fd = listenfd;
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, listenfd, &ev) < 0)
+    unix_error("epoll_ctl error");
+
+  rio_set_wait_hook(coro_wait);
+  Signal(SIGUSR1, sigusr1_handler);
+  printf("Coroutines: %d KB stacks, up to %d connections (kill -USR1 %d for stats)\n",
+         STACK_SIZE / 1024, maxfds / 2, (int)getpid());
+
+  while (1) {
+    while ((c = runq_head) != NULL) { // 실행할 수 있는 코루틴 전부 실행
+      if ((runq_head = c->next) == NULL)
+        runq_tail = NULL;
+      coro_resume(c);
+    }
+
+    n = epoll_wait(epfd, events, MAXEVENTS, next_timeout());
+    if (timers_head)
+      expire_timers();
+    if (n < 0) {
+      if (errno != EINTR)
+        unix_error("epoll_wait error");
+      if (stats_requested) {
+        stats_requested = 0;
+        printf("coroutines: %lu active, %lu peak, %d pooled stacks\n", active, peak, nstacks);
+        upstream_stats();
+        tunnel_stats();
+        cache_stats();
+        fflush(stdout);
+      }
+      continue;
+    }
+    for (i = 0; i < n; i++) {
+      fd = events[i].data.fd;
+      if (fd == listenfd)
+        accept_all(listenfd);
+      else if ((c = waiters[fd]) != NULL) { // 기다리던 코루틴 깨우기
+        waiters[fd] = NULL;
+        runq_push(c);
+      }
+    }
+  }
+}
@@ -742,6 +742,54 @@ void V(sem_t *sem)
  * The Rio package - Robust I/O functions
  ****************************************/
 
+/* Called when a non-blocking descriptor returns EAGAIN (NULL = fail) */
+static int (*rio_wait_hook)(int fd, int what, int timeout);
+
+/*
+ * rio_set_wait_hook - Install a function that waits until fd is ready,
+ *     so the Rio functions can be used on non-blocking descriptors
+ *     (the coroutine scheduler uses it to yield instead of blocking).
+ *     The hook waits at most timeout ms (-1 = forever) and returns 0
+ *     when fd is ready, -1 on timeout or error.
+ */
+void rio_set_wait_hook(int (*hook)(int fd, int what, int timeout))
+{
+    rio_wait_hook = hook;
+}
+
+/*
+ * rio_wait - After a failed read/write, wait for fd if it only failed
+ *     with EAGAIN and a wait hook is installed. Returns 0 to retry.
+ */
+int rio_wait(int fd, int what)
+{
+    if ((errno != EAGAIN && errno != EWOULDBLOCK) || rio_wait_hook == NULL)
+        return -1;
+    return rio_wait_hook(fd, what, -1);
+}
+
+/*
+ * rio_readable - Wait up to timeout ms (-1 = forever) until rp has
+ *     something to read. Returns 1 if readable, 0 on timeout, -1 on error.
+ */
+int rio_readable(rio_t *rp, int timeout)
+{
+    struct pollfd pfd;
+    int rc;
+
+    if (rp->rio_cnt > 0)        /* Already buffered */
+        return 1;
+    pfd.fd = rp->rio_fd;
+    pfd.events = POLLIN;
+    /* With a hook, only peek here: the hook waits for the next event */
+    while ((rc = poll(&pfd, 1, rio_wait_hook ? 0 : timeout)) < 0)
+        if (errno != EINTR)
+            return -1;
+    if (rc > 0 || rio_wait_hook == NULL)
+        return rc > 0;
+    return rio_wait_hook(rp->rio_fd, RIO_WAIT_READ, timeout) == 0;
+}
+
 /*
  * rio_readn - Robustly read n bytes (unbuffered)
  */
@@ -756,6 +804,8 @@ ssize_t rio_readn(int fd, void *usrbuf, size_t n)
 	if ((nread = read(fd, bufp, nleft)) < 0) {
 	    if (errno == EINTR) /* Interrupted by sig handler return */
 		nread = 0;      /* and call read() again */
+	    else if (rio_wait(fd, RIO_WAIT_READ) == 0)
+		nread = 0;      /* Not ready yet: waited, try again */
 	    else
 		return -1;      /* errno set by read() */ 
 	} 
@@ -782,6 +832,8 @@ ssize_t rio_writen(int fd, void *usrbuf, size_t n)
 	if ((nwritten = write(fd, bufp, nleft)) <= 0) {
 	    if (errno == EINTR)  /* Interrupted by sig handler return */
 		nwritten = 0;    /* and call write() again */
+	    else if (rio_wait(fd, RIO_WAIT_WRITE) == 0)
+		nwritten = 0;    /* Not ready yet: waited, try again */
 	    else
 		return -1;       /* errno set by write() */
 	}
@@ -792,6 +844,35 @@ ssize_t rio_writen(int fd, void *usrbuf, size_t n)
 }
 /* $end rio_writen */
 
+/*
+ * rio_writev - Robustly write every iovec with as few writev() calls as
+ *     possible (partial writes resume mid-iovec; iov is modified)
+ */
+ssize_t rio_writev(int fd, struct iovec *iov, int iovcnt)
+{
+    size_t total = 0;
+    ssize_t nwritten;
+
+    while (iovcnt > 0) {
+	if ((nwritten = writev(fd, iov, iovcnt)) < 0) {
+	    if (errno == EINTR || rio_wait(fd, RIO_WAIT_WRITE) == 0)
+		continue;        /* Interrupted or not ready yet: try again */
+	    return -1;           /* errno set by writev() */
+	}
+	total += nwritten;
+	while (iovcnt > 0 && (size_t)nwritten >= iov->iov_len) { /* Skip sent iovecs */
+	    nwritten -= iov->iov_len;
+	    iov++;
+	    iovcnt--;
+	}
+	if (iovcnt > 0) {        /* Resume inside a partially sent iovec */
+	    iov->iov_base = (char *)iov->iov_base + nwritten;
+	    iov->iov_len -= nwritten;
+	}
+    }
+    return total;
+}
+
 
 /* 
  * rio_read - This is a wrapper for the Unix read() function that
@@ -810,7 +891,8 @@ static ssize_t rio_read(rio_t *rp, char *usrbuf, size_t n)
 	rp->rio_cnt = read(rp->rio_fd, rp->rio_buf, 
 			   sizeof(rp->rio_buf));
 	if (rp->rio_cnt < 0) {
-	    if (errno != EINTR) /* Interrupted by sig handler return */
+	    if (errno != EINTR && /* Interrupted by sig handler return */
+		rio_wait(rp->rio_fd, RIO_WAIT_READ) < 0)
 		return -1;
 	}
 	else if (rp->rio_cnt == 0)  /* EOF */
@@ -842,6 +924,53 @@ void rio_readinitb(rio_t *rp, int fd)
 }
 /* $end rio_readinitb */
 
+/*
+ * rio_fillb - Make sure rp's buffer holds unread bytes, reading once if
+ *     it is empty, so the caller can consume them in place at rio_bufptr
+ *     (advancing rio_bufptr/rio_cnt itself) instead of copying them out.
+ *     Returns the number of buffered bytes, 0 on EOF, -1 on error.
+ */
+ssize_t rio_fillb(rio_t *rp)
+{
+    char c;
+    ssize_t n;
+
+    if (rp->rio_cnt > 0)
+        return rp->rio_cnt;
+    if ((n = rio_read(rp, &c, 1)) <= 0)  /* Refill, then put the byte back */
+        return n;
+    rp->rio_bufptr--;
+    rp->rio_cnt++;
+    return rp->rio_cnt;
+}
+
+/*
+ * rio_fillmore - Read once more after the unread bytes, first moving them
+ *     to the front of the buffer, so a message that arrives in several
+ *     reads stays contiguous for in-place parsing.
+ *     Returns the number of bytes read, 0 on EOF, -1 on error or if the
+ *     buffer is already full (errno = EMSGSIZE).
+ */
+ssize_t rio_fillmore(rio_t *rp)
+{
+    ssize_t n;
+
+    if (rp->rio_cnt >= RIO_BUFSIZE) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    if (rp->rio_bufptr != rp->rio_buf) {
+        memmove(rp->rio_buf, rp->rio_bufptr, rp->rio_cnt);
+        rp->rio_bufptr = rp->rio_buf;
+    }
+    while ((n = read(rp->rio_fd, rp->rio_buf + rp->rio_cnt,
+                     RIO_BUFSIZE - rp->rio_cnt)) < 0)
+        if (errno != EINTR && rio_wait(rp->rio_fd, RIO_WAIT_READ) < 0)
+            return -1;
+    rp->rio_cnt += n;
+    return n;
+}
+
 /*
  * rio_readnb - Robustly read n bytes (buffered)
  */
@@ -864,32 +993,119 @@ ssize_t rio_readnb(rio_t *rp, void *usrbuf, size_t n)
 }
 /* $end rio_readnb */
 
+/*
+ * Line scanners for rio_readlineb - return a pointer to the first '\n'
+ *     in p[0..n), or NULL.  The SSE2/AVX2 versions compare 16/32 bytes
+ *     at a time; the one to use is picked from the CPU on first call
+ *     (rio_linescan can force one).
+ */
+static char *scan_nl_scalar(char *p, size_t n)
+{
+    for (; n > 0; p++, n--)
+        if (*p == '\n')
+            return p;
+    return NULL;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+__attribute__((target("sse2")))
+static char *scan_nl_sse2(char *p, size_t n)
+{
+    __m128i nl = _mm_set1_epi8('\n');
+    int mask;
+
+    for (; n >= 16; p += 16, n -= 16) {
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)p), nl));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+    return scan_nl_scalar(p, n);
+}
+
+__attribute__((target("avx2")))
+static char *scan_nl_avx2(char *p, size_t n)
+{
+    __m256i nl = _mm256_set1_epi8('\n');
+    unsigned int mask;
+
+    for (; n >= 32; p += 32, n -= 32) {
+        mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i *)p), nl));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+    return scan_nl_sse2(p, n);
+}
+#endif
+
+static char *scan_nl_pick(char *p, size_t n);
+static char *(*scan_nl)(char *p, size_t n) = scan_nl_pick;
+
+/* The first call resolves scan_nl (every thread picks the same one) */
+static char *scan_nl_pick(char *p, size_t n)
+{
+    rio_linescan(NULL);
+    return scan_nl(p, n);
+}
+
+/*
+ * rio_linescan - Select the line scanner: "scalar", "sse2", "avx2", or
+ *     NULL for the best one this CPU supports.  Returns the name of the
+ *     scanner now in use, or NULL if the named one is not supported.
+ */
+const char *rio_linescan(const char *name)
+{
+    char *(*fn)(char *, size_t) = scan_nl_scalar;
+    const char *got = "scalar";
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if ((name == NULL || !strcmp(name, "avx2")) && __builtin_cpu_supports("avx2")) {
+        fn = scan_nl_avx2;
+        got = "avx2";
+    }
+    else if ((name == NULL || !strcmp(name, "sse2")) && __builtin_cpu_supports("sse2")) {
+        fn = scan_nl_sse2;
+        got = "sse2";
+    }
+#endif
+    if (name != NULL && strcmp(name, got))
+        return NULL;
+    __atomic_store_n(&scan_nl, fn, __ATOMIC_RELAXED);
+    return got;
+}
+
 /* 
  * rio_readlineb - Robustly read a text line (buffered)
+ *     Finds the end of the line in the internal buffer with scan_nl and
+ *     copies the whole run at once instead of calling rio_read per byte.
  */
 /* $begin rio_readlineb */
 ssize_t rio_readlineb(rio_t *rp, void *usrbuf, size_t maxlen) 
 {
-    int n, rc;
-    char c, *bufp = usrbuf;
-
-    for (n = 1; n < maxlen; n++) { 
-        if ((rc = rio_read(rp, &c, 1)) == 1) {
-	    *bufp++ = c;
-	    if (c == '\n') {
-                n++;
-     		break;
-            }
-	} else if (rc == 0) {
-	    if (n == 1)
-		return 0; /* EOF, no data read */
-	    else
-		break;    /* EOF, some data was read */
-	} else
-	    return -1;	  /* Error */
+    size_t n = 0, cnt;
+    ssize_t rc;
+    char *bufp = usrbuf, *nl = NULL;
+
+    while (n + 1 < maxlen && nl == NULL) {
+        if ((rc = rio_fillb(rp)) < 0)
+            return -1;        /* Error */
+        else if (rc == 0)
+            break;            /* EOF */
+        cnt = rp->rio_cnt;
+        if (cnt > maxlen - 1 - n)
+            cnt = maxlen - 1 - n;
+        if ((nl = scan_nl(rp->rio_bufptr, cnt)) != NULL)
+            cnt = nl - rp->rio_bufptr + 1;  /* Up to and including '\n' */
+        memcpy(bufp + n, rp->rio_bufptr, cnt);
+        rp->rio_bufptr += cnt;
+        rp->rio_cnt -= cnt;
+        n += cnt;
     }
-    *bufp = 0;
-    return n-1;
+    if (maxlen > 0)
+        bufp[n] = 0;
+    return n;
 }
 /* $end rio_readlineb */
 
@@ -937,6 +1153,35 @@ ssize_t Rio_readlineb(rio_t *rp, void *usrbuf, size_t maxlen)
 /******************************** 
  * Client/server helper functions
  ********************************/
+/*
+ * connect_fd - connect() that, when a Rio wait hook is installed,
+ *     makes clientfd non-blocking and waits for the connection
+ *     through the hook instead of blocking the thread.
+ */
+static int connect_fd(int clientfd, SA *addr, socklen_t addrlen)
+{
+    int err, flags;
+    socklen_t len = sizeof(err);
+
+    if (rio_wait_hook == NULL)
+        return connect(clientfd, addr, addrlen);
+
+    if ((flags = fcntl(clientfd, F_GETFL, 0)) < 0 ||
+        fcntl(clientfd, F_SETFL, flags | O_NONBLOCK) < 0)
+        return -1;
+    if (connect(clientfd, addr, addrlen) == 0)
+        return 0;
+    if (errno != EINPROGRESS || rio_wait_hook(clientfd, RIO_WAIT_WRITE, -1) < 0)
+        return -1;
+    if (getsockopt(clientfd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+        return -1;
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
 /*
  * open_clientfd - Open connection to server at <hostname, port> and
  *     return a socket descriptor ready for reading and writing. This
@@ -968,7 +1213,7 @@ int open_clientfd(char *hostname, char *port) {
             continue; /* Socket failed, try the next */
 
         /* Connect to the server */
-        if (connect(clientfd, p->ai_addr, p->ai_addrlen) != -1) 
+        if (connect_fd(clientfd, p->ai_addr, p->ai_addrlen) != -1) 
             break; /* Success */
         if (close(clientfd) < 0) { /* Connect failed, try another */  //line:netp:openclientfd:closefd
             fprintf(stderr, "open_clientfd: close failed: %s\n", strerror(errno));
@@ -994,7 +1239,7 @@ int open_clientfd(char *hostname, char *port) {
  *       -1 with errno set for other errors.
  */
 /* $begin open_listenfd */
-int open_listenfd(char *port) 
+static int open_listenfd_opt(char *port, int reuseport)
 {
     struct addrinfo hints, *listp, *p;
     int listenfd, rc, optval=1;
@@ -1019,6 +1264,13 @@ int open_listenfd(char *port)
         setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR,    //line:netp:csapp:setsockopt
                    (const void *)&optval , sizeof(int));
 
+        /* Let each caller own a separate accept queue on the same port */
+        if (reuseport && setsockopt(listenfd, SOL_SOCKET, SO_REUSEPORT,
+                                    (const void *)&optval, sizeof(int)) < 0) {
+            close(listenfd);
+            continue;
+        }
+
         /* Bind the descriptor to the address */
         if (bind(listenfd, p->ai_addr, p->ai_addrlen) == 0)
             break; /* Success */
@@ -1041,8 +1293,23 @@ int open_listenfd(char *port)
     }
     return listenfd;
 }
+
+int open_listenfd(char *port) 
+{
+    return open_listenfd_opt(port, 0);
+}
 /* $end open_listenfd */
 
+/*
+ * open_reuseport_listenfd - Like open_listenfd, but sets SO_REUSEPORT
+ *     so that several sockets (one per event loop) can bind the same
+ *     port and the kernel load-balances incoming connections among them.
+ */
+int open_reuseport_listenfd(char *port)
+{
+    return open_listenfd_opt(port, 1);
+}
+
 /****************************************************
  * Wrappers for reentrant protocol-independent helpers
  ****************************************************/
@@ -1064,6 +1331,15 @@ int Open_listenfd(char *port)
     return rc;
 }
 
+int Open_reuseport_listenfd(char *port) 
+{
+    int rc;
+
+    if ((rc = open_reuseport_listenfd(port)) < 0)
+	unix_error("Open_reuseport_listenfd error");
+    return rc;
+}
+
 /* $end csapp.c */
 
 
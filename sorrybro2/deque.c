@@ -0,0 +1,133 @@
+/*
+ * deque.c - Chase-Lev work-stealing deque
+ *
+ * top/bottom은 계속 커지기만 하는 인덱스이고 배열 위치는 (인덱스 & (size-1)).
+ * top < bottom 이면 [top, bottom) 구간에 item이 들어있다.
+ */
+#include "deque.h"
+
+/* 배열 슬롯 읽기/쓰기: 도둑이 주인과 동시에 읽을 수 있어서 relaxed 원자 연산 */
+#define SLOT(a, i) (&(a)->buf[(i) & ((a)->size - 1)])
+
+/*
+ * array_new - size 슬롯짜리 배열 할당
+ */
+static deque_array_t *array_new(long size) {
+  deque_array_t *a = Malloc(sizeof(deque_array_t) + size * sizeof(void *));
+  a->size = size;
+  a->prev = NULL;
+  return a;
+}
+
+/*
+ * array_grow - [t, b) 구간을 두 배 크기 배열로 옮기고 바꿔 끼우기 (주인만 호출)
+ */
+static deque_array_t *array_grow(deque_t *dq, deque_array_t *a, long t, long b) {
+  deque_array_t *na = array_new(a->size * 2);
+  long i;
+
+  for (i = t; i < b; i++)
+    __atomic_store_n(SLOT(na, i), __atomic_load_n(SLOT(a, i), __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+  na->prev = a; // 예전 배열은 도둑이 아직 읽고 있을 수 있어서 바로 해제하지 않음
+  __atomic_store_n(&dq->array, na, __ATOMIC_RELEASE);
+  return na;
+}
+
+/*
+ * deque_init - size 슬롯짜리 빈 덱 만들기 (size는 2의 거듭제곱)
+ */
+void deque_init(deque_t *dq, long size) {
+  dq->top = 0;
+  dq->bottom = 0;
+  dq->array = array_new(size);
+}
+
+/*
+ * deque_deinit - 덱과 키우면서 남겨둔 예전 배열들까지 해제
+ */
+void deque_deinit(deque_t *dq) {
+  deque_array_t *a, *prev;
+
+  for (a = dq->array; a != NULL; a = prev) {
+    prev = a->prev;
+    Free(a);
+  }
+}
+
+/*
+ * deque_push - bottom에 item 넣기 (주인만, 가득 차면 배열을 두 배로)
+ */
+void deque_push(deque_t *dq, void *item) {
+  long b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+  long t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+  deque_array_t *a = __atomic_load_n(&dq->array, __ATOMIC_RELAXED);
+
+  if (b - t > a->size - 1) // 가득 참
+    a = array_grow(dq, a, t, b);
+  __atomic_store_n(SLOT(a, b), item, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE); // item을 쓴 뒤에 bottom이 보이도록
+  __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * deque_take - bottom에서 가장 최근에 넣은 item 꺼내기 (주인만)
+ *   마지막 하나를 도둑과 다툴 때는 top CAS로 정하고, 비었으면 NULL
+ */
+void *deque_take(deque_t *dq) {
+  long b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED) - 1;
+  deque_array_t *a = __atomic_load_n(&dq->array, __ATOMIC_RELAXED);
+  long t;
+  void *item = NULL;
+
+  // bottom을 먼저 줄여서 도둑들에게 "이 칸은 주인이 가져간다"고 알린 뒤 top 확인
+  __atomic_store_n(&dq->bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  t = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+
+  if (t <= b) { // 비어있지 않음
+    item = __atomic_load_n(SLOT(a, b), __ATOMIC_RELAXED);
+    if (t == b) { // 마지막 하나: 도둑과 경쟁, top을 먼저 올린 쪽이 가져감
+      if (!__atomic_compare_exchange_n(&dq->top, &t, t + 1, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        item = NULL; // 도둑이 가져감
+      __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+  }
+  else { // 비어있음: bottom 원래대로
+    __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+  }
+  return item;
+}
+
+/*
+ * deque_steal - top에서 가장 오래된 item 훔치기 (아무 스레드나)
+ *   반환: 성공 1, 비었으면 0, 다른 도둑이나 주인과의 경쟁에서 지면 -1
+ */
+int deque_steal(deque_t *dq, void **item) {
+  long t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  long b = __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+  deque_array_t *a;
+  void *x;
+
+  if (t >= b)
+    return 0; // 비어있음
+
+  a = __atomic_load_n(&dq->array, __ATOMIC_ACQUIRE);
+  x = __atomic_load_n(SLOT(a, t), __ATOMIC_RELAXED);
+  if (!__atomic_compare_exchange_n(&dq->top, &t, t + 1, 0,
+                                   __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    return -1; // 다른 도둑이나 주인이 먼저 가져감
+  *item = x;
+  return 1;
+}
+
+/*
+ * deque_size - 덱에 들어있는 item 수 (다른 스레드가 보면 대략적인 값)
+ */
+long deque_size(deque_t *dq) {
+  long b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+  long t = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+  return b > t ? b - t : 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * deque.h - Chase-Lev work-stealing deque (lock 없는 작업 덱)
+ *
+ * 주인 스레드 하나만 bottom 쪽에서 push/take 하고 (LIFO),
+ * 다른 스레드들은 top 쪽에서 steal 한다 (FIFO, 가장 오래된 작업부터).
+ * 주인의 push/take는 원자적 연산 없이 끝나고, 마지막 하나를 두고
+ * 주인과 도둑이 경쟁할 때만 top에 CAS를 한다.
+ * (Chase & Lev 2005, 메모리 순서는 Le et al. 2013의 C11 버전을 따름)
+ */
+#ifndef __DEQUE_H__
+#define __DEQUE_H__
+
+#include "csapp.h"
+
+/* 원형 배열 (가득 차면 두 배 크기로 새로 만들어 바꿔 끼움) */
+typedef struct deque_array {
+  long size;                // 슬롯 개수 (2의 거듭제곱)
+  struct deque_array *prev; // 바꿔 끼우기 전 배열 (도둑이 아직 읽고 있을 수 있어 deinit 때 해제)
+  void *buf[];              // 작업 포인터들
+} deque_array_t;
+
+typedef struct {
+  long top;                 // 도둑들이 CAS로 올리는 쪽 (가장 오래된 작업)
+  char pad[64 - sizeof(long)]; // top과 bottom이 같은 캐시 라인에서 핑퐁하지 않도록
+  long bottom;              // 주인만 쓰는 쪽 (다음 push 위치)
+  deque_array_t *array;     // 현재 배열
+} deque_t;
+
+void deque_init(deque_t *dq, long size);
+/*
+  빈 덱 생성 (size: 처음 슬롯 개수, 2의 거듭제곱)
+*/
+
+void deque_deinit(deque_t *dq);
+/*
+  덱 해제 (더 이상 아무도 steal하지 않을 때만)
+*/
+
+void deque_push(deque_t *dq, void *item);
+/*
+  bottom에 item 추가 (주인 스레드만, 가득 차면 배열을 키움)
+*/
+
+void *deque_take(deque_t *dq);
+/*
+  bottom에서 가장 최근 item 꺼내기 (주인 스레드만)
+  반환: item, 비었으면 NULL
+*/
+
+int deque_steal(deque_t *dq, void **item);
+/*
+  top에서 가장 오래된 item 훔치기 (아무 스레드나)
+  반환: 훔쳤으면 1 (*item에 저장), 비었으면 0, 다른 스레드와 경쟁에서 졌으면 -1
+*/
+
+long deque_size(deque_t *dq);
+/*
+  덱에 든 item 개수 (다른 스레드가 보면 대략적인 값)
+*/
+
+#endif /* __DEQUE_H__ */
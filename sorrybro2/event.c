@@ -0,0 +1,575 @@
+/*
+ * event.c - epoll 기반 이벤트 루프 (-m event: 루프 1개, -m reactors: 코어마다 1개)
+ *
+ * handle_request -> read_request -> forward_request -> forward_response
+ * 순서로 스레드가 블록되며 진행하던 일을, 연결마다 상태(state)를 들고
+ * non-blocking 소켓 위에서 "할 수 있는 만큼 하고 EAGAIN이면 멈췄다가
+ * 다음 이벤트 때 이어서" 진행하는 상태 기계로 바꾼 것.
+ *
+ *   CS_READ_REQ   클라이언트 요청 헤더를 빈 줄까지 모으기 (read_request)
+ *   CS_CONNECTING 원서버로 non-blocking connect 완료 기다리기 (open_clientfd)
+ *   CS_SEND_REQ   만들어 둔 요청 메세지 보내기 (forward_request)
+ *   CS_RELAY      원서버 응답을 클라이언트로 중계 (forward_response)
+ *   CS_SEND_CACHED 캐시에 있던 응답 보내기 (serve_cached, 원서버 소켓 없음, 본문은 캐시 chunk에서 바로)
+ *
+ * GET 응답은 중계하면서 MAX_OBJECT_SIZE까지 복사해 두었다가(tee) 원서버가 닫을 때
+ * 온전한 200이면 공유 캐시에 넣는다. 다음 같은 요청은 connect 없이 캐시에서 보낸다.
+ *
+ * 소켓은 edge-triggered로 EPOLLIN|EPOLLOUT 둘 다 한 번만 등록해두고,
+ * 이벤트가 오면 conn_step이 현재 상태에서 EAGAIN이 날 때까지 진행한다.
+ * (EAGAIN까지 가야만 다음 edge가 보장되므로 중간에 멈추지 않는 것이 규칙)
+ * 관심 이벤트를 바꾸는 epoll_ctl이 연결당 fd마다 한 번뿐이라 syscall이 적다.
+ *
+ * reactors 모드에서는 루프마다 자기 CPU에 고정된 스레드, 자기 epoll,
+ * 자기 SO_REUSEPORT 듣기 소켓을 가진다. 커널이 연결을 듣기 소켓들에
+ * 나눠주므로 accept 경로에 공유 자료구조나 락이 전혀 없고,
+ * 연결은 받은 루프에서 끝날 때까지 처리된다.
+ * SIGUSR1을 보내면 루프별 카운터(accept 분포)를 출력한다.
+ */
+#include "proxy.h"
+#include <sys/epoll.h>
+
+#define MAXEVENTS 1024 // epoll_wait 한 번에 받을 최대 이벤트 수
+
+/* 연결 하나의 진행 상태 */
+typedef enum {
+  CS_READ_REQ,   // 클라이언트 요청 헤더 읽는 중
+  CS_CONNECTING, // 원서버로 connect 진행 중
+  CS_SEND_REQ,   // 원서버로 요청 보내는 중
+  CS_RELAY,      // 원서버 응답을 클라이언트로 중계 중
+  CS_SEND_CACHED, // 캐시에서 고정한 응답(hit)을 클라이언트로 보내는 중
+  CS_DONE        // 끝남 (이번 이벤트 묶음 처리 후 해제)
+} conn_state_t;
+
+/* 이벤트 루프 하나 (카운터는 그 루프 스레드만 쓰고, 통계 출력 때만 다른 스레드가 읽음) */
+typedef struct evloop {
+  int id;                 // 루프 번호 (reactors 모드에서는 고정된 CPU 번호이기도 함)
+  int epfd;               // 이 루프의 epoll 인스턴스
+  int listenfd;           // 이 루프가 accept하는 듣기 소켓
+  struct conn *done_list; // 이번 이벤트 묶음에서 끝난 연결들
+  unsigned long accepts;  // 받은 연결 수
+  unsigned long active;   // 지금 처리 중인 연결 수
+  unsigned long requests; // 원서버로 보낸 요청 수
+} __attribute__((aligned(64))) evloop_t; // 루프끼리 같은 캐시 라인을 쓰지 않도록
+
+/* 카운터 증감: 쓰는 스레드는 하나뿐이라 lock 없는 relaxed store로 충분 */
+#define STAT_ADD(x, d) __atomic_store_n(&(x), (x) + (d), __ATOMIC_RELAXED)
+
+/* 연결 하나 = 클라이언트 소켓 + 원서버 소켓 + 버퍼 하나 */
+typedef struct conn {
+  evloop_t *loop;          // 이 연결을 처리하는 루프
+  int clientfd;            // 클라이언트 소켓
+  int serverfd;            // 원서버 소켓 (-1이면 아직 없음)
+  conn_state_t state;      // 현재 상태
+  struct addrinfo *ailist; // getaddrinfo 결과 (connect 실패 시 다음 주소 시도용)
+  struct addrinfo *ai;     // 지금 connect 시도 중인 주소
+  size_t len;              // buf에 들어있는 바이트 수
+  size_t off;              // buf에서 이미 보낸 바이트 수
+  http_parser_t hp;        // 요청 헤더 파서 (읽은 만큼씩 이어서 파싱)
+  char *key;               // 캐시 키 (arena 안, 캐시할 수 없는 요청이면 NULL)
+  char *obj;               // 캐시에 넣으려고 모으는 응답 (CS_RELAY)
+  size_t objlen;           // obj에 들어있는 바이트 수
+  cobj_t *hit;             // 캐시에서 고정한 응답 (CS_SEND_CACHED, 닫을 때 놓음)
+  size_t hitsize;          // hit 객체 크기
+  size_t body;             // hit에서 본문이 시작하는 곳
+  char *head;              // hit를 보낼 때 고친 헤더 (arena 안, 길이는 len)
+  arena_t arena;           // 파싱한 헤더 배열 (연결을 닫을 때 한꺼번에 해제)
+  struct conn *next_done;  // 해제 대기 리스트 링크
+  char buf[MAXBUF];        // 요청 읽기 -> 요청 보내기 -> 응답 중계 순서로 재사용
+  char arena_buf[REQUEST_ARENA]; // arena의 처음 블록
+} conn_t;
+
+static evloop_t *loops;            // 모든 루프 (통계 출력용)
+static int nloops;                 // 루프 개수
+static conn_t listen_marker;       // 듣기 소켓 이벤트 표시용 (data.ptr 비교)
+static volatile sig_atomic_t stats_requested; // SIGUSR1을 받으면 1
+
+static void conn_step(conn_t *c);
+static void start_connect(conn_t *c);
+
+/*
+ * set_nonblocking - fd를 non-blocking 모드로 전환
+ */
+static void set_nonblocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    unix_error("fcntl error");
+}
+
+/*
+ * watch - fd를 edge-triggered 읽기/쓰기 관심으로 epoll에 등록
+ */
+static int watch(int fd, conn_t *c) {
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  ev.data.ptr = c;
+  return epoll_ctl(c->loop->epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/*
+ * conn_close - 연결 종료: 소켓을 닫고 해제 대기 리스트에 넣기
+ *   (같은 이벤트 묶음에 이 연결의 다른 fd 이벤트가 남아있을 수 있어서 바로 free하지 않음)
+ */
+static void conn_close(conn_t *c) {
+  if (c->state == CS_DONE)
+    return;
+  c->state = CS_DONE;
+  close(c->clientfd); // close하면 epoll에서도 자동으로 빠짐
+  if (c->serverfd >= 0)
+    close(c->serverfd);
+  if (c->ailist)
+    freeaddrinfo(c->ailist);
+  if (c->obj)
+    Free(c->obj);
+  if (c->hit)
+    cache_unpin(c->hit);
+  arena_reset(&c->arena);
+  c->next_done = c->loop->done_list;
+  c->loop->done_list = c;
+  STAT_ADD(c->loop->active, -1);
+}
+
+/*
+ * conn_error - 에러 응답을 보내고 연결 종료
+ */
+static void conn_error(conn_t *c, char *errnum, char *shortmsg, char *longmsg) {
+  clienterror(c->clientfd, errnum, shortmsg, longmsg);
+  conn_close(c);
+}
+
+/*
+ * tee - 중계한 응답을 캐시에 넣으려고 obj에 모으기 (MAX_OBJECT_SIZE를 넘으면 포기)
+ */
+static void tee(conn_t *c, char *p, size_t n) {
+  if (c->objlen + n > MAX_OBJECT_SIZE) {
+    Free(c->obj);
+    c->obj = NULL;
+    return;
+  }
+  memcpy(c->obj + c->objlen, p, n);
+  c->objlen += n;
+}
+
+/*
+ * send_hit - 캐시에 있으면 고정하고 헤더를 만들어서 CS_SEND_CACHED로 (반환: 적중이면 1)
+ */
+static int send_hit(conn_t *c) {
+  int n;
+
+  if ((c->hit = cache_pin(c->key, &c->hitsize)) == NULL)
+    return 0;
+  c->head = arena_alloc(&c->arena, MAXBUF + MAXLINE);
+  if ((n = cached_head(c->hit, c->hitsize, 0, c->head, &c->body)) < 0) {
+    cache_unpin(c->hit);
+    c->hit = NULL;
+    return 0;
+  }
+  printf("Cache hit: %s\n", c->key);
+  c->len = n;
+  c->off = 0;
+  c->state = CS_SEND_CACHED;
+  return 1;
+}
+
+/*
+ * write_hit - 고정한 캐시 응답에서 c->off 이후를 writev 한 번으로 (헤더는 c->head, 본문은 캐시 chunk)
+ *   반환: writev 결과
+ */
+static ssize_t write_hit(conn_t *c) {
+  struct iovec iov[1 + CACHE_MAX_IOV];
+  int n = 0;
+
+  if (c->off < c->len) {
+    iov[0].iov_base = c->head + c->off;
+    iov[0].iov_len = c->len - c->off;
+    n = 1;
+  }
+  n += cache_iov(c->hit, c->body + (c->off > c->len ? c->off - c->len : 0), iov + n, CACHE_MAX_IOV);
+  return writev(c->clientfd, iov, n);
+}
+
+/*
+ * start_request - 모인 요청 헤더로 원서버 요청을 만들고 connect 시작 (캐시에 있으면 바로 응답)
+ */
+static void start_request(conn_t *c) {
+  char host[MAX_HOST], port[MAX_PORT];
+  int n;
+
+  // 캐시 키는 요청을 덮어쓰기 전에 (prepare_request가 GET이 아니면 거름)
+  if (request_cacheable(&c->hp))
+    c->key = http_cache_key(&c->hp);
+
+  // 요청 작성 (클라이언트 요청은 이제 필요 없으므로 같은 buf에 덮어씀)
+  n = prepare_request(&c->hp, c->buf, sizeof(c->buf), host, port);
+  if (n == PREP_CLOSE) {
+    conn_close(c);
+    return;
+  }
+  if (n == PREP_BAD) {
+    conn_error(c, "400", "Bad Request", "Proxy could not parse the request");
+    return;
+  }
+  if (c->key && send_hit(c))
+    return;
+  c->len = n;
+  c->off = 0;
+
+  // 주소 찾기 (getaddrinfo는 블록되므로 DNS가 느리면 루프 전체가 멈춘다는 한계가 있음)
+  if (resolve_server(host, port, &c->ailist) < 0) {
+    c->ailist = NULL;
+    conn_error(c, "502", "Bad Gateway", "Proxy could not resolve the server");
+    return;
+  }
+  c->ai = c->ailist;
+  c->state = CS_CONNECTING;
+  start_connect(c);
+}
+
+/*
+ * start_connect - c->ai부터 차례로 non-blocking connect 시도
+ */
+static void start_connect(conn_t *c) {
+  for (; c->ai; c->ai = c->ai->ai_next) {
+    c->serverfd = socket(c->ai->ai_family, c->ai->ai_socktype | SOCK_NONBLOCK,
+                         c->ai->ai_protocol);
+    if (c->serverfd < 0)
+      continue; // 소켓 생성 실패 -> 다음 주소
+
+    if (watch(c->serverfd, c) < 0) { // EPOLLOUT이 오면 connect 완료(또는 실패)
+      close(c->serverfd);
+      c->serverfd = -1;
+      continue;
+    }
+    if (connect(c->serverfd, c->ai->ai_addr, c->ai->ai_addrlen) == 0 ||
+        errno == EINPROGRESS)
+      return; // 완료 여부는 conn_step의 CS_CONNECTING에서 확인
+
+    close(c->serverfd); // 즉시 실패 -> 다음 주소
+    c->serverfd = -1;
+  }
+  printf("Error connecting to server\n");
+  conn_error(c, "502", "Bad Gateway", "Proxy could not connect to the server");
+}
+
+/*
+ * conn_step - 현재 상태에서 EAGAIN이 날 때까지 진행
+ */
+static void conn_step(conn_t *c) {
+  ssize_t n;
+  int err;
+
+  while (1) {
+    switch (c->state) {
+    case CS_READ_REQ: // 요청 헤더 모으기
+      n = read(c->clientfd, c->buf + c->len, sizeof(c->buf) - 1 - c->len);
+      if (n < 0) {
+        if (errno == EINTR) // 시그널에 끊긴 것이면 다시 시도
+          break;
+        if (errno != EAGAIN) // EAGAIN이면 다음 edge까지 대기
+          conn_close(c);
+        return;
+      }
+      if (n == 0) { // 요청 도중에 끊김
+        conn_close(c);
+        return;
+      }
+      c->len += n;
+      n = http_parse(&c->hp, c->buf, c->len); // 새로 읽은 부분만 이어서 파싱
+      if (n > 0) // 빈 줄까지 다 모였으면 요청 시작
+        start_request(c);
+      else if (n == HTTP_PARSE_BAD)
+        conn_error(c, "400", "Bad Request", "Proxy could not parse the request");
+      else if (n == HTTP_PARSE_LARGE || c->len == sizeof(c->buf) - 1) // 헤더가 너무 많거나 버퍼가 찼는데 안 끝남
+        conn_error(c, "431", "Request Header Fields Too Large", "Request headers too large");
+      if (c->state == CS_DONE)
+        return;
+      break; // 아직 덜 모였으면 EAGAIN까지 계속 읽기, 다 모였으면 connect 진행
+
+    case CS_CONNECTING: // connect 결과 확인
+      // 진행 중인 소켓에 connect를 다시 부르면 완료 여부를 알 수 있음
+      // (SO_ERROR는 아직 진행 중일 때도 0이라 클라이언트 쪽 이벤트로 깨어나면 구분이 안 됨)
+      if (connect(c->serverfd, c->ai->ai_addr, c->ai->ai_addrlen) == 0)
+        err = 0;
+      else
+        err = errno;
+      if (err == EALREADY || err == EINPROGRESS) // 아직 진행 중
+        return;
+      if (err == EINTR)
+        break;
+      if (err != 0 && err != EISCONN) { // 이 주소는 실패 -> 다음 주소로
+        close(c->serverfd);
+        c->serverfd = -1;
+        c->ai = c->ai->ai_next;
+        start_connect(c);
+        return;
+      }
+      freeaddrinfo(c->ailist); // 연결 성공
+      c->ailist = c->ai = NULL;
+      c->state = CS_SEND_REQ;
+      break;
+
+    case CS_SEND_REQ: // 요청 보내기 (못 보낸 나머지는 다음 EPOLLOUT 때)
+      n = write(c->serverfd, c->buf + c->off, c->len - c->off);
+      if (n < 0) {
+        if (errno == EINTR)
+          break;
+        if (errno != EAGAIN)
+          conn_close(c);
+        return;
+      }
+      c->off += n;
+      if (c->off == c->len) { // 다 보냈으면 buf를 응답 중계용으로 비우기
+        printf("Request forwarded to server\n");
+        STAT_ADD(c->loop->requests, 1);
+        c->len = c->off = 0;
+        c->state = CS_RELAY;
+        if (c->key) { // 응답을 캐시에 넣을 수 있게 모으기 시작
+          c->obj = Malloc(MAX_OBJECT_SIZE);
+          c->objlen = 0;
+        }
+      }
+      break;
+
+    case CS_RELAY: // 응답 중계
+      if (c->off < c->len) { // 클라이언트에 아직 못 보낸 데이터부터
+        n = write(c->clientfd, c->buf + c->off, c->len - c->off);
+        if (n < 0) {
+          if (errno == EINTR)
+            break;
+          if (errno != EAGAIN) // EAGAIN = 클라이언트가 느림 -> 원서버 읽기도 멈춤 (backpressure)
+            conn_close(c);
+          return;
+        }
+        c->off += n;
+        break;
+      }
+      n = read(c->serverfd, c->buf, sizeof(c->buf)); // 버퍼가 비었으면 원서버에서 읽기
+      if (n < 0) {
+        if (errno == EINTR)
+          break;
+        if (errno != EAGAIN)
+          conn_close(c);
+        return;
+      }
+      if (n == 0) { // 원서버가 응답을 다 보내고 닫음
+        printf("Response forwarded to client\n");
+        if (c->obj && response_cacheable(c->obj, c->objlen)) // 끝까지 받은 200만
+          cache_put(c->key, c->obj, c->objlen);
+        conn_close(c);
+        return;
+      }
+      if (c->obj)
+        tee(c, c->buf, n);
+      c->len = n;
+      c->off = 0;
+      break;
+
+    case CS_SEND_CACHED: // 캐시 응답 보내기 (다 보내면 닫음, HTTP/1.0 close와 같게)
+      n = write_hit(c);
+      if (n < 0) {
+        if (errno == EINTR)
+          break;
+        if (errno != EAGAIN)
+          conn_close(c);
+        return;
+      }
+      c->off += n;
+      if (c->off == c->len + c->hitsize - c->body) {
+        conn_close(c);
+        return;
+      }
+      break;
+
+    case CS_DONE:
+      return;
+    }
+  }
+}
+
+/*
+ * accept_all - 듣기 소켓에 쌓인 연결을 EAGAIN이 날 때까지 모두 받기
+ */
+static void accept_all(evloop_t *loop) {
+  struct sockaddr_storage clientaddr;
+  socklen_t clientlen;
+  char hostname[MAXLINE], port[MAXLINE];
+  conn_t *c;
+  int connfd;
+
+  while (1) {
+    clientlen = sizeof(clientaddr);
+    connfd = accept(loop->listenfd, (SA *)&clientaddr, &clientlen);
+    if (connfd < 0) {
+      if (errno != EAGAIN && errno != EINTR) // EMFILE 등은 로그만 남기고 다음 기회에
+        fprintf(stderr, "accept error: %s\n", strerror(errno));
+      if (errno != EINTR)
+        return;
+      continue;
+    }
+    if (getnameinfo((SA *)&clientaddr, clientlen, hostname, MAXLINE,
+                    port, MAXLINE, 0) == 0)
+      printf("Accepted connection from (%s, %s)\n", hostname, port);
+
+    // accept한 소켓은 듣기 소켓의 O_NONBLOCK을 물려받지 않으므로 다시 설정
+    // (accept4는 csapp.h가 _GNU_SOURCE와 충돌해서 쓰지 않음)
+    if (fcntl(connfd, F_SETFL, O_NONBLOCK) < 0) {
+      close(connfd);
+      continue;
+    }
+
+    c = Malloc(sizeof(conn_t));
+    c->loop = loop;
+    c->clientfd = connfd;
+    c->serverfd = -1;
+    c->state = CS_READ_REQ;
+    c->ailist = c->ai = NULL;
+    c->len = c->off = 0;
+    c->key = c->obj = NULL;
+    c->hit = NULL;
+    arena_init(&c->arena, c->arena_buf, sizeof(c->arena_buf));
+    http_parser_init(&c->hp, &c->arena);
+    if (watch(connfd, c) < 0) {
+      close(connfd);
+      Free(c);
+      continue;
+    }
+    STAT_ADD(loop->accepts, 1);
+    STAT_ADD(loop->active, 1);
+    // 이미 요청이 도착해 있어도 edge가 등록 직후에 오므로 여기서 읽지 않아도 됨
+  }
+}
+
+/*
+ * print_stats - 루프별 카운터 출력 (accept가 루프들에 얼마나 고르게 퍼졌는지), 캐시 적중률
+ */
+static void print_stats(void) {
+  unsigned long accepts, total = 0;
+  int i;
+
+  for (i = 0; i < nloops; i++)
+    total += __atomic_load_n(&loops[i].accepts, __ATOMIC_RELAXED);
+  printf("loop  accepts  share   active  requests\n");
+  for (i = 0; i < nloops; i++) {
+    accepts = __atomic_load_n(&loops[i].accepts, __ATOMIC_RELAXED);
+    printf("%4d %8lu %5.1f%% %8lu %9lu\n", loops[i].id, accepts,
+           total ? 100.0 * accepts / total : 0.0,
+           __atomic_load_n(&loops[i].active, __ATOMIC_RELAXED),
+           __atomic_load_n(&loops[i].requests, __ATOMIC_RELAXED));
+  }
+  cache_stats();
+  fflush(stdout);
+}
+
+/*
+ * sigusr1_handler - 통계 출력 요청 표시만 하고, 출력은 루프가 EINTR로 깨어났을 때
+ */
+static void sigusr1_handler(int sig) {
+  stats_requested = 1;
+}
+
+/*
+ * loop_init - 루프 하나 초기화: epoll 만들고 듣기 소켓 등록
+ */
+static void loop_init(evloop_t *loop, int id, int listenfd) {
+  struct epoll_event ev;
+
+  memset(loop, 0, sizeof(*loop));
+  loop->id = id;
+  loop->listenfd = listenfd;
+  if ((loop->epfd = epoll_create1(0)) < 0)
+    unix_error("epoll_create1 error");
+  set_nonblocking(listenfd);
+  ev.events = EPOLLIN; // 듣기 소켓은 level-triggered (accept_all이 EAGAIN까지 받음)
+  ev.data.ptr = &listen_marker;
+  if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, listenfd, &ev) < 0)
+    unix_error("epoll_ctl error");
+}
+
+/*
+ * loop_run - 이벤트 루프 본체 (반환하지 않음)
+ */
+static void loop_run(evloop_t *loop) {
+  struct epoll_event events[MAXEVENTS];
+  conn_t *c;
+  int i, n;
+
+  while (1) {
+    n = epoll_wait(loop->epfd, events, MAXEVENTS, -1);
+    if (n < 0) {
+      if (errno != EINTR)
+        unix_error("epoll_wait error");
+      if (stats_requested) { // 시그널을 받은 루프가 대표로 출력
+        stats_requested = 0;
+        print_stats();
+      }
+      continue;
+    }
+    for (i = 0; i < n; i++) {
+      c = events[i].data.ptr;
+      if (c == &listen_marker)
+        accept_all(loop);
+      else
+        conn_step(c); // 어느 fd의 이벤트든 현재 상태에서 할 수 있는 만큼 진행
+    }
+    while (loop->done_list) { // 끝난 연결 해제
+      c = loop->done_list;
+      loop->done_list = c->next_done;
+      Free(c);
+    }
+  }
+}
+
+/*
+ * loops_alloc - 캐시 라인에 정렬된 루프 배열 할당
+ */
+static void loops_alloc(int n) {
+  void *p;
+  int rc;
+
+  if ((rc = posix_memalign(&p, 64, n * sizeof(evloop_t))) != 0)
+    posix_error(rc, "posix_memalign error");
+  loops = p;
+  nloops = n;
+  Signal(SIGUSR1, sigusr1_handler);
+}
+
+/*
+ * event_loop - 단일 이벤트 루프 (-m event)
+ */
+void event_loop(int listenfd) {
+  loops_alloc(1);
+  loop_init(&loops[0], 0, listenfd);
+  printf("Event loop: %zu bytes per connection\n", sizeof(conn_t));
+  loop_run(&loops[0]);
+}
+
+/*
+ * reactor_thread - reactors 모드의 루프 스레드: 자기 CPU에 고정 후 루프 실행
+ */
+static void *reactor_thread(void *vargp) {
+  evloop_t *loop = vargp;
+  int rc;
+
+  if ((rc = pin_to_cpu(loop->id % online_cpus())) != 0)
+    fprintf(stderr, "loop %d: pin_to_cpu failed: %s\n", loop->id, strerror(rc));
+  loop_run(loop);
+  return NULL;
+}
+
+/*
+ * event_reactors - 코어마다 이벤트 루프 하나 (-m reactors)
+ *   루프마다 SO_REUSEPORT 듣기 소켓을 따로 열어서 accept 큐부터 분리
+ */
+void event_reactors(char *port, int n) {
+  pthread_t tid;
+  int i;
+
+  loops_alloc(n);
+  for (i = 0; i < n; i++) // 포트 문제는 스레드를 만들기 전에 여기서 바로 드러나도록
+    loop_init(&loops[i], i, Open_reuseport_listenfd(port));
+  printf("Reactors: %d loops, %zu bytes per connection (kill -USR1 %d for stats)\n",
+         n, sizeof(conn_t), (int)getpid());
+  for (i = 1; i < n; i++)
+    Pthread_create(&tid, NULL, reactor_thread, &loops[i]);
+  reactor_thread(&loops[0]); // 0번 루프는 메인 스레드가 직접 돌림
+}
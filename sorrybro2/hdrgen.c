@@ -0,0 +1,68 @@
+/*
+ * hdrgen.c - headers.def의 헤더 이름들에 대한 완전 해시 표(hdrtab.h)를 만드는 빌드 도구
+ *
+ * header_hash(seed, 이름)의 아래 비트로 슬롯을 정할 때 이름끼리 겹치지 않는 seed를
+ * 찾는다. 슬롯 수는 이름 수의 두 배 이상인 2의 거듭제곱부터 시작해서, 못 찾으면
+ * 두 배로 늘린다. 대소문자만 다른 이름이 목록에 두 번 있으면 실패.
+ *
+ * 사용법: ./hdrgen > hdrtab.h (Makefile이 headers.def가 바뀌면 다시 만듦)
+ */
+#define HDRGEN
+#include <stdio.h>
+#include <stdlib.h>
+#include "header.h"
+
+#define MAX_SEEDS (1u << 24) // 슬롯 수 하나당 시도할 seed 수
+
+/*
+ * try_seed - 이 seed와 슬롯 수로 모든 이름이 다른 슬롯에 가면 slots를 채우고 1
+ */
+static int try_seed(unsigned int seed, unsigned int nslots, unsigned char *slots) {
+  unsigned int h;
+  int id;
+
+  memset(slots, 0, nslots);
+  for (id = 1; id < HDR_COUNT; id++) {
+    h = header_hash(seed, header_names[id], header_lens[id]) & (nslots - 1);
+    if (slots[h])
+      return 0;
+    slots[h] = id;
+  }
+  return 1;
+}
+
+int main(void) {
+  static unsigned char slots[1 << 16];
+  unsigned int nslots, seed, i;
+  int a, b;
+
+  if (HDR_COUNT > 256) { // 슬롯 표가 unsigned char
+    fprintf(stderr, "hdrgen: too many headers\n");
+    return 1;
+  }
+  for (a = 1; a < HDR_COUNT; a++)
+    for (b = a + 1; b < HDR_COUNT; b++)
+      if (!strcasecmp(header_names[a], header_names[b])) {
+        fprintf(stderr, "hdrgen: duplicate header %s\n", header_names[a]);
+        return 1;
+      }
+  for (nslots = 2; nslots < 2 * (HDR_COUNT - 1); nslots *= 2)
+    ;
+  for (; nslots <= sizeof(slots); nslots *= 2)
+    for (seed = 1; seed < MAX_SEEDS; seed++)
+      if (try_seed(seed, nslots, slots))
+        goto found;
+  fprintf(stderr, "hdrgen: no perfect hash found\n");
+  return 1;
+
+found:
+  printf("/* hdrtab.h - generated by hdrgen from headers.def, do not edit */\n");
+  printf("#define HDR_SEED %#xu\n", seed);
+  printf("#define HDR_NSLOTS %u\n\n", nslots);
+  printf("/* header_hash(HDR_SEED, 이름) & (HDR_NSLOTS - 1) -> id (빈 슬롯은 HDR_UNKNOWN) */\n");
+  printf("static const unsigned char hdr_slots[HDR_NSLOTS] = {");
+  for (i = 0; i < nslots; i++)
+    printf("%s%u,", i % 16 ? " " : "\n  ", slots[i]);
+  printf("\n};\n");
+  return 0;
+}
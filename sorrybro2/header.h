@@ -0,0 +1,78 @@
+/*
+ * header.h - HTTP 헤더 이름 -> header_id_t 분류 (프록시와 tiny가 같이 씀)
+ *
+ * 알아볼 헤더 목록은 headers.def에 있고, 빌드할 때 hdrgen이 그 목록에 대해
+ * 충돌 없는 해시 seed와 슬롯 표를 찾아 hdrtab.h로 만든다. 그래서
+ * header_lookup은 알아볼 헤더가 몇 개든 해시 한 번 + 이름 비교 한 번으로 끝남
+ * (strncasecmp를 헤더마다 줄줄이 부르던 것 대신).
+ *
+ * 대소문자는 해시할 때 바이트에 0x20을 OR해서 접고, 마지막 비교는 strncasecmp로 한다.
+ * 함수와 표는 모두 static이라 오브젝트 파일 없이 include만 하면 됨.
+ */
+#ifndef __HEADER_H__
+#define __HEADER_H__
+
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+
+typedef enum {
+  HDR_UNKNOWN, // 목록에 없는 헤더
+#define HEADER(id, name) id,
+#include "headers.def"
+#undef HEADER
+  HDR_COUNT
+} header_id_t;
+
+/* id -> 표준 표기 이름 / 길이 */
+static const char *const header_names[HDR_COUNT] = {
+  NULL,
+#define HEADER(id, name) name,
+#include "headers.def"
+#undef HEADER
+};
+
+static const unsigned char header_lens[HDR_COUNT] = {
+  0,
+#define HEADER(id, name) sizeof(name) - 1,
+#include "headers.def"
+#undef HEADER
+};
+
+/*
+ * header_hash - 대소문자를 접은 이름의 해시 (FNV-1a, seed는 hdrgen이 고름)
+ */
+static inline unsigned int header_hash(unsigned int seed, const char *name, size_t len) {
+  unsigned int h = seed ^ (unsigned int)len;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    h = (h ^ ((unsigned char)name[i] | 0x20)) * 16777619u;
+  return h ^ (h >> 15);
+}
+
+#ifndef HDRGEN // hdrgen 자신은 아직 표가 없음
+#include "hdrtab.h"
+
+/*
+ * header_lookup - 헤더 이름 name[0..len)의 id (목록에 없으면 HDR_UNKNOWN)
+ */
+static inline header_id_t header_lookup(const char *name, size_t len) {
+  header_id_t id = hdr_slots[header_hash(HDR_SEED, name, len) & (HDR_NSLOTS - 1)];
+
+  if (id != HDR_UNKNOWN && header_lens[id] == len && strncasecmp(header_names[id], name, len) == 0)
+    return id;
+  return HDR_UNKNOWN;
+}
+
+/*
+ * header_line_id - "Name: value" 헤더 줄 하나의 id (':'가 없으면 HDR_UNKNOWN)
+ */
+static inline header_id_t header_line_id(const char *line, size_t len) {
+  const char *colon = memchr(line, ':', len);
+
+  return colon ? header_lookup(line, colon - line) : HDR_UNKNOWN;
+}
+#endif
+
+#endif /* __HEADER_H__ */
@@ -0,0 +1,274 @@
+/*
+ * idle.c - 다음 요청을 기다리는 keep-alive 연결을 맡아두는 poller (-m pool, steal)
+ *
+ * 워커 스레드가 응답을 끝낸 연결에서 다음 요청을 poll로 기다리면, 놀고 있는
+ * keep-alive 클라이언트 몇 개만으로 워커가 모두 묶여서 새 클라이언트가 줄을 선다.
+ * 그래서 다음 요청이 아직 안 와 있으면 워커는 그 연결을 idle_park로 이 파일의
+ * epoll 스레드 하나에 맡기고 바로 다음 일로 간다. 소켓이 읽을 수 있게 되면
+ * 스레드가 connfd를 연결 큐(sbuf)에 다시 넣고, 그걸 꺼낸 워커는 idle_claim으로
+ * 맡겨뒀던 상태(Rio 버퍼, 요청 수 등)를 돌려받아 이어서 처리한다.
+ * KEEPALIVE_TIMEOUT 안에 아무것도 안 오면 스레드가 drop 콜백으로 정리한다.
+ * 연결 큐가 가득 차 있으면 기다리지 않고(그동안 마감과 새로 맡길 연결도 봐야 하므로)
+ * 따로 줄 세워 두었다가 RETRY_MS마다 다시 넣어본다.
+ *
+ * 맡길 연결은 tunnel.c처럼 mutex로 보호되는 목록에 넣고 eventfd로 깨워서,
+ * epoll 등록과 대기 목록은 idle 스레드만 만진다. 마감은 넘겨받은 시각 +
+ * KEEPALIVE_TIMEOUT이라 넘겨받은 순서대로 목록 끝에 붙이면 맨 앞만 보면 된다.
+ */
+#include "proxy.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#define MAXEVENTS 256
+#define RETRY_MS 10 // 연결 큐가 가득 차서 못 넣은 연결을 다시 넣어보는 주기
+
+/* 맡은 연결 하나 (epoll에는 이 구조체 주소를 등록, wakefd는 NULL) */
+typedef struct parked {
+  int fd;                     // 클라이언트 소켓
+  void *item;                 // 엔진의 연결 상태 (pool: request_t, steal: task_t)
+  long deadline;              // 이때까지 아무것도 안 오면 정리 (ms)
+  struct parked *prev, *next; // 대기 목록 (deadline 순), 넘겨받기 전에는 pending 링크
+} parked_t;
+
+static sbuf_t *queue;            // 읽을 수 있게 된 connfd를 다시 넣을 연결 큐
+static void (*wake)(void);       // 큐에 넣은 뒤 부를 함수 (없으면 NULL)
+static void (*drop)(void *item); // 시간이 다 된 연결 정리 (connfd 닫기까지)
+static int epfd, wakefd;
+static parked_t *pending;        // 넘겨받을 연결들 (pending_mutex)
+static pthread_mutex_t pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+static parked_t *head, *tail;    // 대기 목록, idle 스레드만 만짐
+static parked_t *full_head, *full_tail; // 읽을 수 있는데 연결 큐가 가득 차서 못 넣은 연결들 (next로 연결)
+static void **ready;             // fd -> 큐에 다시 넣은 연결의 상태 (idle_claim이 꺼냄)
+static int maxfds;               // ready 크기 (RLIMIT_NOFILE)
+static unsigned long parks, wakes, timeouts, deferred; // 통계
+
+/*
+ * now_ms - 단조 시계 (ms)
+ */
+static long now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * unpark - epoll과 대기 목록에서 빼기
+ */
+static void unpark(parked_t *p) {
+  epoll_ctl(epfd, EPOLL_CTL_DEL, p->fd, NULL);
+  if (p->prev)
+    p->prev->next = p->next;
+  else
+    head = p->next;
+  if (p->next)
+    p->next->prev = p->prev;
+  else
+    tail = p->prev;
+}
+
+/*
+ * adopt - 넘겨받은 연결들을 epoll에 등록하고 대기 목록 끝에 붙이기
+ *   (등록할 때 이미 읽을 것이 있으면 level-triggered라 바로 다음 epoll_wait에 옴)
+ */
+static void adopt(void) {
+  struct epoll_event ev;
+  uint64_t cnt;
+  parked_t *p, *next, *list = NULL;
+  long now = now_ms();
+
+  if (read(wakefd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN)
+    unix_error("eventfd read error");
+  pthread_mutex_lock(&pending_mutex);
+  p = pending;
+  pending = NULL;
+  pthread_mutex_unlock(&pending_mutex);
+  for (; p; p = next) { // pending은 거꾸로 쌓였으므로 뒤집어서 맡긴 순서대로
+    next = p->next;
+    p->next = list;
+    list = p;
+  }
+
+  for (p = list; p; p = next) {
+    next = p->next;
+    ev.events = EPOLLIN;
+    ev.data.ptr = p;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, p->fd, &ev) < 0) { // 기다릴 수 없으면 바로 정리
+      __atomic_add_fetch(&timeouts, 1, __ATOMIC_RELAXED);
+      drop(p->item);
+      Free(p);
+      continue;
+    }
+    p->deadline = now + KEEPALIVE_TIMEOUT;
+    p->prev = tail;
+    p->next = NULL;
+    if (tail)
+      tail->next = p;
+    else
+      head = p;
+    tail = p;
+  }
+}
+
+/*
+ * requeue - 읽을 수 있게 된 연결을 연결 큐에 다시 넣기 (기다리지 않음)
+ *   반환: 넣었으면 1 (p는 해제됨), 큐가 가득 찼으면 0
+ */
+static int requeue(parked_t *p) {
+  ready[p->fd] = p->item; // sbuf의 mutex를 지나서 꺼내는 워커에게 보임
+  if (!sbuf_tryinsert(queue, p->fd)) {
+    ready[p->fd] = NULL;  // 아직 아무도 못 꺼냄
+    return 0;
+  }
+  if (wake)
+    wake();
+  __atomic_add_fetch(&wakes, 1, __ATOMIC_RELAXED);
+  Free(p);
+  return 1;
+}
+
+/*
+ * defer - 연결 큐가 가득 차서 못 넣은 연결을 줄 끝에 세우기 (다음에 먼저 넣어봄)
+ */
+static void defer(parked_t *p) {
+  __atomic_add_fetch(&deferred, 1, __ATOMIC_RELAXED);
+  p->next = NULL;
+  if (full_tail)
+    full_tail->next = p;
+  else
+    full_head = p;
+  full_tail = p;
+}
+
+/*
+ * retry_full - 줄 세워 둔 연결들을 온 순서대로 다시 넣어보기 (큐가 또 차면 거기서 멈춤)
+ */
+static void retry_full(void) {
+  parked_t *p, *next;
+
+  while ((p = full_head) != NULL) {
+    next = p->next;
+    if (!requeue(p))
+      return;
+    full_head = next;
+  }
+  full_tail = NULL;
+}
+
+/*
+ * idle_loop - idle 스레드: 읽을 수 있게 된 연결은 연결 큐로 돌려보내고, 마감이 지난 연결은 정리
+ */
+static void *idle_loop(void *vargp) {
+  struct epoll_event events[MAXEVENTS];
+  parked_t *p;
+  long now, left;
+  int i, n;
+
+  Pthread_detach(pthread_self());
+  while (1) {
+    left = head ? head->deadline - now_ms() : -1;
+    if (left < 0 && head)
+      left = 0;
+    if (full_head && (left < 0 || left > RETRY_MS)) // 못 넣은 연결이 있으면 자주 다시 봄
+      left = RETRY_MS;
+    n = epoll_wait(epfd, events, MAXEVENTS, (int)left);
+    if (n < 0 && errno != EINTR)
+      unix_error("epoll_wait error");
+    retry_full();
+    for (i = 0; i < n; i++) {
+      if ((p = events[i].data.ptr) == NULL) {
+        adopt();
+        continue;
+      }
+      unpark(p);
+      if (full_head || !requeue(p)) // 앞에 줄 선 연결이 있으면 순서를 지켜서 뒤에
+        defer(p);
+    }
+    now = now_ms();
+    while ((p = head) != NULL && p->deadline <= now) { // idle timeout
+      unpark(p);
+      __atomic_add_fetch(&timeouts, 1, __ATOMIC_RELAXED);
+      drop(p->item);
+      Free(p);
+    }
+  }
+  return NULL;
+}
+
+/*
+ * idle_start - epoll 인스턴스, eventfd, idle 스레드 만들기
+ */
+void idle_start(sbuf_t *sp, void (*wakefn)(void), void (*dropfn)(void *item)) {
+  struct epoll_event ev;
+  struct rlimit rl;
+  pthread_t tid;
+
+  queue = sp;
+  wake = wakefn;
+  drop = dropfn;
+  if (getrlimit(RLIMIT_NOFILE, &rl) < 0)
+    unix_error("getrlimit error");
+  maxfds = rl.rlim_cur == RLIM_INFINITY ? 1 << 20 : rl.rlim_cur;
+  ready = Calloc(maxfds, sizeof(void *));
+  if ((epfd = epoll_create1(0)) < 0)
+    unix_error("epoll_create1 error");
+  if ((wakefd = eventfd(0, EFD_NONBLOCK)) < 0)
+    unix_error("eventfd error");
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev) < 0)
+    unix_error("epoll_ctl error");
+  Pthread_create(&tid, NULL, idle_loop, NULL);
+}
+
+/*
+ * idle_park - 다음 요청을 기다리는 연결을 idle 스레드에 맡기기 (워커는 바로 돌아감)
+ */
+void idle_park(int fd, void *item) {
+  uint64_t one = 1;
+  parked_t *p;
+
+  if (fd >= maxfds) { // ready 범위 밖 (RLIMIT_NOFILE을 넘는 일은 없어야 함)
+    drop(item);
+    return;
+  }
+  p = Malloc(sizeof(parked_t));
+  p->fd = fd;
+  p->item = item;
+  __atomic_add_fetch(&parks, 1, __ATOMIC_RELAXED);
+
+  pthread_mutex_lock(&pending_mutex);
+  p->next = pending;
+  pending = p;
+  pthread_mutex_unlock(&pending_mutex);
+  if (write(wakefd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    unix_error("eventfd write error");
+}
+
+/*
+ * idle_claim - 연결 큐에서 꺼낸 connfd가 idle 스레드가 돌려보낸 것이면 맡겼던 상태를 꺼내기
+ *   (새로 accept한 연결이면 NULL)
+ */
+void *idle_claim(int fd) {
+  void *item;
+
+  if (fd < 0 || fd >= maxfds)
+    return NULL;
+  item = ready[fd];
+  ready[fd] = NULL;
+  return item;
+}
+
+/*
+ * idle_stats - 맡은 연결 수와 카운터 출력
+ */
+void idle_stats(void) {
+  unsigned long p = __atomic_load_n(&parks, __ATOMIC_RELAXED);
+  unsigned long w = __atomic_load_n(&wakes, __ATOMIC_RELAXED);
+  unsigned long t = __atomic_load_n(&timeouts, __ATOMIC_RELAXED);
+  unsigned long d = __atomic_load_n(&deferred, __ATOMIC_RELAXED);
+
+  printf("idle: %lu parked, %lu woken, %lu idle timeouts, %lu deferred (queue full)\n", p - w - t, w, t, d);
+}
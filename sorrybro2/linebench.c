@@ -0,0 +1,123 @@
+/*
+ * linebench.c - rio_readlineb 마이크로벤치마크 (make linebench; ./linebench [MB])
+ *
+ * 응답 헤더처럼 생긴 줄들로 Rio 버퍼를 채워두고 (read는 안 부름) 줄 단위로
+ * 다 읽는 것을 반복해서, 줄 읽기 자체의 처리량만 잰다.
+ *   bytewise  예전 rio_readlineb처럼 1바이트씩 꺼내서 '\n' 확인
+ *   scalar / sse2 / avx2   지금 rio_readlineb (rio_linescan으로 스캐너 고정)
+ */
+#include "csapp.h"
+#include <time.h>
+
+/* 한 번에 버퍼에 넣을 헤더 줄들 (실제 원서버 응답 헤더와 비슷한 길이) */
+static char *lines[] = {
+  "HTTP/1.1 200 OK\r\n",
+  "Date: Sat, 17 Oct 2026 09:12:44 GMT\r\n",
+  "Server: Apache/2.4.57 (Unix) OpenSSL/3.0.11\r\n",
+  "Last-Modified: Mon, 12 Oct 2026 18:03:51 GMT\r\n",
+  "ETag: \"3f2a-5c1e7b9d4a2f0\"\r\n",
+  "Accept-Ranges: bytes\r\n",
+  "Content-Length: 16170\r\n",
+  "Cache-Control: public, max-age=86400, stale-while-revalidate=600\r\n",
+  "Vary: Accept-Encoding, Origin\r\n",
+  "Content-Type: text/html; charset=UTF-8\r\n",
+  "Set-Cookie: session=8c1f0a6e2b7d4c93a5e1f0b2d3c4a5b6; Path=/; HttpOnly; Secure\r\n",
+  "Strict-Transport-Security: max-age=63072000; includeSubDomains; preload\r\n",
+  "X-Content-Type-Options: nosniff\r\n",
+  "Keep-Alive: timeout=5, max=100\r\n",
+  "Connection: Keep-Alive\r\n",
+  "\r\n",
+};
+
+/*
+ * bytewise_readlineb - 예전 rio_readlineb (rio_read를 바이트마다 부르던 것)
+ *   rio_read는 csapp.c 안의 static이라 같은 일을 하는 rio_readnb(rp, &c, 1)로
+ */
+static ssize_t bytewise_readlineb(rio_t *rp, void *usrbuf, size_t maxlen) {
+  int n, rc;
+  char c, *bufp = usrbuf;
+
+  for (n = 1; n < maxlen; n++) {
+    if ((rc = rio_readnb(rp, &c, 1)) == 1) {
+      *bufp++ = c;
+      if (c == '\n') {
+        n++;
+        break;
+      }
+    }
+    else if (rc == 0) {
+      if (n == 1)
+        return 0;
+      break;
+    }
+    else
+      return -1;
+  }
+  *bufp = 0;
+  return n - 1;
+}
+
+/*
+ * run - block을 버퍼에 다시 채우고 줄 단위로 다 읽기를 total 바이트만큼 반복
+ *   반환: 걸린 시간 (초)
+ */
+static double run(char *block, size_t blen, size_t total, int bytewise) {
+  struct timespec t0, t1;
+  char line[MAXLINE];
+  rio_t rio;
+  size_t done = 0;
+  ssize_t n;
+
+  rio_readinitb(&rio, -1); // 버퍼가 빌 때까지만 읽으므로 fd는 안 씀
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  while (done < total) {
+    memcpy(rio.rio_buf, block, blen);
+    rio.rio_bufptr = rio.rio_buf;
+    rio.rio_cnt = blen;
+    while (rio.rio_cnt > 0) {
+      n = bytewise ? bytewise_readlineb(&rio, line, MAXLINE) : rio_readlineb(&rio, line, MAXLINE);
+      if (n <= 0 || line[n - 1] != '\n') {
+        fprintf(stderr, "short line\n");
+        exit(1);
+      }
+    }
+    done += blen;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv) {
+  static char *scanners[] = {"scalar", "sse2", "avx2"};
+  char block[RIO_BUFSIZE];
+  size_t blen = 0, len, total, nlines = 0;
+  double sec, base;
+  int i;
+
+  total = (argc > 1 ? atol(argv[1]) : 256) << 20;
+  // 헤더 줄들을 버퍼가 차기 직전까지 반복해서 채움 (줄이 버퍼 경계에 걸리지 않게)
+  for (i = 0;; i = (i + 1) % (sizeof(lines) / sizeof(lines[0]))) {
+    len = strlen(lines[i]);
+    if (blen + len > sizeof(block))
+      break;
+    memcpy(block + blen, lines[i], len);
+    blen += len;
+    nlines++;
+  }
+  printf("%zu-byte buffer, %zu lines (avg %zu bytes), %zu MB per run\n", blen, nlines, blen / nlines,
+         total >> 20);
+
+  base = run(block, blen, total, 1);
+  printf("%-9s %8.1f MB/s %8.2f Mlines/s\n", "bytewise", total / base / 1e6,
+         total / blen * nlines / base / 1e6);
+  for (i = 0; i < sizeof(scanners) / sizeof(scanners[0]); i++) {
+    if (rio_linescan(scanners[i]) == NULL) {
+      printf("%-9s (not supported on this CPU)\n", scanners[i]);
+      continue;
+    }
+    sec = run(block, blen, total, 0);
+    printf("%-9s %8.1f MB/s %8.2f Mlines/s  x%.1f\n", scanners[i], total / sec / 1e6,
+           total / blen * nlines / sec / 1e6, base / sec);
+  }
+  return 0;
+}
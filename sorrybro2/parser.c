@@ -0,0 +1,431 @@
+/*
+ * parser.c - 점진적(incremental) HTTP 요청 헤더 파서
+ *
+ * 요청 라인과 헤더를 받은 버퍼 위에서 바로 한 번 훑으면서, 메소드, URI와 그
+ * 조각들(scheme, host, port, path), 헤더마다 이름과 값을 복사하지 않고
+ * 버퍼 안의 위치와 길이(slice_t)로만 알려준다. sscanf나 strcpy로 8KB 배열들에
+ * 옮겨 담던 것을 없애려는 것.
+ * 헤더 이름은 찾는 즉시 header_lookup으로 분류해서 id도 같이 채운다.
+ *
+ * 헤더가 아직 다 안 왔으면 HTTP_PARSE_AGAIN을 반환하고, 더 받은 뒤 같은
+ * parser로 다시 부르면 멈춘 자리부터 이어서 본다 (처음부터 다시 훑지 않음).
+ * 그 사이에 호출한 쪽이 버퍼를 옮겼으면(Rio 버퍼 앞당기기 등) 이미 찾아둔
+ * slice들을 새 위치로 옮겨준다.
+ *
+ * 한계는 잘라내지 않고 에러로 알린다: 헤더가 MAX_HEADERS개를 넘으면
+ * HTTP_PARSE_LARGE, 헤더 전체 길이는 버퍼 크기가 한계라서 호출한 쪽이 본다.
+ * 헤더 배열은 호출한 쪽이 준 arena에 두고 모자라면 두 배로 늘린다 (헤더마다 malloc 없음).
+ */
+#include "proxy.h"
+
+/* 파서 상태 */
+enum {
+  P_START,      // 요청 라인 시작 전 (앞에 붙은 빈 줄은 건너뜀)
+  P_METHOD,     // 메소드
+  P_URI,        // URI (아래 U_* 상태로 조각을 나누면서)
+  P_VERSION,    // HTTP 버전
+  P_LINE_LF,    // 줄 끝 CR 다음 LF
+  P_HEADER,     // 헤더 줄 시작 (빈 줄이면 끝)
+  P_NAME,       // 헤더 이름
+  P_OWS,        // ':' 뒤 공백
+  P_VALUE,      // 헤더 값
+  P_END_LF,     // 마지막 빈 줄의 LF
+  P_DONE
+};
+
+/* URI 안의 위치 */
+enum {
+  U_START,      // 첫 글자: '/'면 경로만, '['면 IPv6 host, 아니면 scheme 또는 host
+  U_SCHEME,     // "http" 또는 (CONNECT의) host
+  U_COLON,      // scheme/host 뒤 ':' 다음: '/'면 "://", 숫자면 port
+  U_SLASH,      // "://"의 두 번째 '/'
+  U_HOST,       // host
+  U_HOST6,      // [IPv6 주소]
+  U_HOST6_END,  // ']' 다음 (':' 또는 '/'만)
+  U_PORT,       // port
+  U_PATH        // path (query 포함, URI 끝까지)
+};
+
+/*
+ * is_tchar - 메소드/헤더 이름에 쓸 수 있는 글자인지 (RFC 9110 token)
+ */
+static int is_tchar(unsigned char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+         (c && strchr("!#$%&'*+-.^_`|~", c));
+}
+
+/*
+ * set - buf 안의 [from, to) 구간을 slice로
+ */
+static void set(slice_t *s, char *buf, size_t from, size_t to) {
+  s->p = buf + from;
+  s->len = to - from;
+}
+
+/*
+ * move - slice 하나를 옛 버퍼(from) 기준에서 새 버퍼(to) 기준으로 (아직 못 찾은 slice는 그대로)
+ */
+static void move(slice_t *s, char *from, char *to) {
+  if (s->p)
+    s->p = to + (s->p - from);
+}
+
+/*
+ * rebase - 버퍼가 옮겨졌으면 이미 찾아둔 slice들을 새 버퍼 기준으로 옮기기
+ *   (파싱 중인 헤더도: P_OWS, P_VALUE에서는 이름과 줄 시작을 이미 찾았음)
+ */
+static void rebase(http_parser_t *hp, char *buf) {
+  int i, n = hp->nheaders + (hp->state == P_OWS || hp->state == P_VALUE);
+
+  if (hp->base == NULL || hp->base == buf)
+    return;
+  move(&hp->method, hp->base, buf);
+  move(&hp->uri, hp->base, buf);
+  move(&hp->version, hp->base, buf);
+  move(&hp->scheme, hp->base, buf);
+  move(&hp->host, hp->base, buf);
+  move(&hp->port, hp->base, buf);
+  move(&hp->path, hp->base, buf);
+  for (i = 0; i < n; i++) {
+    move(&hp->headers[i].name, hp->base, buf);
+    move(&hp->headers[i].value, hp->base, buf);
+    move(&hp->headers[i].line, hp->base, buf);
+  }
+}
+
+/*
+ * uri_byte - URI 한 글자를 보고 scheme/host/port/path 경계 기록
+ *   i: 이 글자의 위치, 반환: 형식 오류면 -1
+ */
+static int uri_byte(http_parser_t *hp, char *buf, size_t i) {
+  char c = buf[i];
+
+  switch (hp->ustate) {
+  case U_START:
+    hp->umark = i;
+    if (c == '/')
+      hp->ustate = U_PATH;
+    else if (c == '[') {
+      hp->umark = i + 1;
+      hp->ustate = U_HOST6;
+    }
+    else
+      hp->ustate = U_SCHEME;
+    break;
+  case U_SCHEME:
+    if (c == ':') {
+      set(&hp->scheme, buf, hp->umark, i);
+      hp->ustate = U_COLON;
+    }
+    else if (c == '/')
+      return -1;
+    break;
+  case U_COLON:
+    if (c == '/')
+      hp->ustate = U_SLASH;
+    else if (c >= '0' && c <= '9') { // "host:port" (CONNECT) - scheme이 아니라 host였음
+      hp->host = hp->scheme;
+      hp->scheme.p = NULL;
+      hp->scheme.len = 0;
+      hp->umark = i;
+      hp->ustate = U_PORT;
+    }
+    else
+      return -1;
+    break;
+  case U_SLASH:
+    if (c != '/')
+      return -1;
+    hp->umark = i + 1;
+    hp->ustate = U_HOST;
+    break;
+  case U_HOST:
+    if (c == '[' && i == hp->umark) {
+      hp->umark = i + 1;
+      hp->ustate = U_HOST6;
+    }
+    else if (c == ':' || c == '/') {
+      set(&hp->host, buf, hp->umark, i);
+      hp->umark = c == ':' ? i + 1 : i;
+      hp->ustate = c == ':' ? U_PORT : U_PATH;
+    }
+    break;
+  case U_HOST6:
+    if (c == ']') {
+      set(&hp->host, buf, hp->umark, i);
+      hp->ustate = U_HOST6_END;
+    }
+    break;
+  case U_HOST6_END:
+    if (c != ':' && c != '/')
+      return -1;
+    hp->umark = c == ':' ? i + 1 : i;
+    hp->ustate = c == ':' ? U_PORT : U_PATH;
+    break;
+  case U_PORT:
+    if (c == '/') {
+      set(&hp->port, buf, hp->umark, i);
+      hp->umark = i;
+      hp->ustate = U_PATH;
+    }
+    else if (c < '0' || c > '9')
+      return -1;
+    break;
+  case U_PATH:
+    break;
+  }
+  return 0;
+}
+
+/*
+ * uri_end - URI가 끝났을 때 진행 중이던 조각 마무리
+ */
+static int uri_end(http_parser_t *hp, char *buf, size_t i) {
+  switch (hp->ustate) {
+  case U_HOST:
+    set(&hp->host, buf, hp->umark, i);
+    break;
+  case U_PORT:
+    set(&hp->port, buf, hp->umark, i);
+    break;
+  case U_PATH:
+    set(&hp->path, buf, hp->umark, i);
+    break;
+  case U_HOST6_END:
+    break;
+  default: // "http:", "[::1" 처럼 중간에 끝남
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * http_parser_init - 새 요청을 파싱할 상태로 초기화 (헤더 배열은 arena에서 할당)
+ */
+void http_parser_init(http_parser_t *hp, arena_t *arena) {
+  memset(hp, 0, sizeof(*hp));
+  hp->state = P_START;
+  hp->ustate = U_START;
+  hp->arena = arena;
+}
+
+/*
+ * grow_headers - 헤더 배열이 찼으면 arena에 두 배 크기로 새로 만들어 옮기기
+ *   (옛 배열은 arena_reset 때 같이 해제, 옮기는 비용은 합쳐도 헤더 수에 비례)
+ *   반환: MAX_HEADERS를 넘으면 -1
+ */
+static int grow_headers(http_parser_t *hp) {
+  http_header_t *headers;
+  int max;
+
+  if (hp->nheaders < hp->maxheaders)
+    return 0;
+  if (hp->maxheaders == MAX_HEADERS)
+    return -1;
+  max = hp->maxheaders ? hp->maxheaders * 2 : 16;
+  if (max > MAX_HEADERS)
+    max = MAX_HEADERS;
+  headers = arena_alloc(hp->arena, max * sizeof(http_header_t));
+  if (hp->nheaders > 0)
+    memcpy(headers, hp->headers, hp->nheaders * sizeof(http_header_t));
+  hp->headers = headers;
+  hp->maxheaders = max;
+  return 0;
+}
+
+/*
+ * http_parse - buf[0..len)에 와 있는 만큼 파싱 (지난번에 멈춘 곳부터 이어서)
+ *   반환: 다 파싱했으면 빈 줄까지의 길이, 아니면 HTTP_PARSE_AGAIN/BAD/LARGE
+ */
+int http_parse(http_parser_t *hp, char *buf, size_t len) {
+  http_header_t *h;
+  size_t i;
+  unsigned char c;
+
+  if (hp->state == P_DONE)
+    return hp->pos;
+  rebase(hp, buf);
+  hp->base = buf;
+  for (i = hp->pos; i < len; i++) {
+    c = buf[i];
+    switch (hp->state) {
+    case P_START:
+      if (c == '\r' || c == '\n')
+        break;
+      hp->mark = i;
+      hp->state = P_METHOD;
+      /* fall through */
+    case P_METHOD:
+      if (c == ' ') {
+        if (i == hp->mark)
+          return HTTP_PARSE_BAD;
+        set(&hp->method, buf, hp->mark, i);
+        hp->mark = i + 1;
+        hp->state = P_URI;
+      }
+      else if (!is_tchar(c))
+        return HTTP_PARSE_BAD;
+      break;
+    case P_URI:
+      if (c == ' ') {
+        if (i == hp->mark || uri_end(hp, buf, i) < 0)
+          return HTTP_PARSE_BAD;
+        set(&hp->uri, buf, hp->mark, i);
+        hp->mark = i + 1;
+        hp->state = P_VERSION;
+      }
+      else if (c <= ' ' || c == 0x7f || uri_byte(hp, buf, i) < 0)
+        return HTTP_PARSE_BAD;
+      break;
+    case P_VERSION:
+      if (c == '\r' || c == '\n') {
+        set(&hp->version, buf, hp->mark, i);
+        if (hp->version.len != 8 || strncmp(hp->version.p, "HTTP/1.", 7))
+          return HTTP_PARSE_BAD;
+        hp->state = c == '\r' ? P_LINE_LF : P_HEADER;
+      }
+      break;
+    case P_LINE_LF:
+      if (c != '\n')
+        return HTTP_PARSE_BAD;
+      hp->state = P_HEADER;
+      break;
+    case P_HEADER:
+      if (c == '\r')
+        hp->state = P_END_LF;
+      else if (c == '\n') {
+        hp->state = P_DONE;
+        hp->pos = i + 1;
+        return i + 1;
+      }
+      else if (!is_tchar(c)) // 줄 접기(obs-fold)나 이름 없는 줄
+        return HTTP_PARSE_BAD;
+      else {
+        if (grow_headers(hp) < 0)
+          return HTTP_PARSE_LARGE;
+        hp->mark = i;
+        hp->state = P_NAME;
+      }
+      break;
+    case P_NAME:
+      if (c == ':') {
+        h = &hp->headers[hp->nheaders];
+        set(&h->name, buf, hp->mark, i);
+        h->id = header_lookup(h->name.p, h->name.len);
+        set(&h->line, buf, hp->mark, hp->mark); // 줄 끝은 나중에
+        hp->state = P_OWS;
+      }
+      else if (!is_tchar(c)) // "Name :" 처럼 이름 뒤 공백 포함
+        return HTTP_PARSE_BAD;
+      break;
+    case P_OWS:
+      if (c == ' ' || c == '\t')
+        break;
+      h = &hp->headers[hp->nheaders];
+      set(&h->value, buf, i, i);
+      hp->state = P_VALUE;
+      /* fall through */
+    case P_VALUE:
+      h = &hp->headers[hp->nheaders];
+      if (c == '\n' || c == '\r') { // 값 끝 (CR이면 다음 LF까지를 줄로)
+        if (h->value.len == 0)
+          h->value.p = buf + i;
+        h->line.len = i + 1 - (h->line.p - buf);
+        hp->state = c == '\r' ? P_LINE_LF : P_HEADER;
+        hp->nheaders++;
+        if (c == '\r')
+          h->line.len++; // LF까지 (P_LINE_LF에서 확인)
+      }
+      else if (c < ' ' && c != '\t')
+        return HTTP_PARSE_BAD;
+      else if (c != ' ' && c != '\t') // 뒤쪽 공백은 값에서 뺌
+        h->value.len = i + 1 - (h->value.p - buf);
+      break;
+    case P_END_LF:
+      if (c != '\n')
+        return HTTP_PARSE_BAD;
+      hp->state = P_DONE;
+      hp->pos = i + 1;
+      return i + 1;
+    }
+  }
+  hp->pos = i;
+  return HTTP_PARSE_AGAIN;
+}
+
+/*
+ * slice_eq - slice가 문자열 lit과 같은지 (대소문자 무시)
+ */
+int slice_eq(slice_t s, char *lit) {
+  return strlen(lit) == s.len && strncasecmp(s.p, lit, s.len) == 0;
+}
+
+/*
+ * slice_copy - slice를 size 바이트 버퍼에 NUL로 끝나게 복사 (안 들어가면 -1)
+ */
+int slice_copy(char *dst, size_t size, slice_t s) {
+  if (s.len >= size)
+    return -1;
+  memcpy(dst, s.p, s.len);
+  dst[s.len] = '\0';
+  return 0;
+}
+
+/*
+ * hexval - 16진수 글자 값 (아니면 -1)
+ */
+int hexval(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  c |= 0x20;
+  return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+/*
+ * is_unreserved - %XX로 쓰지 않아도 뜻이 같은 글자인지 (RFC 3986 unreserved)
+ */
+static int is_unreserved(int c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+         c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+/*
+ * http_cache_key - 절대 URL을 정규화한 캐시 키를 hp->arena에 만들기
+ *   (scheme, host 소문자, 기본 포트 :80 빼기, 빈 path는 "/", %XX 정리)
+ */
+char *http_cache_key(http_parser_t *hp) {
+  static const char hex[] = "0123456789ABCDEF";
+  char *key, *k, *p = hp->path.p, *end = hp->path.p + hp->path.len;
+  size_t i;
+  int hi, lo;
+
+  // "http://" + host + ":" + port + path (없으면 "/") + NUL, 정규화하면 길어지지 않음
+  key = k = arena_alloc(hp->arena, 7 + hp->host.len + 1 + hp->port.len + hp->path.len + 2);
+  memcpy(k, "http://", 7); // scheme은 http만 받으므로 대소문자가 어떻든 소문자로
+  k += 7;
+  for (i = 0; i < hp->host.len; i++) // host는 대소문자 구분 없음
+    *k++ = tolower((unsigned char)hp->host.p[i]);
+  if (hp->port.len > 0 && !slice_eq(hp->port, "80")) { // 기본 포트는 뺌
+    *k++ = ':';
+    memcpy(k, hp->port.p, hp->port.len);
+    k += hp->port.len;
+  }
+  if (p == end)
+    *k++ = '/';
+  while (p < end) { // %XX: unreserved 글자면 풀고, 아니면 16진수를 대문자로
+    if (*p == '%' && end - p >= 3 && (hi = hexval(p[1])) >= 0 && (lo = hexval(p[2])) >= 0) {
+      if (is_unreserved(hi << 4 | lo))
+        *k++ = hi << 4 | lo;
+      else {
+        *k++ = '%';
+        *k++ = hex[hi];
+        *k++ = hex[lo];
+      }
+      p += 3;
+    }
+    else
+      *k++ = *p++;
+  }
+  *k = '\0';
+  return key;
+}
@@ -0,0 +1,139 @@
+/*
+ * parsetest.c - HTTP 요청 파서 테스트 (make test)
+ *
+ * 케이스마다 요청을 모든 바이트 경계에서 두 번에 나눠서, 그리고 한 바이트씩 늘려가며
+ * http_parse에 넣어 본다. 부를 때마다 버퍼를 다른 곳으로 옮겨서 (Rio 버퍼 앞당기기처럼)
+ * 이미 찾아둔 slice들이 새 버퍼를 따라오는지도 같이 본다:
+ *   정상 요청: 헤더 길이와 메소드/host/port/path, 헤더 수와 첫 헤더가 기대값과 같음
+ *   틀린 요청: 중간에 끝났다고 하지 않고, 기대한 오류(BAD/LARGE)로 끝남
+ */
+#include "proxy.h"
+
+#define TEST_BUF 8192
+
+/* 헤더 뒤에 붙여서 파서가 빈 줄에서 멈추는지 보는 본문 */
+#define NEXT "body"
+
+typedef struct {
+  char *name;
+  char *in;      // 요청 헤더 (빈 줄까지)
+  int result;    // 0이면 정상, 아니면 HTTP_PARSE_BAD/LARGE
+  char *method, *host, *port, *path; // 정상일 때 기대값 (NULL이면 안 봄)
+  int nheaders;
+  char *hname, *hvalue;              // 첫 헤더 (NULL이면 안 봄)
+} parse_case_t;
+
+static char many[2][TEST_BUF]; // MAX_HEADERS개, MAX_HEADERS + 1개짜리 요청 (main에서 만듦)
+
+static parse_case_t cases[] = {
+  {"absolute URI", "GET http://example.com/index.html HTTP/1.1\r\nHost: example.com\r\nUser-Agent: t\r\n\r\n",
+   0, "GET", "example.com", "", "/index.html", 2, "Host", "example.com"},
+  {"port and query", "GET http://example.com:8080/a?b=c HTTP/1.0\r\n\r\n",
+   0, "GET", "example.com", "8080", "/a?b=c", 0, NULL, NULL},
+  {"origin form", "POST /submit HTTP/1.1\r\nHost: h\r\nContent-Length: 3\r\n\r\n",
+   0, "POST", "", "", "/submit", 2, "Host", "h"},
+  {"CONNECT", "CONNECT example.com:443 HTTP/1.1\r\nHost: example.com:443\r\n\r\n",
+   0, "CONNECT", "example.com", "443", "", 1, "Host", "example.com:443"},
+  {"IPv6 host", "GET http://[::1]:8080/ HTTP/1.1\r\n\r\n",
+   0, "GET", "::1", "8080", "/", 0, NULL, NULL},
+  {"value OWS trimmed", "GET / HTTP/1.1\r\nX-A: \t spaced  value \t \r\n\r\n",
+   0, "GET", NULL, NULL, "/", 1, "X-A", "spaced  value"},
+  {"empty value", "GET / HTTP/1.1\r\nX-Empty:\r\nX-B: 1\r\n\r\n",
+   0, "GET", NULL, NULL, "/", 2, "X-Empty", ""},
+  {"leading empty line", "\r\nGET / HTTP/1.1\r\n\r\n",
+   0, "GET", NULL, NULL, "/", 0, NULL, NULL},
+  {"bare LF lines", "GET / HTTP/1.1\nHost: a\n\n",
+   0, "GET", NULL, NULL, "/", 1, "Host", "a"},
+  {"obs-fold (space)", "GET / HTTP/1.1\r\nX-A: 1\r\n  continued\r\n\r\n", HTTP_PARSE_BAD},
+  {"obs-fold (tab)", "GET / HTTP/1.1\r\nX-A: 1\r\n\tcontinued\r\n\r\n", HTTP_PARSE_BAD},
+  {"space before colon", "GET / HTTP/1.1\r\nHost : a\r\n\r\n", HTTP_PARSE_BAD},
+  {"space in name", "GET / HTTP/1.1\r\nBad Name: a\r\n\r\n", HTTP_PARSE_BAD},
+  {"no colon", "GET / HTTP/1.1\r\nHost\r\n\r\n", HTTP_PARSE_BAD},
+  {"control char in value", "GET / HTTP/1.1\r\nX-A: a\001b\r\n\r\n", HTTP_PARSE_BAD},
+  {"CR without LF", "GET / HTTP/1.1\rX-A: 1\r\n\r\n", HTTP_PARSE_BAD},
+  {"no method", " / HTTP/1.1\r\n\r\n", HTTP_PARSE_BAD},
+  {"bad version", "GET / HTTP/2.0\r\n\r\n", HTTP_PARSE_BAD},
+  {"bad URI", "GET http:/x HTTP/1.1\r\n\r\n", HTTP_PARSE_BAD},
+  {"bad port", "GET http://a:8x/ HTTP/1.1\r\n\r\n", HTTP_PARSE_BAD},
+  {"MAX_HEADERS headers", many[0], 0, "GET", NULL, NULL, "/", MAX_HEADERS, "X-0", "v"},
+  {"MAX_HEADERS + 1 headers", many[1], HTTP_PARSE_LARGE},
+};
+
+/*
+ * make_many - n개 헤더를 가진 요청을 buf에
+ */
+static void make_many(char *buf, int n) {
+  int i;
+
+  buf += sprintf(buf, "GET / HTTP/1.1\r\n");
+  for (i = 0; i < n; i++)
+    buf += sprintf(buf, "X-%d: v\r\n", i);
+  sprintf(buf, "\r\n");
+}
+
+/*
+ * expect - 정상 요청에서 slice가 기대한 문자열인지 (want가 NULL이면 안 봄)
+ */
+static int expect(slice_t s, char *want) {
+  return want == NULL || (s.len == strlen(want) && (s.len == 0 || memcmp(s.p, want, s.len) == 0));
+}
+
+/*
+ * check - 다 파싱한 결과가 케이스의 기대값과 같은지
+ */
+static int check(parse_case_t *c, http_parser_t *hp, int r) {
+  if (c->result != 0)
+    return r == c->result;
+  return r == strlen(c->in) && expect(hp->method, c->method) && expect(hp->host, c->host) &&
+         expect(hp->port, c->port) && expect(hp->path, c->path) && hp->nheaders == c->nheaders &&
+         (c->hname == NULL || (expect(hp->headers[0].name, c->hname) &&
+                               expect(hp->headers[0].value, c->hvalue)));
+}
+
+/*
+ * run_case - c->in(+NEXT)을 split에서 나눠 넣어 보기 (split이 0이면 한 바이트씩 늘려가며)
+ *   부를 때마다 두 버퍼를 번갈아 써서 버퍼가 옮겨진 것처럼 함, 반환: 맞으면 0
+ */
+static int run_case(parse_case_t *c, size_t split) {
+  static char buf[2][TEST_BUF + 16];
+  char arena_buf[REQUEST_ARENA];
+  size_t len = strlen(c->in), total = len + strlen(NEXT), n;
+  http_parser_t hp;
+  arena_t arena;
+  int r = HTTP_PARSE_AGAIN, k = 0, ok;
+
+  sprintf(buf[0], "%s%s", c->in, NEXT);
+  memcpy(buf[1], buf[0], total + 1);
+  arena_init(&arena, arena_buf, sizeof(arena_buf));
+  http_parser_init(&hp, &arena);
+  for (n = split ? split : 1; r == HTTP_PARSE_AGAIN && n <= total; n = split ? total : n + 1) {
+    r = http_parse(&hp, buf[k], n);
+    k ^= 1;
+    if (r > 0 && n < len) // 빈 줄 전에 끝났다고 함
+      break;
+    if (split && n == total)
+      break;
+  }
+  ok = check(c, &hp, r);
+  arena_reset(&arena);
+  return ok ? 0 : -1;
+}
+
+int main(void) {
+  int i, fails = 0, runs = 0;
+  size_t split;
+
+  make_many(many[0], MAX_HEADERS);
+  make_many(many[1], MAX_HEADERS + 1);
+  for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    for (split = 0; split < strlen(cases[i].in) + strlen(NEXT); split++, runs++) {
+      if (run_case(&cases[i], split) < 0) {
+        printf("FAIL %s (split %zu)\n", cases[i].name, split);
+        fails++;
+        break;
+      }
+    }
+  }
+  printf("parsetest: %d cases, %d runs, %d failed\n", i, runs, fails);
+  return fails > 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * pool.c - 워커 스레드 풀 (-m pool), 큐 깊이에 따라 크기 조절
+ *
+ * 워커들은 연결 큐(sbuf)에서 connfd를 꺼내 serve_connection을 반복한다.
+ * keep-alive 연결에 다음 요청이 아직 안 와 있으면 기다리지 않고 idle.c의
+ * poller에 맡기고, 요청이 오면 poller가 connfd를 큐에 다시 넣는다.
+ * (놀고 있는 클라이언트 몇 개가 워커를 모두 붙잡지 않도록)
+ * 감시 스레드가 TICK_MS마다 큐를 보고
+ *
+ *   - 큐가 GROW_TICKS 동안 계속 가득 차 있으면 워커를 두 배로 (최대 max)
+ *   - 큐가 SHRINK_TICKS 동안 계속 비어있고 워커 절반 이상이 놀고 있으면
+ *     워커를 반으로 (최소 min)
+ *
+ * 줄일 때는 큐에 -1(은퇴 표시)을 넣어서, 그걸 꺼낸 워커가 스스로 끝나게 한다.
+ * 놀고 있는 워커는 sbuf_remove에서 자고 있으므로 따로 깨울 방법이 필요 없다.
+ * min == max 이면 크기가 고정된 예전 풀과 같다.
+ * 크기가 바뀔 때마다 한 줄씩 출력하고, SIGUSR1을 보내면 현재 상태를 출력한다.
+ */
+#include "proxy.h"
+
+#define TICK_MS 100      // 큐를 살펴보는 주기
+#define GROW_TICKS 5     // 이만큼(0.5초) 계속 가득 차 있으면 두 배로
+#define SHRINK_TICKS 100 // 이만큼(10초) 계속 한가하면 반으로
+#define RETIRE -1        // 큐에 넣는 은퇴 표시 (connfd 자리에)
+
+static sbuf_t *queue;      // 연결 큐
+static int pool_min, pool_max; // 워커 수 범위
+static int pool_size;      // 목표 워커 수 (감시 스레드만 바꿈)
+static int busy;           // 요청 처리 중인 워커 수
+static unsigned long grows, shrinks; // 늘린/줄인 횟수
+static volatile sig_atomic_t stats_requested; // SIGUSR1을 받으면 1
+
+/*
+ * drop_request - 다음 요청 없이 시간이 다 된 연결 정리 (idle 스레드가 호출)
+ */
+static void drop_request(void *item) {
+  request_t *rq = item;
+
+  Close(rq->connfd);
+  request_deinit(rq);
+  Free(rq);
+}
+
+/*
+ * worker - 워커 스레드: 연결 큐에서 connfd를 꺼내 처리하고 닫거나 poller에 맡기기를 반복
+ */
+static void *worker(void *vargp) {
+  request_t *rq;
+  int connfd, rc;
+
+  Pthread_detach(pthread_self()); // 스스로 분리 -> 종료 시 자원 자동 회수
+  while ((connfd = sbuf_remove(queue)) != RETIRE) { // 처리할 연결 꺼내기 (없으면 대기)
+    __atomic_add_fetch(&busy, 1, __ATOMIC_RELAXED);
+    if ((rq = idle_claim(connfd)) == NULL) { // 새 연결 (poller에서 돌아온 연결이면 하던 상태 그대로)
+      rq = Malloc(sizeof(request_t));
+      request_init(rq, connfd);
+    }
+    if ((rc = serve_connection(rq, 0)) == CONN_IDLE) // 요청 처리
+      idle_park(connfd, rq);           // 다음 요청을 기다리는 동안은 poller가 들고 있음
+    else {
+      if (rc == CONN_CLOSE)
+        Close(connfd);                 // 클라이언트 연결 종료 (터널로 넘겼으면 터널 스레드가 닫음)
+      request_deinit(rq);
+      Free(rq);
+    }
+    __atomic_sub_fetch(&busy, 1, __ATOMIC_RELAXED);
+  }
+  return NULL; // 은퇴
+}
+
+/*
+ * pool_resize - 워커 수를 n으로 바꾸기 (감시 스레드에서만 호출)
+ */
+static void pool_resize(int n, char *why) {
+  pthread_t tid;
+  int i, old = pool_size;
+
+  if (n > pool_size) {
+    for (i = pool_size; i < n; i++)
+      Pthread_create(&tid, NULL, worker, NULL);
+    grows++;
+  }
+  else {
+    for (i = pool_size; i > n; i--) // 큐가 그새 차버리면 나머지는 다음 기회에
+      if (!sbuf_tryinsert(queue, RETIRE))
+        break;
+    if (i == pool_size)
+      return;
+    n = i;
+    shrinks++;
+  }
+  pool_size = n;
+  printf("pool: %d -> %d threads (%s)\n", old, n, why);
+  fflush(stdout);
+}
+
+/*
+ * print_stats - 풀 상태 출력
+ */
+static void print_stats(void) {
+  int queued;
+
+  sem_getvalue(&queue->items, &queued);
+  printf("pool: %d threads (min %d, max %d), %d busy, %d/%d queued, %lu grows, %lu shrinks\n",
+         pool_size, pool_min, pool_max, __atomic_load_n(&busy, __ATOMIC_RELAXED),
+         queued, queue->n, grows, shrinks);
+  idle_stats();
+  upstream_stats();
+  tunnel_stats();
+  cache_stats();
+  fflush(stdout);
+}
+
+/*
+ * sigusr1_handler - 통계 출력 요청 표시만 하고, 출력은 감시 스레드가
+ */
+static void sigusr1_handler(int sig) {
+  stats_requested = 1;
+}
+
+/*
+ * monitor - 감시 스레드: TICK_MS마다 큐 깊이를 보고 필요하면 크기 조절
+ */
+static void *monitor(void *vargp) {
+  int queued, full_ticks = 0, idle_ticks = 0;
+
+  Pthread_detach(pthread_self());
+  while (1) {
+    usleep(TICK_MS * 1000);
+    if (stats_requested) {
+      stats_requested = 0;
+      print_stats();
+    }
+    if (pool_min == pool_max)
+      continue;
+
+    sem_getvalue(&queue->items, &queued);
+    full_ticks = queued >= queue->n ? full_ticks + 1 : 0;
+    idle_ticks = queued == 0 && __atomic_load_n(&busy, __ATOMIC_RELAXED) * 2 <= pool_size
+                 ? idle_ticks + 1 : 0;
+
+    if (full_ticks >= GROW_TICKS && pool_size < pool_max) {
+      pool_resize(pool_size * 2 < pool_max ? pool_size * 2 : pool_max, "queue full");
+      full_ticks = 0;
+    }
+    else if (idle_ticks >= SHRINK_TICKS && pool_size > pool_min) {
+      pool_resize(pool_size / 2 > pool_min ? pool_size / 2 : pool_min, "idle");
+      idle_ticks = 0;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * pool_start - 워커 n개와 감시 스레드를 만들고 반환
+ */
+void pool_start(sbuf_t *sp, int n, int min, int max) {
+  pthread_t tid;
+  int i;
+
+  queue = sp;
+  pool_min = min;
+  pool_max = max;
+  pool_size = n;
+  idle_start(sp, NULL, drop_request);
+  for (i = 0; i < n; i++) // 워커 스레드 생성
+    Pthread_create(&tid, NULL, worker, NULL);
+  Signal(SIGUSR1, sigusr1_handler);
+  Pthread_create(&tid, NULL, monitor, NULL);
+}
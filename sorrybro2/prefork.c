@@ -0,0 +1,59 @@
+/*
+ * prefork.c - 멀티 프로세스 모드 (-m prefork)
+ *
+ * 부모가 open_listenfd로 만든 듣기 소켓을 fork로 물려받은 자식 n개(기본: 코어 수)가
+ * 각자 코루틴 엔진(coro.c)으로 연결을 처리한다. 스레드 없이 코어 수만큼
+ * 확장되고, 자식 하나가 죽어도 그 자식이 들고 있던 연결만 끊긴다.
+ * 부모는 연결을 처리하지 않고 자식이 죽으면 같은 번호로 다시 만들기만 한다.
+ *
+ * 캐시는 main이 fork 전에 공유 메모리에 만들어 두므로(cache_init)
+ * 모든 자식이 같은 캐시를 본다.
+ */
+#include "proxy.h"
+
+/*
+ * spawn_child - i번 자식 만들기: 자기 CPU에 고정하고 코루틴 엔진 실행
+ */
+static pid_t spawn_child(int listenfd, int i) {
+  pid_t pid;
+  int rc;
+
+  if ((pid = Fork()) == 0) {
+    if ((rc = pin_to_cpu(i % online_cpus())) != 0)
+      fprintf(stderr, "child %d: pin_to_cpu failed: %s\n", i, strerror(rc));
+    coro_loop(listenfd); // 반환하지 않음
+  }
+  return pid;
+}
+
+/*
+ * prefork_run - 자식 n개를 만들고, 죽은 자식은 다시 만들기 (반환하지 않음)
+ */
+void prefork_run(int listenfd, int n) {
+  pid_t *pids = Calloc(n, sizeof(pid_t)); // 번호별 자식 pid
+  pid_t pid;
+  int i, status;
+
+  printf("Prefork: %d processes sharing one cache\n", n);
+  fflush(stdout); // fork 전에 비워야 자식들이 같은 출력을 또 내보내지 않음
+  for (i = 0; i < n; i++)
+    pids[i] = spawn_child(listenfd, i);
+
+  while (1) {
+    if ((pid = wait(&status)) < 0) {
+      if (errno == EINTR)
+        continue;
+      unix_error("wait error");
+    }
+    for (i = 0; i < n && pids[i] != pid; i++)
+      ;
+    if (i == n)
+      continue;
+    if (WIFSIGNALED(status))
+      printf("child %d (pid %d) killed by signal %d, restarting\n", i, (int)pid, WTERMSIG(status));
+    else
+      printf("child %d (pid %d) exited with status %d, restarting\n", i, (int)pid, WEXITSTATUS(status));
+    fflush(stdout);
+    pids[i] = spawn_child(listenfd, i);
+  }
+}
@@ -1,9 +1,56 @@
 #include <stdio.h> // 표준 입출력 함수들 (printf, fprintf 등) 
-#include "csapp.h" // CS:APP 교재의 wrapper 함수들 (Open_listenfd, Accept, Rio 등)
+#include <limits.h> // LONG_MAX (Content-Length 범위 확인)
+#include "proxy.h" // 프록시 공용 선언 (csapp.h, sbuf.h 포함)
 
-/* 캐시 최대 크기와 객체 최대 크기 정의 (문제 3에서 사용함) */ 
-#define MAX_CACHE_SIZE 1049000 // 캐시 최대 크기 정의 
-#define MAX_OBJECT_SIZE 102400 // 캐시할 객체 최대 크기 정의
+/* splice 중계 (큰 본문만, 작은 본문은 pipe syscall보다 복사가 쌈) */
+#define SPLICE_MIN (64 * 1024)    // 이보다 작은 본문은 복사로 중계
+#define SPLICE_CHUNK (256 * 1024) // splice 한 번에 옮길 최대 바이트
+
+/* 클라이언트 keep-alive */
+#define MAX_KEEPALIVE_REQS 100 // 연결 하나에서 처리할 최대 요청 수
+#define PIPELINE_MAX 8         // 파이프라인 요청을 한 번에 몇 개까지 동시에 보낼지
+
+/* 워커 풀 기본값 (문제 2에서 사용함) -> -t, -q 옵션으로 변경 가능 */
+#define NTHREADS 4  // 워커 스레드 개수 기본값
+#define SBUFSIZE 16 // 연결 큐 깊이 기본값
+
+/* 실행 모드 */
+typedef enum {
+  MODE_ITERATIVE, // 순차 처리 (accept한 스레드가 직접 처리)
+  MODE_POOL,      // 미리 만들어둔 워커 스레드 풀이 처리
+  MODE_EVENT,     // epoll 단일 스레드 이벤트 루프가 non-blocking으로 처리
+  MODE_REACTORS,  // CPU마다 하나씩, SO_REUSEPORT 듣기 소켓을 가진 이벤트 루프
+  MODE_URING,     // io_uring 단일 스레드 엔진 (지원 안 되면 event로 대체)
+  MODE_STEAL,     // 요청을 단계별 작업으로 나눠 work-stealing 워커들이 처리
+  MODE_CORO,      // 연결마다 코루틴 하나, 블록될 때는 epoll 스케줄러로 yield
+  MODE_PREFORK    // 코어마다 프로세스 하나 (각자 코루틴 엔진), 캐시는 공유 메모리
+} proxy_mode_t;
+
+/* 연결 큐가 가득 찼을 때의 정책 */
+typedef enum {
+  QFULL_BLOCK, // 빈 슬롯이 생길 때까지 accept 루프가 기다림
+  QFULL_REJECT // 기다리지 않고 503으로 바로 거절
+} qfull_policy_t;
+
+/* read_next가 응답 없이 닫지 않고 에러로 답해야 할 때 돌려주는 값 (send_read_error가 보냄) */
+typedef enum {
+  READ_BAD = 1, // 400: 요청 형식 오류
+  READ_FRAMING, // 400: 본문 끝을 알 수 없음 (Content-Length/Transfer-Encoding)
+  READ_LARGE    // 431: 헤더가 Rio 버퍼보다 큼
+} read_error_t;
+
+/* 파이프라인 슬롯 하나: request_t 중 요청마다 달라지는 부분만 (Rio 버퍼, arena는 rq 것을 같이 씀) */
+typedef struct {
+  http_parser_t hp;       // slice들과 헤더 배열은 rq의 Rio 버퍼, arena 안
+  char *method, *url, *path, *key;
+  char host[MAX_HOST], port[MAX_PORT];
+  slice_t host_header;
+  long body_clen;
+  int body_chunked, expect_continue, http11, keepalive, cacheable, retriable;
+  int serverfd, reused, upstream_keepalive;
+} slot_t;
+
+static sbuf_t sbuf; // accept한 connfd를 워커들에게 넘겨주는 연결 큐
 
 /* You won't lose style points for including this long line in your code */
 // 과제에서 제공된 고정 User-Agent 값
@@ -11,277 +58,1505 @@ static const char *user_agent_hdr = // User-Agent 헤더 문자열을 상수로
     "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:10.0.3) Gecko/20120305 "
     "Firefox/10.0.3\r\n"; // 과제에서 제공된 고정 User-Agent 값
 
-/* 함수 선언 */
-void handle_request(int connfd); 
+/* 함수 선언 (공용 함수들은 proxy.h에 있음) */
+static void usage(char *prog);
 /*
-  클라이언트 요청을 처리하는 함수
-  connfd: 클라이언트와의 연결 소켓 디스크립터
+  사용법 출력 후 종료하는 함수
 */
 
-// 파싱 = 문자열/데이터를 약속된 규칙(문법, 포맷)에 따라 의미있는 조각을 해석 후 조각화하는 과정
-// 버퍼 = 데이터를 잠시 담아둘 메모리 공간 (char배열, malloc으로 확보한 메모리 덩어리)
-int parse_url(char *url, char *host, char *port, char *path); 
+static int open_server(request_t *rq, int pooled);
 /*
-  URL을 파싱하는 함수
-  url: 파싱할 절대 URL 문자열 (입력)
-  host: 추출된 호스트명 (출력)
-  port: 추출된 포트 번호 (출력)
-  path: 추출된 경로 (출력)
-  -> host, port, path도 버퍼임
+  원서버 연결(pooled면 upstream 풀 먼저)을 얻어서 요청을 보내는 함수 (502는 보내지 않음)
 */
 
-void collect_headers(rio_t *rio, char *headers, char *host_header);
+static int read_next(request_t *rq);
+static void send_read_error(request_t *rq, read_error_t err);
+static void slot_save(slot_t *s, request_t *rq);
+static void slot_load(request_t *rq, slot_t *s);
 /*
-  헤더를 수집하는 함수
-  rio: 클라이언트 소켓의 Rio 구조체 포인터 (입력)
-  headers: 필터링된 헤더를 저장할 버퍼 (출력)
-  host_header: Host 헤더만 따로 저장할 버퍼 (출력)
+  arena를 비우지 않고 다음 요청을 읽는 함수 (파이프라인은 앞 요청들의 헤더가 아직 필요함)
+  / 그 함수가 돌려준 에러를 응답으로 보내는 함수 (앞 요청들에 다 응답한 뒤에)
+  / 파이프라인 슬롯에 요청 상태를 맡기고 / 다시 rq로 꺼내는 함수
 */
 
-void forward_request(int serverfd, char *method, char *path, char *headers, char *host);
+static int has_body(request_t *rq);
+static int send_body(request_t *rq);
 /*
-  서버로 요청 전달하는 함수
-  serverfd: 원서버와 연결된된 소켓 디스크립터 (입력)
-  method: HTTP 메소드 (보통 "GET") (입력)
-  path: 요청할 경로 (예: "/index.html") (입력)
-  headers: 전달할 추가 헤더들 (입력)
-  host: Host 헤더에 사용할 호스트명 (입력)
+  요청에 본문이 있는지 / 있으면 클라이언트에서 원서버로 흘려보내는 함수
 */
 
-void forward_response(int serverfd, int clientfd);
+static long splice_body(rio_t *rp, int outfd, long len);
+static slice_t line_value(char *line, size_t n);
+static int parse_framing(header_id_t id, slice_t value, long *clen, int *chunked);
+static int private_header(header_id_t id, slice_t value);
 /*
-  서버 응답을 클라이언트로 전달하는 함수
-  serverfd: 원서버와 연결된 소켓 디스크립터 (입력 - 읽기용)
-  clientfd: 클라이언트와의 연결 소켓 디스크립터 (출력 - 쓰기용)
+  본문을 splice로 중계하는 함수 / 응답 헤더 한 줄에서 값 부분, 본문 길이 정보를 읽는 함수
+  / 응답을 공유 캐시에 넣으면 안 되게 하는 헤더인지 보는 함수
+*/
+
+static void send_cached(request_t *rq, cobj_t *obj, size_t size);
+/*
+  캐시에서 고정한 응답을 이 연결에 맞는 헤더로 보내는 함수 (본문은 캐시 chunk에서 바로)
 */
 
 int main(int argc, char **argv) // 메인 함수 (argc = 인자개수, argv = 인자 배열)
 {
-  // argv[0] = 프로그램 이름 "./proxy", argv[1] = port
-  if(argc != 2){ // 인자가 2개가 아니면 (프로그램명 + 포트 번호)
+  proxy_mode_t mode = MODE_POOL;       // 실행 모드 (기본: 워커 풀)
+  qfull_policy_t policy = QFULL_BLOCK; // 큐가 가득 찼을 때 정책 (기본: 대기)
+  int nthreads = 0;                    // 워커 스레드(reactors 모드에서는 루프, prefork 모드에서는 프로세스) 개수, 0이면 기본값
+  int sbufsize = SBUFSIZE;             // 연결 큐 깊이
+  int pool_min = 0, pool_max = 0;      // 풀 크기 자동 조절 범위 (0이면 고정 크기)
+  cache_policy_t evict = CACHE_LRU;    // 캐시 내보내기 정책 (기본: LRU)
+  char *evict_name = "lru";
+  int opt;
 
-    // 인자를 잘못줬다!(stderr)라고 에러를 출력
-    fprintf(stderr, "usage: %s <port>\n", argv[0]); 
-    exit(1); // 프로그램 종료
+  // 옵션 파싱: -m 모드, -t 스레드 수, -a 풀 크기 범위, -q 큐 깊이, -f 큐 가득 참 정책, -e 캐시 내보내기 정책
+  while ((opt = getopt(argc, argv, "m:t:a:q:f:e:")) != -1) {
+    switch (opt) {
+    case 'm':
+      if (!strcmp(optarg, "iterative")) mode = MODE_ITERATIVE;
+      else if (!strcmp(optarg, "pool")) mode = MODE_POOL;
+      else if (!strcmp(optarg, "event")) mode = MODE_EVENT;
+      else if (!strcmp(optarg, "reactors")) mode = MODE_REACTORS;
+      else if (!strcmp(optarg, "uring")) mode = MODE_URING;
+      else if (!strcmp(optarg, "steal")) mode = MODE_STEAL;
+      else if (!strcmp(optarg, "coro")) mode = MODE_CORO;
+      else if (!strcmp(optarg, "prefork")) mode = MODE_PREFORK;
+      else usage(argv[0]);
+      break;
+    case 't':
+      if ((nthreads = atoi(optarg)) <= 0) usage(argv[0]);
+      break;
+    case 'a':
+      if (sscanf(optarg, "%d:%d", &pool_min, &pool_max) != 2 ||
+          pool_min <= 0 || pool_max < pool_min) usage(argv[0]);
+      break;
+    case 'q':
+      if ((sbufsize = atoi(optarg)) <= 0) usage(argv[0]);
+      break;
+    case 'f':
+      if (!strcmp(optarg, "block")) policy = QFULL_BLOCK;
+      else if (!strcmp(optarg, "reject")) policy = QFULL_REJECT;
+      else usage(argv[0]);
+      break;
+    case 'e':
+      if (!strcmp(optarg, "lru")) evict = CACHE_LRU;
+      else if (!strcmp(optarg, "clock")) evict = CACHE_CLOCK;
+      else if (!strcmp(optarg, "s3fifo")) evict = CACHE_S3FIFO;
+      else if (!strcmp(optarg, "tinylfu")) evict = CACHE_TINYLFU;
+      else if (!strcmp(optarg, "gdsf")) evict = CACHE_GDSF;
+      else usage(argv[0]);
+      evict_name = optarg;
+      break;
+    default:
+      usage(argv[0]);
+    }
   }
- 
-  int listenfd = Open_listenfd(argv[1]);// 지정된 포트에서 듣기 소켓 디스크립터 생성
+
+  // 옵션 다음에 포트 하나만 남아야 함 (argv[optind] = port)
+  if (optind != argc - 1)
+    usage(argv[0]);
+
+  // 클라이언트가 먼저 끊어서 생기는 SIGPIPE로 프록시 전체가 죽지 않도록 무시
+  Signal(SIGPIPE, SIG_IGN);
+
+  // 캐시는 공유 메모리에 만든다 (prefork 자식들도 fork 후에 같은 캐시를 봄)
+  cache_init(evict);
+  printf("Cache eviction policy: %s\n", evict_name);
+
+  // reactors 모드는 루프마다 듣기 소켓을 직접 연다 (반환하지 않음)
+  if (mode == MODE_REACTORS)
+    event_reactors(argv[optind], nthreads ? nthreads : online_cpus());
+  if (nthreads == 0) // prefork는 코어마다 프로세스 하나
+    nthreads = mode == MODE_PREFORK ? online_cpus() : NTHREADS;
+  if (pool_max == 0) // -a가 없으면 크기 고정
+    pool_min = pool_max = nthreads;
+  if (nthreads < pool_min) nthreads = pool_min; // 시작 크기는 범위 안으로
+  if (nthreads > pool_max) nthreads = pool_max;
+
+  int listenfd = Open_listenfd(argv[optind]);// 지정된 포트에서 듣기 소켓 디스크립터 생성
   int connfd; // 클라이언트 연결용 소켓 디스크립터 선언
   char hostname[MAXLINE], port[MAXLINE]; // 클라이언트 정보 저장용 버퍼
   socklen_t clientlen; // 클라이언트 주소 구조체 크기
   struct sockaddr_storage clientaddr; // 클라이언트 주소 구조체 -> 주소 저장할 공간
 
-  printf("Proxy server is running on port %s", argv[1]); // 프록시 서버 시작 메세지
+  printf("Proxy server is running on port %s\n", argv[optind]); // 프록시 서버 시작 메세지
+
+  // io_uring 모드: 커널이 지원하지 않으면 epoll 이벤트 루프로 대체
+  if (mode == MODE_URING && uring_loop(listenfd) < 0) {
+    printf("io_uring is not available, falling back to epoll\n");
+    mode = MODE_EVENT;
+  }
+
+  // 이벤트 루프 모드: 이 스레드 하나가 모든 연결을 처리 (반환하지 않음)
+  if (mode == MODE_EVENT)
+    event_loop(listenfd);
+
+  // 코루틴 모드: 이 스레드 하나가 연결마다 코루틴을 돌린다 (반환하지 않음)
+  if (mode == MODE_CORO)
+    coro_loop(listenfd);
+
+  // prefork 모드: 듣기 소켓을 물려받은 자식 프로세스들이 처리 (반환하지 않음)
+  if (mode == MODE_PREFORK)
+    prefork_run(listenfd, nthreads);
+
+  // 워커 풀 모드: 스레드를 미리 만들어 두고 연결 큐로 일을 넘긴다
+  if (mode == MODE_POOL) {
+    sbuf_init(&sbuf, sbufsize); // 연결 큐 초기화
+    pool_start(&sbuf, nthreads, pool_min, pool_max); // 워커 스레드 생성
+    printf("Worker pool: %d threads (min %d, max %d), queue depth %d, %s when full "
+           "(kill -USR1 %d for stats)\n", nthreads, pool_min, pool_max, sbufsize,
+           policy == QFULL_BLOCK ? "block" : "reject", (int)getpid());
+  }
+
+  // work-stealing 모드: 연결 큐는 입구로만 쓰고 워커들은 자기 덱에서 일한다
+  if (mode == MODE_STEAL) {
+    sbuf_init(&sbuf, sbufsize);
+    steal_start(&sbuf, nthreads);
+    printf("Work-stealing: %d workers, queue depth %d, %s when full (kill -USR1 %d for stats)\n",
+           nthreads, sbufsize, policy == QFULL_BLOCK ? "block" : "reject", (int)getpid());
+  }
 
-  // 순차적 처리 (Iterative)
   while(1){ // 무한 루프로 클라이언트 요청 대기
     clientlen = sizeof(clientaddr); // 클라이언트 주소 구조체 크기 설정
-    connfd = Accept(listenfd, (SA *)&clientaddr, &clientlen); // 클라이언트 연결 수락
+    connfd = accept(listenfd, (SA *)&clientaddr, &clientlen); // 클라이언트 연결 수락
+    if (connfd < 0) { // accept 실패(EMFILE 등)는 이 연결만 포기
+      fprintf(stderr, "accept error: %s\n", strerror(errno));
+      continue;
+    }
 
-    Getnameinfo((SA *)&clientaddr, clientlen, // 클라이언트 ip/포트
-                hostname, MAXLINE, // 호스트/IP 문자열 버퍼 + 그 크기
-                port, MAXLINE, // 포트 문자열 버퍼 + 그 크기
-                0); // 플래그 예: NI_NUMERICHOST, NI_NUMERICSERV
+    if (getnameinfo((SA *)&clientaddr, clientlen, // 클라이언트 ip/포트
+                    hostname, MAXLINE, // 호스트/IP 문자열 버퍼 + 그 크기
+                    port, MAXLINE, // 포트 문자열 버퍼 + 그 크기
+                    0) == 0) // 플래그 예: NI_NUMERICHOST, NI_NUMERICSERV
+      printf("Accepted connection from (%s, %s)\n", hostname, port); // 연결 정보 출력
 
-    printf("Accepted connection from (%s, %s)\n", hostname, port); // 연결 정보 출력
-    handle_request(connfd); // 요청 처리 함수 호출
-    Close(connfd); // 클라이언트 연결 종료
+    if (mode == MODE_ITERATIVE) { // 순차적 처리 (Iterative)
+      if (!handle_request(connfd)) // 요청 처리 함수 호출
+        Close(connfd); // 클라이언트 연결 종료 (터널로 넘겼으면 터널 스레드가 닫음)
+    }
+    else if (policy == QFULL_BLOCK) { // 큐가 차 있으면 자리가 날 때까지 대기
+      sbuf_insert(&sbuf, connfd);
+      if (mode == MODE_STEAL)
+        steal_wake(); // 쉬고 있는 워커 깨우기
+    }
+    else if (sbuf_tryinsert(&sbuf, connfd)) { // 자리가 있으면 넣기
+      if (mode == MODE_STEAL)
+        steal_wake();
+    }
+    else { // 큐가 가득 차면 바로 거절
+      clienterror(connfd, "503", "Service Unavailable",
+                  "Proxy is overloaded, try again later");
+      Close(connfd);
+    }
   }
   return 0; // 프로그램 정상 종료
 }
 
+/*
+ * usage - 사용법을 출력하고 종료
+ */
+static void usage(char *prog) {
+  // 인자를 잘못줬다!(stderr)라고 에러를 출력
+  fprintf(stderr, "usage: %s [-m iterative|pool|event|reactors|uring|steal|coro|prefork] [-t nthreads] [-a min:max] [-q queue] "
+                  "[-f block|reject] [-e lru|clock|s3fifo|tinylfu|gdsf] <port>\n", prog);
+  exit(1); // 프로그램 종료
+}
+
 /*
  * handle_request - 클라이언트 요청을 처리하는 메인 함수
+ *   (읽기/파싱 -> 원서버 연결 -> 응답 중계, 각 단계는 steal 스케줄러도 따로 사용)
+ *   keep-alive 연결이면 같은 연결에서 다음 요청을 읽어 반복
+ *   반환: CONNECT 터널로 connfd를 넘겼으면 1 (호출한 쪽이 닫으면 안 됨), 아니면 0
  */
-void handle_request(int connfd) { // 클라이언트 소켓을 매개변수로 받음
-  char buf[MAXLINE], method[MAXLINE], url[MAXLINE], version[MAXLINE]; // 요청 라인 파싱용 버퍼들
-  char host[MAXLINE], port[6], path[MAXLINE]; // URL 파싱용 버퍼들
-  char headers[MAXLINE], host_header[MAXLINE];       // 헤더 저장용 버퍼들
-  rio_t rio; // 요청 읽기용 버퍼 (rio_t 구조체)
-  int serverfd; // 원서버와 연결된 소켓 디스크립터
+int handle_request(int connfd) { // 클라이언트 소켓을 매개변수로 받음
+  request_t rq; // 요청 처리 상태 (Rio 버퍼는 요청 사이에도 유지)
+  int rc;
 
-  // 클라이언트로부터 요청 읽기
-  Rio_readinitb(&rio, connfd);  // Rio 구조체를 클라이언트 소켓으로 초기화
-  if (!Rio_readlineb(&rio, buf, MAXLINE)) {  // 요청라인을 한 줄 읽기 (실패시 0 반환)
-    return;                         // 읽기 실패하면 함수 종료
-  }
-
-  printf("Request line: %s", buf);    // 받은 요청라인 출력 (디버깅용)
-
-  // 요청 라인 파싱: GET http://host[:port]/path HTTP/1.1
-  sscanf(buf, "%s %s %s", method, url, version); // 공백으로 구분하여 3개 필드 파싱
-  /*
-    method: 메소드 (예: GET, POST, HEAD 등)
-    url: 요청 URL (예: http://host[:port]/path)
-    version: HTTP 버전 (예: HTTP/1.1)
-  */
-  
-  // method가 GET 메소드만 허용
-  if (strcasecmp(method, "GET")) {    // GET이 아니면 (strcasecmp는 대소문자 무시 비교)
-    printf("Not implemented: %s method\n", method);  // 에러 메시지 출력
-    return;                         // 함수 종료
-  }
-  
-  // url 파싱
-  if (parse_url(url, host, port, path) < 0) { // url을 host, port, path로 분리
-    printf("Error parsing URL: %s\n", url); // 파싱 실패 시 에러 메세지
-    return; // 함수 종료
-  }
-  
-  // 헤더 수집
-  collect_headers(&rio, headers, host_header); // 클라이언트 헤더들을 읽어서 필터링
-
-  // 원서버에 연결
-  serverfd = Open_clientfd(host, port); // 파싱된 host, port로 서버에 연결
-  if (serverfd < 0) {
-    printf("Error connecting to server: %s\n", host); // 연결 실패 시 에러 메세지
-    return; // 함수 종료
-  }
-  
-  // 요청 전달
-  forward_request(serverfd, method, path, headers,   // 서버로 HTTP 요청 전송
-                strlen(host_header) > 0 ? host_header : host);  // Host 헤더 처리
-
-  // 응답 전달
-  forward_response(serverfd, connfd); // 서버 응답을 클라이언트로 중계
-
-  Close(serverfd);                    // 서버 연결 종료
-}
-
-/*
- * parse_url - URL을 파싱하여 host, port, path 추출
- * http://host[:port]/path 형태 또는 /path 형태 처리
- */
-int parse_url(char *url, char *host, char *port, char *path) { // URL 파싱 함수
-  char *ptr; // 문자열 탐색용 포인터터
-
-  // url이 http://로 시작하지 않으면 에러 반환
-  if (strncasecmp(url, "http://", 7) == 0){
-
-    // http:// 이후의 문자열 위치
-    ptr = url + 7;
-
-    /* path 따로 분리 */
-    char *slash_pos = strchr(ptr, '/'); // 첫 번째 '/' 위치 찾기
-    if (slash_pos == NULL){ // '/'가 없으면
-      // path가 없는 경우 "/"로 설정
-      strcpy(path, "/"); // 기본 path를 "/"로 설정
-      strcpy(host, ptr); // 나머지 전체를 host로 복사
-    }else{ // /가 있으면
-      strcpy(path, slash_pos); // / 포함함 값을 path로 복사
-      *slash_pos = '\0'; // '/' 위치에 널 문자 삽입
-      strcpy(host, ptr); // host:port 부분을 ptr에 복사
-      *slash_pos = '/'; // 다시 '/'로 복귀
+  request_init(&rq, connfd);
+  rc = serve_connection(&rq, 1); // 다음 요청은 그 자리에서 기다림
+  request_deinit(&rq);
+  return rc == CONN_TUNNEL;
+}
+
+/*
+ * serve_connection - 한 연결에서 요청을 읽어 처리하기를 반복
+ *   wait가 0이면 다음 요청이 아직 안 와 있을 때 CONN_IDLE로 돌아감
+ *   (pool, steal 워커는 그 연결을 idle_park로 맡기고 다른 연결을 처리)
+ */
+int serve_connection(request_t *rq, int wait) {
+  int rc;
+
+  while (1) {
+    if (!wait && rio_readable(&rq->rio, 0) == 0) // 다음 요청이 아직 안 옴
+      return CONN_IDLE;
+    if (read_request(rq) < 0) // 요청 읽고 파싱 (idle timeout이나 EOF면 끝)
+      return CONN_CLOSE;
+    if (!strcasecmp(rq->method, "CONNECT")) // 터널: 이후로는 터널 스레드가 처리
+      return open_tunnel(rq) ? CONN_TUNNEL : CONN_CLOSE;
+    if (rq->keepalive && request_buffered(&rq->rio)) { // 뒤에 요청이 더 와 있음 (파이프라인)
+      if ((rc = serve_pipeline(rq)) != 0) // 묶음 끝의 CONNECT를 터널로 넘겼으면 1
+        return rc > 0 ? CONN_TUNNEL : CONN_CLOSE;
+      continue;
+    }
+    if (!serve_cached(rq)) {      // 캐시에 있으면 원서버 없이 바로 응답
+      if (connect_server(rq) < 0) // 원서버 연결(가능하면 풀에서) + 요청 전달
+        return CONN_CLOSE;
+      forward_response(rq);       // 서버 응답을 클라이언트로 중계 (+ 캐시에 저장)
+      release_server(rq);         // 서버 연결은 풀에 돌려주거나 닫기
     }
+    if (!rq->keepalive)
+      return CONN_CLOSE;
+  }
+}
+
+/*
+ * open_tunnel - CONNECT: 원서버에 연결하고 200을 보낸 뒤 양쪽 소켓을 터널 스레드에 넘기기
+ *   반환: 넘겼으면 1 (connfd는 이제 터널 것), 실패 0 (호출한 쪽이 connfd를 닫음)
+ */
+int open_tunnel(request_t *rq) {
+  static char established[] = "HTTP/1.1 200 Connection established\r\n\r\n";
+  int serverfd;
 
-    /* host에서 port 분리 */
-    char *colon_pos = strchr(host, ':'); // ':' 위치 찾기기
-    if(colon_pos == NULL){ // :가 없으면
-      // 포트가 없으면 기본값 80
-      strcpy(port, "80");
-    }else{ // ':' 가 있으면
-      strcpy(port, colon_pos + 1); // port에 ':' 이후 값 복사
-      *colon_pos = '\0'; // ':' 위치에 널 문자 삽입
+  printf("Tunnel to %s:%s\n", rq->host, rq->port);
+  if ((serverfd = open_clientfd(rq->host, rq->port)) < 0) {
+    clienterror(rq->connfd, "502", "Bad Gateway", "Proxy could not connect to the server");
+    return 0;
+  }
+  if (rio_writen(rq->connfd, established, sizeof(established) - 1) < 0 ||
+      // 클라이언트가 200을 기다리지 않고 미리 보낸 바이트 (TLS ClientHello 등)
+      (rq->rio.rio_cnt > 0 && rio_writen(serverfd, rq->rio.rio_bufptr, rq->rio.rio_cnt) < 0) ||
+      tunnel_start(rq->connfd, serverfd) < 0) {
+    Close(serverfd);
+    return 0;
+  }
+  return 1;
+}
+
+/*
+ * request_buffered - Rio 버퍼에 헤더 끝(빈 줄)까지 온 요청이 이미 들어 있는지
+ *   (있으면 read_request가 블록하지 않고 읽을 수 있음)
+ */
+int request_buffered(rio_t *rp) {
+  char *p = rp->rio_bufptr, *end = rp->rio_bufptr + rp->rio_cnt;
+
+  while (p < end && (*p == '\r' || *p == '\n')) // 요청 앞의 빈 줄은 http_parse도 건너뜀
+    p++;
+  for (; end - p >= 4; p++)
+    if (p[0] == '\r' && p[1] == '\n' && p[2] == '\r' && p[3] == '\n')
+      return 1;
+  return 0;
+}
+
+/*
+ * serve_pipeline - rq 뒤로 Rio 버퍼에 이미 와 있는 요청들까지 한꺼번에 처리
+ *
+ *   1. 버퍼에 온 요청을 PIPELINE_MAX개까지 파싱 (더 기다리지는 않음)
+ *   2. 모두 먼저 보냄: 캐시에 있으면 여기서 꺼내 두고, 없으면 원서버(가능하면 풀)에 요청 전송
+ *   3. 요청 순서대로 응답: 앞 요청이 미스라도 뒤 요청들은 이미 원서버로 가 있으므로
+ *      원서버 왕복이 겹치고, 미스 뒤에 줄 선 캐시 적중은 왕복 없이 바로 나감
+ *
+ *   슬롯 배열이 순서를 지키는 reorder 큐 역할을 한다 (응답은 소켓 버퍼에서 차례를 기다림).
+ *   슬롯에는 요청마다 다른 상태만 두고 (slot_t, arena에), 단계마다 rq로 꺼내서 처리한다.
+ *   CONNECT는 묶음을 끝내고, 앞 요청들에 다 응답한 뒤 자기 차례에 터널을 연다.
+ *   뒤에 형식이 틀린 요청(400/431)이 있으면 그 에러 응답도 맨 끝 슬롯으로 보내고 닫는다.
+ *   반환: 연결을 계속 쓸 수 있으면 0, 닫아야 하면 -1, CONNECT 터널로 connfd를 넘겼으면 1
+ */
+int serve_pipeline(request_t *rq) {
+  slot_t *q[PIPELINE_MAX];    // 파싱한 요청들 (묶음이 끝나고 다음 read_request 때 arena와 같이 해제)
+  cobj_t *hit[PIPELINE_MAX];  // 캐시에서 고정한 응답 (NULL이면 미스)
+  size_t hitsize[PIPELINE_MAX];
+  int sent[PIPELINE_MAX];     // 미스: 원서버로 보냈으면 1
+  int i, n = 0, more = 1, last = 0, tunneled = 0, err = 0;
+
+  do { // 1. 이미 와 있는 요청 파싱
+    // 본문은 rq의 Rio 버퍼에서 읽어야 하고, CONNECT 뒤의 바이트는 터널로 가야 하므로 맨 끝에 둠
+    last = has_body(rq) || !strcasecmp(rq->method, "CONNECT");
+    q[n] = arena_alloc(&rq->arena, sizeof(slot_t));
+    slot_save(q[n++], rq);
+  } while (!last && n < PIPELINE_MAX && rq->keepalive && request_buffered(&rq->rio) &&
+           (more = (err = read_next(rq)) == 0));
+  printf("Pipeline: %d requests\n", n);
+
+  for (i = 0; i < n; i++) { // 2. 모두 먼저 보내기
+    hit[i] = NULL;
+    sent[i] = 0;
+    if (last && i == n - 1) // 본문 있는 요청과 CONNECT는 자기 차례에 (100 Continue나 200이 앞 응답들보다 먼저 나가지 않게)
+      continue;
+    if (q[i]->cacheable && (hit[i] = cache_pin(q[i]->key, &hitsize[i])) != NULL)
+      continue;
+    slot_load(rq, q[i]);
+    sent[i] = open_server(rq, 1) == 0;
+    slot_save(q[i], rq);
+  }
+
+  for (i = 0; i < n; i++) { // 3. 요청 순서대로 응답
+    if (i > 0 && !q[i - 1]->keepalive) { // 앞에서 연결을 닫기로 함: 나머지는 버림
+      q[i]->keepalive = 0;
+      if (hit[i])
+        cache_unpin(hit[i]);
+      else if (sent[i])
+        Close(q[i]->serverfd);
+      continue;
     }
+    slot_load(rq, q[i]);
+    if (last && i == n - 1) {
+      if (!strcasecmp(rq->method, "CONNECT")) { // keepalive 0
+        tunneled = open_tunnel(rq);
+        break;
+      }
+      sent[i] = open_server(rq, 1) == 0;
+    }
+    if (hit[i]) {
+      printf("Cache hit: %s\n", rq->url);
+      send_cached(rq, hit[i], hitsize[i]);
+      cache_unpin(hit[i]);
+    }
+    else if (sent[i]) {
+      forward_response(rq);
+      release_server(rq);
+    }
+    else {
+      clienterror(rq->connfd, "502", "Bad Gateway", "Proxy could not connect to the server");
+      rq->keepalive = 0;
+    }
+    slot_save(q[i], rq);
   }
-  else if (url[0] == '/') {
-    // 상대 URL: /path 형태 - 에러 메시지와 함께 거부
-    printf("Relative URL not supported in proxy mode: %s\n", url);
-    printf("Please use absolute URL like: http://example.com/path\n");
+
+  if (tunneled)
+    return 1;
+  if (err > 0 && q[n - 1]->keepalive) // 형식이 틀린 요청: 마지막 슬롯으로, 앞 응답들 뒤에 보내고 닫음
+    send_read_error(rq, err);
+  rq->keepalive = more && q[n - 1]->keepalive; // 마지막 요청의 결과를 따름
+  return rq->keepalive ? 0 : -1;
+}
+
+/*
+ * slot_save - rq에서 요청마다 다른 상태를 파이프라인 슬롯에 맡기기
+ */
+static void slot_save(slot_t *s, request_t *rq) {
+  s->hp = rq->hp;
+  s->method = rq->method;
+  s->url = rq->url;
+  s->path = rq->path;
+  s->key = rq->key;
+  memcpy(s->host, rq->host, MAX_HOST);
+  memcpy(s->port, rq->port, MAX_PORT);
+  s->host_header = rq->host_header;
+  s->body_clen = rq->body_clen;
+  s->body_chunked = rq->body_chunked;
+  s->expect_continue = rq->expect_continue;
+  s->http11 = rq->http11;
+  s->keepalive = rq->keepalive;
+  s->cacheable = rq->cacheable;
+  s->retriable = rq->retriable;
+  s->serverfd = rq->serverfd;
+  s->reused = rq->reused;
+  s->upstream_keepalive = rq->upstream_keepalive;
+}
+
+/*
+ * slot_load - 슬롯에 맡긴 요청 상태를 rq로 꺼내기 (연결 상태인 connfd, rio, nreq, arena는 그대로)
+ */
+static void slot_load(request_t *rq, slot_t *s) {
+  rq->hp = s->hp;
+  rq->method = s->method;
+  rq->url = s->url;
+  rq->path = s->path;
+  rq->key = s->key;
+  memcpy(rq->host, s->host, MAX_HOST);
+  memcpy(rq->port, s->port, MAX_PORT);
+  rq->host_header = s->host_header;
+  rq->body_clen = s->body_clen;
+  rq->body_chunked = s->body_chunked;
+  rq->expect_continue = s->expect_continue;
+  rq->http11 = s->http11;
+  rq->keepalive = s->keepalive;
+  rq->cacheable = s->cacheable;
+  rq->retriable = s->retriable;
+  rq->serverfd = s->serverfd;
+  rq->reused = s->reused;
+  rq->upstream_keepalive = s->upstream_keepalive;
+}
+
+/*
+ * request_init - 새 클라이언트 연결의 요청 상태 초기화
+ */
+void request_init(request_t *rq, int connfd) {
+  rq->connfd = connfd;
+  rq->nreq = 0;
+  rq->keepalive = 0;
+  rio_readinitb(&rq->rio, connfd); // Rio 구조체를 클라이언트 소켓으로 초기화
+  arena_init(&rq->arena, rq->arena_buf, sizeof(rq->arena_buf));
+}
+
+/*
+ * request_deinit - 연결이 끝날 때 rq가 쓰던 메모리 해제 (arena에서 넘친 블록)
+ */
+void request_deinit(request_t *rq) {
+  arena_reset(&rq->arena);
+}
+
+/*
+ * has_token - "close, Upgrade" 같은 쉼표로 구분된 헤더 값 value[0..vlen)에 token이 있는지 (대소문자 무시)
+ */
+static int has_token(char *value, size_t vlen, char *token) {
+  char *end = value + vlen, *p;
+  size_t len = strlen(token);
+
+  while (value < end) {
+    while (value < end && (*value == ' ' || *value == '\t' || *value == ','))
+      value++;
+    for (p = value; p < end && !strchr(" \t,;=\r\n", *p); p++) // private="..." 같은 인자도 이름만
+      ;
+    if ((size_t)(p - value) == len && strncasecmp(value, token, len) == 0)
+      return 1;
+    while (p < end && *p != ',') // 다음 쉼표까지 (";q=..." 같은 파라미터 건너뜀)
+      p++;
+    value = p;
+  }
+  return 0;
+}
+
+/*
+ * has_body - 요청에 본문이 있는지 (Content-Length > 0 또는 chunked)
+ */
+static int has_body(request_t *rq) {
+  return rq->body_chunked || rq->body_clen > 0;
+}
+
+/*
+ * parse_length - Content-Length 값 (숫자만, 넘치면 -2)
+ */
+static long parse_length(slice_t v) {
+  long n = 0;
+  size_t i;
+
+  if (v.len == 0)
+    return -2;
+  for (i = 0; i < v.len; i++) {
+    if (v.p[i] < '0' || v.p[i] > '9' || n > (LONG_MAX - 9) / 10)
+      return -2;
+    n = n * 10 + (v.p[i] - '0');
+  }
+  return n;
+}
+
+/*
+ * scan_headers - 파싱한 헤더 중 프록시가 볼 것들을 rq에 기록
+ *   (Host 값, 본문 길이, Expect, Connection 토큰) 헤더 줄 자체는 받은 버퍼에 그대로 둠
+ *   Authorization이나 Cookie가 있으면 응답이 이 사용자 것일 수 있어서 rq->cacheable = 0
+ *   반환: 본문 길이가 이상하면 -1
+ */
+static int scan_headers(request_t *rq, int *conn_close, int *conn_keep) {
+  http_header_t *h;
+  long clen;
+  int i;
+
+  rq->host_header.p = NULL;
+  rq->host_header.len = 0;
+  rq->body_clen = -1;
+  rq->body_chunked = 0;
+  rq->expect_continue = 0;
+  rq->cacheable = 1; // 메소드와 본문은 parse_request가 마저 봄
+  *conn_close = *conn_keep = 0;
+  for (i = 0; i < rq->hp.nheaders; i++) {
+    h = &rq->hp.headers[i];
+    switch (h->id) {
+    case HDR_HOST:
+      rq->host_header = h->value;
+      break;
+    case HDR_CONNECTION:
+    case HDR_PROXY_CONNECTION:
+      // 원서버로는 안 넘기지만 keep-alive 판단에 필요
+      *conn_close |= has_token(h->value.p, h->value.len, "close");
+      *conn_keep |= has_token(h->value.p, h->value.len, "keep-alive");
+      break;
+    case HDR_EXPECT: // 프록시가 직접 100 Continue로 답함
+      rq->expect_continue = has_token(h->value.p, h->value.len, "100-continue");
+      break;
+    case HDR_AUTHORIZATION:
+    case HDR_COOKIE:
+      rq->cacheable = 0;
+      break;
+    case HDR_CONTENT_LENGTH:
+      // 값이 다른 Content-Length가 여러 개면 본문 끝이 모호함
+      if ((clen = parse_length(h->value)) < 0 || (rq->body_clen >= 0 && clen != rq->body_clen))
+        return -1;
+      rq->body_clen = clen;
+      break;
+    case HDR_TRANSFER_ENCODING:
+      if (!has_token(h->value.p, h->value.len, "chunked")) // 모르는 인코딩은 끝을 알 수 없음
+        return -1;
+      rq->body_chunked = 1;
+      break;
+    default:
+      break;
+    }
+  }
+  // 둘 다 있으면 앞뒤 프록시가 본문 끝을 다르게 볼 수 있으므로 (request smuggling) 거부
+  return rq->body_chunked && rq->body_clen >= 0 ? -1 : 0;
+}
+
+/*
+ * read_request - 지난 요청이 쓴 arena를 비우고 다음 요청 읽기
+ *   (앞에 응답을 기다리는 요청이 없으므로 400/431은 바로 보냄)
+ */
+int read_request(request_t *rq) {
+  int rc;
+
+  arena_reset(&rq->arena); // 지난 요청(파이프라인이면 한 묶음)의 헤더 배열 등을 한꺼번에 해제
+  if ((rc = read_next(rq)) > 0) {
+    send_read_error(rq, rc);
     return -1;
   }
-  else {
-    // 잘못된 URL 형태
-    printf("Invalid URL format: %s\n", url);
+  return rc;
+}
+
+/*
+ * send_read_error - read_next가 돌려준 에러를 클라이언트에 응답으로 보내기
+ */
+static void send_read_error(request_t *rq, read_error_t err) {
+  switch (err) {
+  case READ_LARGE:
+    clienterror(rq->connfd, "431", "Request Header Fields Too Large", "Proxy could not read the request");
+    break;
+  case READ_FRAMING:
+    clienterror(rq->connfd, "400", "Bad Request", "Proxy could not find the end of the request body");
+    break;
+  default:
+    clienterror(rq->connfd, "400", "Bad Request", "Proxy could not parse the request");
+    break;
+  }
+}
+
+/*
+ * read_next - 요청 라인과 헤더를 읽어서 rq에 파싱해 두기 (arena는 비우지 않음)
+ *   헤더는 Rio 버퍼에 받은 그대로 http_parse로 파싱 (덜 왔으면 버퍼를 앞당겨 더 받고 이어서)
+ *   같은 연결의 두 번째 요청부터는 KEEPALIVE_TIMEOUT까지만 기다림
+ *   반환: 성공 0, 응답 없이 닫을 때 -1, 에러 응답이 필요하면 read_error_t (보내지는 않음,
+ *         파이프라인이면 앞 요청들의 응답이 먼저 나가야 하므로)
+ */
+static int read_next(request_t *rq) {
+  rio_t *rp = &rq->rio;
+  http_parser_t *hp = &rq->hp;
+  int n, conn_close, conn_keep;
+
+  // 클라이언트로부터 요청 읽기
+  // 워커 스레드에서 돌기 때문에 에러가 나도 프로세스를 죽이는 대문자 wrapper 대신 rio_* 사용
+  if (rq->nreq > 0 && rio_readable(rp, KEEPALIVE_TIMEOUT) <= 0)
+    return -1; // 다음 요청 없이 idle timeout
+  rq->nreq++;
+  http_parser_init(hp, &rq->arena);
+  while ((n = http_parse(hp, rp->rio_bufptr, rp->rio_cnt)) == HTTP_PARSE_AGAIN) {
+    if (rp->rio_cnt == RIO_BUFSIZE) { // 헤더가 Rio 버퍼보다 큼
+      n = HTTP_PARSE_LARGE;
+      break;
+    }
+    if (rio_fillmore(rp) <= 0) // EOF/에러
+      return -1;
+  }
+  if (n == HTTP_PARSE_LARGE)
+    return READ_LARGE;
+  if (n < 0)
+    return READ_BAD;
+  rp->rio_bufptr += n; // 헤더는 다 읽음 (본문이나 다음 요청은 버퍼에 남음)
+  rp->rio_cnt -= n;
+
+  // method, url은 뒤에 공백이 있던 자리를 NUL로 바꿔서 제자리에서 문자열로 씀 (path는 url의 끝부분)
+  rq->method = hp->method.p;
+  rq->method[hp->method.len] = '\0';
+  rq->url = hp->uri.p;
+  rq->url[hp->uri.len] = '\0';
+  rq->path = hp->path.len > 0 ? hp->path.p : "/";
+  printf("Request line: %s %s %.*s\n", rq->method, rq->url, (int)hp->version.len, hp->version.p);
+
+  if (scan_headers(rq, &conn_close, &conn_keep) < 0) {
+    printf("Bad request body framing\n");
+    return READ_FRAMING;
+  }
+
+  // host, port는 getaddrinfo에 넘겨야 해서 복사 (길면 자르지 않고 거부)
+  if (hp->host.len == 0 || slice_copy(rq->host, MAX_HOST, hp->host) < 0 ||
+      (hp->port.len > 0 && slice_copy(rq->port, MAX_PORT, hp->port) < 0)) {
+    printf("Invalid URL format: %s\n", rq->url);
+    return -1;
+  }
+
+  // CONNECT host:port - 터널 (원서버에는 아무것도 보내지 않음)
+  if (!strcasecmp(rq->method, "CONNECT")) {
+    if (hp->scheme.len > 0 || hp->port.len == 0)
+      return -1;
+    rq->keepalive = 0;
+    rq->cacheable = 0; // 파이프라인이면 rq에 앞 요청의 값이 남아 있음
+    rq->key = NULL;
+    rq->retriable = 0;
+    return 0;
+  }
+
+  // GET과 본문을 실을 수 있는 메소드만 허용 (strcasecmp는 대소문자 무시 비교)
+  if (strcasecmp(rq->method, "GET") && strcasecmp(rq->method, "POST") && strcasecmp(rq->method, "PUT") &&
+      strcasecmp(rq->method, "PATCH") && strcasecmp(rq->method, "DELETE")) {
+    printf("Not implemented: %s method\n", rq->method);  // 에러 메시지 출력
+    return -1;                      // 함수 종료
+  }
+  if (!slice_eq(hp->scheme, "http")) { // 프록시에는 절대 URL로 와야 함
+    printf("Invalid URL format: %s\n", rq->url);
     return -1;
   }
+  if (hp->port.len == 0)
+    strcpy(rq->port, "80");
+  printf("Parsed URL - Host : %s, Port : %s, Path : %s\n", rq->host, rq->port, rq->path);
+
+  // 본문이 있으면 그 본문을 읽는 순간 slice들이 가리키는 버퍼가 덮이므로 캐시/재전송 안 함
+  rq->cacheable &= !strcasecmp(rq->method, "GET") && !has_body(rq);
+  rq->key = rq->cacheable ? http_cache_key(hp) : NULL;
+  rq->retriable = !has_body(rq) && strcasecmp(rq->method, "POST") && strcasecmp(rq->method, "PATCH");
 
-  printf("Parsed URL - Host : %s, Port : %s, Path : %s\n", host, port, path); // 파싱 결과
-  return 0; // 성공 반환!
+  // keep-alive 여부: HTTP/1.1은 기본 유지, HTTP/1.0은 요청했을 때만
+  rq->http11 = slice_eq(hp->version, "HTTP/1.1");
+  rq->expect_continue &= rq->http11 && has_body(rq); // 100 Continue는 HTTP/1.1에게만
+  rq->keepalive = rq->http11;
+  if (conn_close)
+    rq->keepalive = 0;
+  else if (conn_keep)
+    rq->keepalive = 1;
+  if (rq->nreq >= MAX_KEEPALIVE_REQS) // 연결 하나가 워커를 너무 오래 붙잡지 않도록
+    rq->keepalive = 0;
+  return 0;
 }
 
 /*
- * collect_headers - 클라이언트 헤더를 수집하고 필터링
+ * open_server - 원서버 연결을 얻어서 요청 전달
+ *   pooled면 먼저 upstream 풀에서 놀던 연결을 찾고, 그 연결로 보내기가 실패하면 새로 연결
+ *   반환: 성공 0 (rq->serverfd, rq->reused), 연결 실패 -1, 전송 실패 -2
  */
-void collect_headers(rio_t *rio, char *headers, char *host_header) { // 헤더 수집 함수
-  char buf[MAXLINE]; // 한 줄씩 읽는 버퍼
+static int open_server(request_t *rq, int pooled) {
+  rq->reused = 0;
+  if (pooled && (rq->serverfd = upstream_get(rq->host, rq->port)) >= 0) {
+    if (forward_request(rq) == 0)
+      rq->reused = 1;
+    else
+      Close(rq->serverfd); // 원서버가 그새 닫음: 새 연결로
+  }
 
-  headers[0] = '\0';
-  host_header[0] = '\0';
+  if (!rq->reused) {
+    // 원서버에 연결
+    rq->serverfd = open_clientfd(rq->host, rq->port); // 파싱된 host, port로 서버에 연결 (실패해도 종료하지 않음)
+    if (rq->serverfd < 0)
+      return -1;
 
-  // 헤더를 한 줄씩 읽기
-  while (Rio_readlineb(rio, buf, MAXLINE) > 0) { // 헤더 한 줄씩 읽기
-      if (strcmp(buf, "\r\n") == 0) { // 빈 줄이면
-        break; // 그만 읽거라 루프 종료
-      }
+    // 요청 전달
+    if (forward_request(rq) < 0) { // 서버로 HTTP 요청 전송
+      Close(rq->serverfd); // 전송 실패하면 서버 연결만 닫고 종료
+      rq->serverfd = -1;
+      return -2;
+    }
+  }
 
-      if (strncasecmp(buf, "Host:", 5) == 0){ // Host: 로 시작하면
-        strcpy(host_header, buf); // host_header에 따로 저장
-      }
-      // 우리가 강제로 설정할 헤더들은 무시
-      else if(strncasecmp(buf, "User-Agent:", 11) != 0 && 
-              strncasecmp(buf, "Connection:", 11) != 0 &&
-              strncasecmp(buf, "Proxy-Connection:", 17) != 0)
-      {
-        /*
-          "User-Agent:", "Connection:", "Proxy-Connection:"
-          를 제외한 나머지 헤더는 그대로 저장
-        */ 
-        strcat(headers, buf); // headers 문자열에 이어붙이기
-      }
+  // 요청 본문 (헤더 뒤에 이어서, 받는 대로 흘려보냄)
+  if (has_body(rq) && send_body(rq) < 0) {
+    Close(rq->serverfd);
+    rq->serverfd = -1;
+    rq->keepalive = 0; // 클라이언트 쪽 본문이 어디서 끝나는지 모름
+    return -2;
   }
+  return 0;
 }
 
 /*
- * forward_request - 원서버에 요청 전달
+ * send_body - 요청 본문을 클라이언트에서 받는 대로 원서버로 흘려보내기
+ *   Content-Length든 chunked든 받은 모양 그대로 보냄 (chunked는 디코더로 끝만 찾음)
+ *   본문을 모아두지 않고 Rio 버퍼나 pipe 하나 분량씩만 옮기므로 업로드가 커도 메모리는
+ *   일정하고, 원서버가 늦게 읽으면 쓰기가 막혀서 클라이언트에서도 그만큼 늦게 읽음
+ *   반환: 성공 0, 어느 한쪽이 끊겼거나 chunked 형식이 틀리면 -1
  */
-void forward_request(int serverfd, char *method, char *path, char *headers, char *host) {
-  char request[MAXLINE]; // 요청 메세지 작성용 버퍼
+static int send_body(request_t *rq) {
+  static char cont[] = "HTTP/1.1 100 Continue\r\n\r\n";
+  rio_t *rp = &rq->rio;
+  chunk_decoder_t d;
+  char *data;
+  size_t dlen, used;
+  long left = rq->body_clen, n;
 
-  // 요청라인 : Get /path HTTP/1.0
-  sprintf(request, "%s %s HTTP/1.0\r\n", method, path);  // HTTP/1.0 요청라인 작성
-  Rio_writen(serverfd, request, strlen(request));        // 서버로 전송
+  // Expect: 100-continue - 클라이언트는 이걸 받아야 본문을 보냄 (원서버로는 안 넘김)
+  if (rq->expect_continue && rio_writen(rq->connfd, cont, sizeof(cont) - 1) < 0)
+    return -1;
 
-  // Host 헤더
-  sprintf(request, "Host: %s\r\n", host);  // Host 헤더 작성
-  Rio_writen(serverfd, request, strlen(request));  // 서버로 전송
+  if (!rq->body_chunked) { // Content-Length: 크면 splice, 아니면 Rio 버퍼에서 바로
+    if (left >= SPLICE_MIN && (n = splice_body(rp, rq->serverfd, left)) >= 0)
+      return n == left ? 0 : -1;
+    for (; left > 0; left -= n) {
+      if (rio_fillb(rp) <= 0)
+        return -1;
+      n = rp->rio_cnt < left ? rp->rio_cnt : left;
+      if (rio_writen(rq->serverfd, rp->rio_bufptr, n) < 0)
+        return -1;
+      rp->rio_bufptr += n;
+      rp->rio_cnt -= n;
+    }
+    return 0;
+  }
+
+  // chunked: 버퍼에 온 만큼 디코더로 훑어서 끝(0 chunk + trailer)까지의 바이트를 그대로 보냄
+  // (뒤에 남은 바이트는 파이프라인의 다음 요청)
+  chunk_init(&d);
+  while (!chunk_done(&d)) {
+    if (rio_fillb(rp) <= 0)
+      return -1;
+    for (used = 0; used < rp->rio_cnt && !chunk_done(&d) && !chunk_error(&d);)
+      used += chunk_decode(&d, rp->rio_bufptr + used, rp->rio_cnt - used, &data, &dlen);
+    if (chunk_error(&d) || rio_writen(rq->serverfd, rp->rio_bufptr, used) < 0)
+      return -1;
+    rp->rio_bufptr += used;
+    rp->rio_cnt -= used;
+  }
+  return 0;
+}
 
-  // User-Agent 헤더 (고정)
-  Rio_writen(serverfd, (void *)user_agent_hdr, strlen(user_agent_hdr));  // 고정 User-Agent 전송
+/*
+ * connect_server - 원서버에 연결하고 요청 전달 (실패하면 필요시 502 응답)
+ */
+int connect_server(request_t *rq) {
+  int rc = open_server(rq, 1);
 
-  // Connection 헤더
-  sprintf(request, "Connection: close\r\n");  // Connection: close 헤더 작성
-  Rio_writen(serverfd, request, strlen(request));  // 서버로 전송
+  if (rc == -1) {
+    printf("Error connecting to server: %s\n", rq->host); // 연결 실패 시 에러 메세지
+    clienterror(rq->connfd, "502", "Bad Gateway", "Proxy could not connect to the server");
+  }
+  return rc < 0 ? -1 : 0;
+}
 
-  // Proxy-Connection 헤더
-  sprintf(request, "Proxy-Connection: close\r\n");  // Proxy-Connection: close 헤더 작성
-  Rio_writen(serverfd, request, strlen(request));   // 서버로 전송
+/*
+ * release_server - 응답이 끝난 원서버 연결을 풀에 돌려주거나 닫기
+ */
+void release_server(request_t *rq) {
+  if (rq->serverfd < 0)
+    return;
+  if (rq->upstream_keepalive)
+    upstream_put(rq->host, rq->port, rq->serverfd);
+  else
+    Close(rq->serverfd); // 서버 연결 종료
+  rq->serverfd = -1;
+}
 
-  // 나머지 헤더들
-  if (strlen(headers) > 0) {          // 추가 헤더가 있으면
-    Rio_writen(serverfd, headers, strlen(headers));  // 나머지 헤더들도 전송
+/*
+ * header_forwarded - 원서버로 그대로 넘길 헤더인지
+ *   Host, User-Agent, Connection, Proxy-Connection은 프록시가 새로 쓰고, Expect는 프록시가 답함
+ */
+static int header_forwarded(http_header_t *h) {
+  switch (h->id) {
+  case HDR_HOST:
+  case HDR_USER_AGENT:
+  case HDR_CONNECTION:
+  case HDR_PROXY_CONNECTION:
+  case HDR_EXPECT:
+    return 0;
+  default:
+    return 1;
   }
+}
+
+#define REQUEST_IOV (10 + MAX_HEADERS) // request_iov가 채울 수 있는 최대 조각 수
 
+/*
+ * request_iov - 원서버에 보낼 요청을 iovec 조각들로 (헤더는 받은 버퍼를 그대로 가리킴)
+ *   요청 라인, Host, User-Agent, Connection은 새로 쓰고, 넘길 헤더 줄들은 버퍼에서
+ *   이어져 있으면 iovec 하나로 합침 (보통 헤더 전체가 조각 한두 개)
+ *   close: HTTP/1.0 + Connection: close로 (응답마다 닫는 이벤트 루프용),
+ *          아니면 upstream 풀에서 재사용하므로 HTTP/1.1 keep-alive로
+ *   반환: 채운 iovec 수
+ */
+static int request_iov(struct iovec *iov, http_parser_t *hp, char *path, size_t pathlen,
+                       slice_t host, int close) {
+  static char space[] = " ";
+  static char version_host11[] = " HTTP/1.1\r\nHost: ";
+  static char version_host10[] = " HTTP/1.0\r\nHost: ";
+  static char crlf[] = "\r\n";
+  static char keepalive_hdrs[] = "Connection: keep-alive\r\n";
+  static char close_hdrs[] = "Connection: close\r\nProxy-Connection: close\r\n";
+  http_header_t *h;
+  int i, n = 0;
+
+#define IOV(p, len) (iov[n].iov_base = (void *)(p), iov[n].iov_len = (len), n++)
+  // 요청라인 : GET /path HTTP/1.1
+  IOV(hp->method.p, hp->method.len);
+  IOV(space, 1);
+  IOV(path, pathlen);
+  if (close)
+    IOV(version_host10, sizeof(version_host10) - 1);
+  else
+    IOV(version_host11, sizeof(version_host11) - 1);
+  // Host 헤더
+  IOV(host.p, host.len);
+  IOV(crlf, 2);
+  // User-Agent 헤더 (고정), Connection 헤더
+  IOV(user_agent_hdr, strlen(user_agent_hdr));
+  if (close)
+    IOV(close_hdrs, sizeof(close_hdrs) - 1);
+  else
+    IOV(keepalive_hdrs, sizeof(keepalive_hdrs) - 1);
+  // 나머지 헤더들: 바로 앞 조각에 이어지는 줄이면 그 조각을 늘림
+  for (i = 0; i < hp->nheaders; i++) {
+    h = &hp->headers[i];
+    if (!header_forwarded(h))
+      continue;
+    if (i > 0 && (char *)iov[n - 1].iov_base + iov[n - 1].iov_len == h->line.p)
+      iov[n - 1].iov_len += h->line.len;
+    else
+      IOV(h->line.p, h->line.len);
+  }
   // 헤더 종료 (빈 줄)
-  Rio_writen(serverfd, "\r\n", 2);   // 헤더 끝을 알리는 빈 줄 전송
-    
+  IOV(crlf, 2);
+#undef IOV
+  return n;
+}
+
+/*
+ * forward_request - 원서버에 요청 전달
+ *   요청 조각들을 복사하지 않고 iovec으로 가리켜서 writev 한 번에 보냄
+ *   (syscall 하나, 보통 TCP 세그먼트도 하나)
+ */
+int forward_request(request_t *rq) {
+  struct iovec iov[REQUEST_IOV]; // 요청 메세지 조각들
+  slice_t host = rq->host_header; // Host 헤더 처리 (없으면 URL의 host)
+  int n;
+
+  if (host.len == 0) {
+    host.p = rq->host;
+    host.len = strlen(rq->host);
+  }
+  n = request_iov(iov, &rq->hp, rq->path, strlen(rq->path), host, 0);
+  if (rio_writev(rq->serverfd, iov, n) < 0) // 서버로 한 번에 전송
+    return -1;
+
   printf("Request forwarded to server\n");  // 요청 전달 완료 메시지
+  return 0;
+}
+
+/*
+ * prepare_request - 다 파싱한 요청으로 원서버 요청을 버퍼 하나에 작성 (이벤트 루프용)
+ *   non-blocking 이벤트 루프는 한 번에 못 보낸 나머지를 나중에 이어서 보내야 해서
+ *   iovec 대신 연속된 버퍼가 필요함
+ */
+int prepare_request(http_parser_t *hp, char *out, size_t size, char *host, char *port) {
+  struct iovec iov[REQUEST_IOV];
+  char tmp[MAXBUF]; // out이 요청을 받은 버퍼와 같을 수 있어서 따로 모은 뒤 복사
+  slice_t hosthdr = {NULL, 0};
+  size_t len = 0;
+  int i, n;
+
+  printf("Request line: %.*s %.*s\n", (int)hp->method.len, hp->method.p, (int)hp->uri.len, hp->uri.p);
+  if (!slice_eq(hp->method, "GET")) { // GET만 허용 (본문 중계는 handle_request 쪽만)
+    printf("Not implemented: %.*s method\n", (int)hp->method.len, hp->method.p);
+    return PREP_CLOSE;
+  }
+  if (!slice_eq(hp->scheme, "http") || hp->host.len == 0 ||
+      slice_copy(host, MAX_HOST, hp->host) < 0 ||
+      (hp->port.len > 0 ? slice_copy(port, MAX_PORT, hp->port) : slice_copy(port, MAX_PORT, (slice_t){"80", 2})) < 0) {
+    printf("Error parsing URL: %.*s\n", (int)hp->uri.len, hp->uri.p);
+    return PREP_CLOSE;
+  }
+  for (i = 0; i < hp->nheaders; i++)
+    if (hp->headers[i].id == HDR_HOST)
+      hosthdr = hp->headers[i].value;
+  if (hosthdr.len == 0)
+    hosthdr = hp->host;
+
+  n = request_iov(iov, hp, hp->path.len > 0 ? hp->path.p : "/", hp->path.len > 0 ? hp->path.len : 1,
+                  hosthdr, 1);
+  for (i = 0; i < n; i++) {
+    if (len + iov[i].iov_len > sizeof(tmp) || len + iov[i].iov_len > size) // 잘리면 실패
+      return PREP_BAD;
+    memcpy(tmp + len, iov[i].iov_base, iov[i].iov_len);
+    len += iov[i].iov_len;
+  }
+  memcpy(out, tmp, len);
+  return len;
+}
+
+/*
+ * resolve_server - open_clientfd와 같은 조건으로 원서버 주소 목록 얻기
+ */
+int resolve_server(char *host, char *port, struct addrinfo **res) {
+  struct addrinfo hints;
+  int rc;
+
+  memset(&hints, 0, sizeof(struct addrinfo));
+  hints.ai_socktype = SOCK_STREAM;  // 연결용
+  hints.ai_flags = AI_NUMERICSERV;  // 숫자 포트
+  hints.ai_flags |= AI_ADDRCONFIG;  // 연결에 권장
+  if ((rc = getaddrinfo(host, port, &hints, res)) != 0) {
+    fprintf(stderr, "getaddrinfo failed (%s:%s): %s\n", host, port, gai_strerror(rc));
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * splice_body - 본문 len 바이트를 pipe를 거쳐 커널 안에서 rp의 소켓 -> outfd로 중계
+ *   (응답은 원서버 -> 클라이언트, 요청 본문은 클라이언트 -> 원서버)
+ *   반환: outfd에 보낸 바이트 수 (len보다 작으면 중간에 끊김),
+ *         pipe를 못 얻었으면 -1 (호출한 쪽이 복사로 중계)
+ */
+static long splice_body(rio_t *rp, int outfd, long len) {
+  int p[2];      // pipe 풀에서 얻은 pipe
+  ssize_t n, m;  // pipe에 넣은 / pipe에서 뺀 바이트 수
+  ssize_t inpipe = 0; // pipe에 남은 바이트 수 (0이 아니면 pipe를 재사용하지 않음)
+  long sent = 0; // outfd에 보낸 바이트 수
+
+  if (pipe_get(p) < 0)
+    return -1;
+
+  // Rio가 헤더와 함께 이미 읽어둔 본문 앞부분은 그냥 보내기
+  n = rp->rio_cnt < len ? rp->rio_cnt : len;
+  if (n > 0) {
+    if (rio_writen(outfd, rp->rio_bufptr, n) < 0)
+      len = 0; // 받는 쪽이 끊음
+    else
+      sent = n;
+    rp->rio_bufptr += n;
+    rp->rio_cnt -= n;
+    len -= n;
+  }
+
+  // 나머지: rp의 소켓 -> pipe -> outfd (EAGAIN이면 코루틴 모드에서 yield)
+  while (len > 0 && inpipe == 0) {
+    n = splice_fd(rp->rio_fd, p[1], len < SPLICE_CHUNK ? len : SPLICE_CHUNK);
+    if (n == 0) // 보내는 쪽이 일찍 끊음
+      break;
+    if (n < 0) {
+      if (errno == EINTR || rio_wait(rp->rio_fd, RIO_WAIT_READ) == 0)
+        continue;
+      break;
+    }
+    for (inpipe = n; inpipe > 0; inpipe -= m) { // pipe를 다 비울 때까지
+      if ((m = splice_fd(p[0], outfd, inpipe)) <= 0) {
+        if (m < 0 && (errno == EINTR || rio_wait(outfd, RIO_WAIT_WRITE) == 0)) {
+          m = 0;
+          continue;
+        }
+        break; // 받는 쪽이 끊음: 남은 데이터와 함께 pipe는 버림
+      }
+    }
+    if (inpipe == 0)
+      sent += n;
+    len -= n;
+  }
+  pipe_put(p, inpipe != 0);
+  return sent;
+}
+
+/*
+ * line_value - 헤더 한 줄(line[0..n), ':' 있음)에서 값 부분 (앞뒤 공백과 줄바꿈 뺌)
+ */
+static slice_t line_value(char *line, size_t n) {
+  char *end = line + n;
+  slice_t v;
+
+  v.p = (char *)memchr(line, ':', n) + 1;
+  while (v.p < end && (*v.p == ' ' || *v.p == '\t'))
+    v.p++;
+  while (end > v.p && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' ' || end[-1] == '\t'))
+    end--;
+  v.len = end - v.p;
+  return v;
+}
+
+/*
+ * parse_framing - 응답 헤더 한 줄에서 본문 길이 정보 읽기
+ *   id: 헤더 종류, value: 헤더 값
+ *   clen: Content-Length 값, chunked: Transfer-Encoding이 chunked면 1 (둘 다 출력)
+ *   반환: Content-Length가 숫자가 아니거나 앞의 것과 다르면 -1 (본문 끝을 믿을 수 없음)
+ */
+static int parse_framing(header_id_t id, slice_t value, long *clen, int *chunked) {
+  long n;
+
+  if (id == HDR_CONTENT_LENGTH) {
+    if ((n = parse_length(value)) < 0 || (*clen >= 0 && n != *clen))
+      return -1;
+    *clen = n;
+  }
+  else if (id == HDR_TRANSFER_ENCODING && has_token(value.p, value.len, "chunked"))
+    *chunked = 1;
+  return 0;
+}
+
+/*
+ * private_header - 응답에 이 헤더가 있으면 공유 캐시에 넣으면 안 되는지
+ *   Set-Cookie는 받는 사용자 것, Vary는 캐시 키에 없는 요청 헤더에 따라 응답이 달라짐,
+ *   Cache-Control no-cache는 매번 원서버에 확인하라는 것인데 이 캐시는 확인하지 않음
+ */
+static int private_header(header_id_t id, slice_t value) {
+  switch (id) {
+  case HDR_SET_COOKIE:
+    return 1;
+  case HDR_VARY:
+    return value.len > 0;
+  case HDR_CACHE_CONTROL:
+    return has_token(value.p, value.len, "no-store") || has_token(value.p, value.len, "private") ||
+           has_token(value.p, value.len, "no-cache");
+  default:
+    return 0;
+  }
+}
+
+/*
+ * build_head - 응답 헤더를 클라이언트 연결과 본문 전송 방식에 맞게 고쳐서 out에 쓰기
+ *   hop-by-hop 헤더(Connection, Proxy-Connection, Keep-Alive)와 본문 길이 헤더
+ *   (Content-Length, Transfer-Encoding)는 빼고, 이 연결의 Connection 헤더와
+ *   실제로 보낼 방식의 길이 헤더를 붙인다.
+ *   clen >= 0: Content-Length로, chunked: chunked로, 둘 다 아니면 연결을 닫아서 끝을 알림
+ *   head: 빈 줄까지 포함한 응답 헤더, len: 그 길이, out: MAXBUF + MAXLINE 이상
+ *   반환: 고친 헤더 길이, 헤더가 너무 길면 -1
+ */
+static int build_head(char *out, char *head, size_t len, int keepalive, long clen, int chunked) {
+  char *p, *eol, *end = head + len;
+  size_t n = 0;
+
+  for (p = head; p < end; p = eol) {
+    if ((eol = memchr(p, '\n', end - p)) == NULL)
+      eol = end;
+    else
+      eol++;
+    if (eol - p <= 2 && p[0] == '\r') // 빈 줄 = 헤더 끝
+      break;
+    switch (header_line_id(p, eol - p)) {
+    case HDR_CONNECTION:
+    case HDR_PROXY_CONNECTION:
+    case HDR_KEEP_ALIVE:
+    case HDR_CONTENT_LENGTH:
+    case HDR_TRANSFER_ENCODING:
+      continue;
+    default:
+      break;
+    }
+    if (n + (eol - p) > MAXBUF)
+      return -1;
+    memcpy(out + n, p, eol - p);
+    n += eol - p;
+  }
+  if (clen >= 0)
+    n += sprintf(out + n, "Content-Length: %ld\r\n", clen);
+  else if (chunked)
+    n += sprintf(out + n, "Transfer-Encoding: chunked\r\n");
+  n += sprintf(out + n, keepalive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+  return n;
+}
+
+/*
+ * send_head - build_head로 고친 응답 헤더를 fd로 보내기
+ */
+static int send_head(int fd, char *head, size_t len, int keepalive, long clen, int chunked) {
+  char out[MAXBUF + MAXLINE]; // 고친 헤더 (head는 MAXBUF 이하)
+  int n;
+
+  if ((n = build_head(out, head, len, keepalive, clen, chunked)) < 0)
+    return -1;
+  return rio_writen(fd, out, n) < 0 ? -1 : 0;
+}
+
+/*
+ * head_len - obj[0..size)에서 빈 줄까지의 응답 헤더 길이 (빈 줄이 없으면 0)
+ */
+static size_t head_len(char *obj, size_t size) {
+  char *p = obj, *end = obj + size;
+
+  while ((p = memchr(p, '\r', end - p)) != NULL && end - p >= 4) {
+    if (!memcmp(p, "\r\n\r\n", 4))
+      return p + 4 - obj;
+    p++;
+  }
+  return 0;
+}
+
+/*
+ * keep - 캐시할 수 있는 크기까지 본문을 obj에 모으기 (size는 넘쳐도 계속 셈)
+ */
+static void keep(char *obj, size_t *size, char *p, size_t n) {
+  if (obj && *size + n <= MAX_OBJECT_SIZE)
+    memcpy(obj + *size, p, n);
+  *size += n;
+}
+
+/* 본문을 원서버에서 받아 클라이언트로 보내는 방식 */
+enum {
+  BODY_LENGTH,  // Content-Length만큼 그대로
+  BODY_CHUNKED, // chunked 그대로 (디코더로 끝만 찾음)
+  BODY_DECHUNK, // chunked를 풀어서 보내고 연결을 닫아 끝을 알림 (HTTP/1.0 클라이언트)
+  BODY_EOF,     // 원서버가 닫을 때까지 그대로, 클라이언트도 닫음 (HTTP/1.0 클라이언트)
+  BODY_RECHUNK  // 원서버가 닫을 때까지 받아서 chunked로 싸서 보냄 (HTTP/1.1 클라이언트)
+};
+
+#define RELAY_IOV 16 // BODY_DECHUNK에서 writev 한 번에 모을 데이터 조각 수
+
+/*
+ * relay_body - 응답 본문을 Rio 버퍼에서 복사 없이 바로 클라이언트로 중계
+ *   mode에 따라 그대로 / chunk를 풀어서 / chunk로 싸서 보내고,
+ *   캐시용 obj에는 항상 chunk를 푼 본문을 모은다 (캐시에는 길이를 아는 본문만 있게)
+ *   clen: BODY_LENGTH일 때 본문 길이
+ *   반환: 본문 끝까지 보냈으면 0, 끊기거나 chunk 형식이 틀리면 -1
+ */
+static int relay_body(rio_t *rp, int clientfd, int mode, long clen, char *obj, size_t *size) {
+  static char crlf[] = "\r\n", last_chunk[] = "0\r\n\r\n";
+  struct iovec iov[RELAY_IOV];
+  char hdr[32];
+  chunk_decoder_t d;
+  ssize_t n;
+  size_t used, dlen;
+  char *p, *data;
+  int niov;
+
+  chunk_init(&d);
+  while (mode != BODY_LENGTH || clen > 0) {
+    if ((n = rio_fillb(rp)) <= 0) { // 버퍼가 비었으면 한 번 읽기
+      if (n < 0 || (mode != BODY_EOF && mode != BODY_RECHUNK))
+        return -1; // 에러, 또는 끝나기 전에 원서버가 닫음
+      if (mode == BODY_RECHUNK && rio_writen(clientfd, last_chunk, 5) < 0)
+        return -1;
+      return 0;
+    }
+    p = rp->rio_bufptr;
+    if (mode == BODY_LENGTH && n > clen)
+      n = clen;
+
+    if (mode == BODY_CHUNKED || mode == BODY_DECHUNK) {
+      for (used = 0, niov = 0; used < n && !chunk_done(&d); ) {
+        used += chunk_decode(&d, p + used, n - used, &data, &dlen);
+        if (chunk_error(&d))
+          return -1;
+        if (dlen == 0)
+          continue;
+        keep(obj, size, data, dlen);
+        if (mode == BODY_DECHUNK) { // 풀린 데이터 조각들을 모아서 한 번에
+          iov[niov].iov_base = data;
+          iov[niov].iov_len = dlen;
+          if (++niov == RELAY_IOV) {
+            if (rio_writev(clientfd, iov, niov) < 0)
+              return -1;
+            niov = 0;
+          }
+        }
+      }
+      if (mode == BODY_CHUNKED && rio_writen(clientfd, p, used) < 0)
+        return -1;
+      if (niov > 0 && rio_writev(clientfd, iov, niov) < 0)
+        return -1;
+    }
+    else {
+      used = n;
+      keep(obj, size, p, used);
+      if (mode == BODY_RECHUNK) { // [크기 줄][데이터][CRLF]
+        iov[0].iov_base = hdr;
+        iov[0].iov_len = chunk_header(hdr, used);
+        iov[1].iov_base = p;
+        iov[1].iov_len = used;
+        iov[2].iov_base = crlf;
+        iov[2].iov_len = 2;
+        if (rio_writev(clientfd, iov, 3) < 0)
+          return -1;
+      }
+      else if (rio_writen(clientfd, p, used) < 0)
+        return -1;
+    }
+
+    rp->rio_bufptr += used; // Rio 버퍼에서 쓴 만큼 소비
+    rp->rio_cnt -= used;
+    if (mode == BODY_LENGTH)
+      clen -= used;
+    if (chunk_done(&d))
+      return 0;
+  }
+  return 0;
 }
 
 /*
- * forward_response - 서버 응답을 클라이언트에 그대로 전달
+ * read_head - 응답 헤더를 빈 줄까지 head에 모으면서 상태 코드, 본문 길이 정보와 원서버 keep-alive 확인
+ *   1xx는 본문 없는 중간 응답이라 최종 응답이 뒤따른다 (호출한 쪽이 다시 불러서 읽음)
+ *   Content-Length가 이상하거나 서로 다르면 *clen = -2
+ *   *storable: 헤더로 보면 캐시에 넣어도 되는지 (private_header가 하나도 없으면 1)
+ *   반환: 헤더 길이, 한 바이트도 못 받고 끊겼으면 0, 헤더 중간에 끊겼거나 너무 길면 -1
  */
- void forward_response(int serverfd, int clientfd) {  // 응답 중계 함수
-  char buf[MAXLINE];                  // 데이터 읽기용 버퍼
-  ssize_t n;                          // 읽은 바이트 수
+static ssize_t read_head(rio_t *rp, char *head, int *status, long *clen, int *chunked, int *storable,
+                         int *upstream_keepalive) {
+  char buf[MAXLINE];
+  slice_t value;
+  size_t hlen = 0;
+  ssize_t n;
+  header_id_t id;
+  int bad = 0;
+
+  *status = 0;
+  *clen = -1;
+  *chunked = 0;
+  *storable = 1;
+  while ((n = rio_readlineb(rp, buf, MAXLINE)) > 0) {  // 서버에서 한 줄씩 읽기
+    if (hlen + n > MAXBUF) // 헤더가 너무 김
+      return -1;
+    memcpy(head + hlen, buf, n);
+    if (hlen == 0) { // 상태 줄: HTTP/1.1은 기본이 keep-alive
+      *upstream_keepalive = !strncmp(buf, "HTTP/1.1", 8);
+      // 본문이 없는 응답 (Content-Length 없이도 끝을 앎)
+      if (sscanf(buf, "%*s %d", status) == 1 && (*status == 204 || *status == 304))
+        *clen = 0;
+    }
+    else if ((id = header_line_id(buf, n)) != HDR_UNKNOWN) {
+      value = line_value(buf, n); // 알아본 헤더 줄에는 ':'가 있음
+      if (id == HDR_CONNECTION) {
+        if (has_token(value.p, value.len, "close"))
+          *upstream_keepalive = 0;
+        else if (has_token(value.p, value.len, "keep-alive"))
+          *upstream_keepalive = 1;
+      }
+      else if (parse_framing(id, value, clen, chunked) < 0)
+        bad = 1;
+      if (private_header(id, value))
+        *storable = 0;
+    }
+    hlen += n;
+    if (strcmp(buf, "\r\n") == 0) { // 빈 줄 = 헤더 끝
+      if (bad)
+        *clen = -2;
+      return hlen;
+    }
+  }
+  return hlen == 0 ? 0 : -1;
+}
+
+/*
+ * forward_response - 서버 응답을 클라이언트에 전달
+ *   헤더를 먼저 다 읽어서 본문 끝을 어떻게 알지(Content-Length, chunked, EOF) 정하고,
+ *   클라이언트가 받을 수 있는 방식으로 본문을 보낸다:
+ *     HTTP/1.1 클라이언트: chunked는 그대로, 길이를 모르는 본문은 chunked로 싸서 (keep-alive 유지)
+ *     HTTP/1.0 클라이언트: chunked를 풀어서, 길이를 모르면 연결을 닫아서 끝을 알림
+ *   풀에서 꺼낸 연결이 응답 없이 끊겼으면 (원서버가 놀던 연결을 막 닫음) 새 연결로 한 번 더 보냄
+ *   끝까지 잘 받았고 MAX_OBJECT_SIZE 이하면 chunk를 푼 본문으로 캐시에 저장
+ *   캐시할 수 없는 큰 본문은 splice로 사용자 공간을 거치지 않고 중계
+ */
+int forward_response(request_t *rq) {  // 응답 중계 함수
+  char head[MAXBUF];                  // 응답 헤더 (빈 줄까지)
+  ssize_t hlen;                       // 헤더 길이
   rio_t rio;                          // Rio I/O 구조체
-  
-  Rio_readinitb(&rio, serverfd);      // Rio를 서버 소켓으로 초기화
-  
-  // 서버로부터 읽은 데이터를 클라이언트에 그대로 전달
-  while ((n = Rio_readlineb(&rio, buf, MAXLINE)) > 0) {  // 서버에서 한 줄씩 읽기
-      Rio_writen(clientfd, buf, n);   // 읽은 데이터를 클라이언트에 그대로 쓰기
-  }
-  
+  char *obj = NULL;                   // 캐시에 넣을 응답 (NULL이면 안 모음)
+  size_t size = 0;                    // obj에 모은 바이트 수
+  long clen;                          // Content-Length (-1이면 모름)
+  int chunked;                        // Transfer-Encoding: chunked 인지
+  int status;                         // 응답 상태 코드
+  int storable;                       // 응답 헤더가 캐시를 막지 않는지
+  int upkeep = 0;                     // 원서버가 연결을 유지하는지
+  int mode;                           // 본문 전송 방식 (BODY_*)
+  int done = -1;                      // 본문을 끝까지 보냈으면 0
+  int clientfd = rq->connfd;
+  long sent;
+
+  rq->upstream_keepalive = 0;
+  while (1) {
+    rio_readinitb(&rio, rq->serverfd); // Rio를 서버 소켓으로 초기화
+    if ((hlen = read_head(&rio, head, &status, &clen, &chunked, &storable, &upkeep)) > 0)
+      break;
+    // 원서버가 헤더도 다 못 보냄 (응답 없이 닫음), 본문은 이미 보내서 다시 못 보냄
+    if (!rq->reused || hlen < 0 || !rq->retriable) { // (POST/PATCH는 두 번 처리될 수 있어서 다시 안 보냄)
+      rq->keepalive = 0;
+      return -1;
+    }
+    Close(rq->serverfd); // 재사용한 연결이 아무것도 못 받고 끊김: 새 연결로 다시
+    if (open_server(rq, 0) < 0) {
+      clienterror(clientfd, "502", "Bad Gateway", "Proxy could not connect to the server");
+      rq->keepalive = 0;
+      return -1;
+    }
+  }
+
+  // 1xx 중간 응답 (103 Early Hints 등): HTTP/1.1 클라이언트에는 그대로 넘기고 최종 응답을 읽음
+  // (100 Continue는 Expect를 원서버로 넘기지 않고 프록시가 이미 답했으므로 버림)
+  while (status / 100 == 1) {
+    if (status != 100 && rq->http11 && rio_writen(clientfd, head, hlen) < 0) {
+      rq->keepalive = 0;
+      return -1;
+    }
+    if ((hlen = read_head(&rio, head, &status, &clen, &chunked, &storable, &upkeep)) <= 0) {
+      rq->keepalive = 0;
+      return -1;
+    }
+  }
+  if (clen == -2) { // 본문 끝을 알 수 없음: 이 연결로는 더 못 읽음 (release_server가 닫음)
+    clienterror(clientfd, "502", "Bad Gateway", "Invalid Content-Length from the server");
+    rq->keepalive = 0;
+    return -1;
+  }
+
+  // 본문 전송 방식 정하기
+  if (chunked) {
+    mode = rq->http11 ? BODY_CHUNKED : BODY_DECHUNK;
+    clen = -1; // chunked가 Content-Length보다 우선
+  }
+  else if (clen >= 0)
+    mode = BODY_LENGTH;
+  else {
+    mode = rq->http11 ? BODY_RECHUNK : BODY_EOF;
+    upkeep = 0; // 원서버가 닫아야 끝남
+  }
+  if (mode == BODY_DECHUNK || mode == BODY_EOF) // 연결을 닫아서 끝을 알려야 함
+    rq->keepalive = 0;
+  if (send_head(clientfd, head, hlen, rq->keepalive, clen,
+                mode == BODY_CHUNKED || mode == BODY_RECHUNK) < 0) {
+    rq->keepalive = 0;
+    return -1;
+  }
+  // 캐시에 넣을 수 있는 응답일 때만 모을 버퍼를 잡음: GET의 200 응답이고 헤더가 막지 않을 때,
+  // 길이를 알면 (chunked가 아니면) 넣을 수 있는 크기인지 먼저 보고 딱 그만큼만
+  if (rq->cacheable && storable && status == 200 && (clen < 0 || hlen + clen <= MAX_OBJECT_SIZE)) {
+    obj = Malloc(clen >= 0 ? hlen + clen : MAX_OBJECT_SIZE);
+    memcpy(obj, head, hlen); // 원래 헤더 그대로 저장 (보낼 때 send_head가 다시 고침)
+    size = hlen;
+  }
+
+  // 본문: 캐시에 안 넣는 큰 본문은 splice, 아니면 Rio 버퍼에서 바로
+  if (mode == BODY_LENGTH && clen >= SPLICE_MIN && obj == NULL &&
+      (sent = splice_body(&rio, clientfd, clen)) >= 0) {
+    done = sent == clen ? 0 : -1;
+    size = MAX_OBJECT_SIZE + 1; // 캐시 안 함
+  }
+  else
+    done = relay_body(&rio, clientfd, mode, clen, obj, &size);
+
+  // 끝까지 받은 200 응답만 캐시 (에러 응답이나 중간에 끊긴 응답은 저장 안 함)
+  if (obj && done == 0 && size <= MAX_OBJECT_SIZE &&
+      size > 12 && !strncmp(obj, "HTTP/1.", 7) && !strncmp(obj + 8, " 200", 4))
+    cache_put(rq->key, obj, size);
+  if (obj)
+    Free(obj);
+
+  // 원서버 연결은 응답을 정확히 끝까지 읽었을 때만 재사용 (뒤에 남은 바이트가 있으면 버림)
+  rq->upstream_keepalive = upkeep && done == 0 && rio.rio_cnt == 0;
+  if (done < 0)
+    rq->keepalive = 0;
   printf("Response forwarded to client\n");  // 응답 전달 완료 메시지
-}
\ No newline at end of file
+  return 0;
+}
+
+/*
+ * serve_cached - 캐시에 있는 객체면 원서버 없이 바로 응답
+ */
+int serve_cached(request_t *rq) {
+  size_t size;
+  cobj_t *obj;
+
+  if (!rq->cacheable || (obj = cache_pin(rq->key, &size)) == NULL)
+    return 0; // GET이 아니거나 캐시에 없음
+  printf("Cache hit: %s\n", rq->url);
+  send_cached(rq, obj, size);
+  cache_unpin(obj);
+  return 1;
+}
+
+/*
+ * send_cached - 캐시에서 고정한 응답 보내기
+ *   캐시에는 chunk를 푼 본문이 있으므로 헤더는 build_head가 Content-Length로 고치고,
+ *   본문은 복사하지 않고 캐시 chunk들을 가리켜서 헤더와 같이 writev로 보냄
+ */
+static void send_cached(request_t *rq, cobj_t *obj, size_t size) {
+  char head[MAXBUF + MAXLINE];
+  struct iovec iov[1 + CACHE_MAX_IOV];
+  size_t body;
+  int n;
+
+  if ((n = cached_head(obj, size, rq->keepalive, head, &body)) < 0) {
+    rq->keepalive = 0;
+    return;
+  }
+  iov[0].iov_base = head;
+  iov[0].iov_len = n;
+  n = 1 + cache_iov(obj, body, iov + 1, CACHE_MAX_IOV);
+  if (rio_writev(rq->connfd, iov, n) < 0)
+    rq->keepalive = 0;
+}
+
+/*
+ * cached_head - cache_pin으로 고정한 객체의 헤더를 클라이언트에 보낼 헤더로 고쳐서 out에 쓰기
+ *   (Content-Length와 keepalive에 맞는 Connection), *body는 객체 안에서 본문이 시작하는 위치
+ */
+int cached_head(cobj_t *obj, size_t size, int keepalive, char *out, size_t *body) {
+  char head[MAXBUF];
+  size_t hlen = head_len(head, cache_read(obj, 0, head, sizeof(head)));
+
+  if (hlen == 0)
+    return -1;
+  *body = hlen;
+  return build_head(out, head, hlen, keepalive, size - hlen, 0);
+}
+
+/*
+ * request_cacheable - event/uring용: 파싱한 요청이 캐시에서 찾고 넣을 요청인지
+ *   (http:// 절대 URL의 GET이고 Authorization, Cookie가 없을 때 1, scan_headers와 같은 기준)
+ */
+int request_cacheable(http_parser_t *hp) {
+  int i;
+
+  if (!slice_eq(hp->method, "GET") || !slice_eq(hp->scheme, "http") || hp->host.len == 0)
+    return 0;
+  for (i = 0; i < hp->nheaders; i++)
+    if (hp->headers[i].id == HDR_AUTHORIZATION || hp->headers[i].id == HDR_COOKIE)
+      return 0;
+  return 1;
+}
+
+/*
+ * response_cacheable - 원서버가 보낸 응답 그대로(resp[0..size))를 캐시에 넣어도 되는지
+ *   (200이고, chunked가 아니고, Content-Length가 있으면 본문이 그만큼 다 왔을 때 1)
+ *   Set-Cookie, Vary, Cache-Control no-store/private/no-cache가 있으면 0
+ */
+int response_cacheable(char *resp, size_t size) {
+  size_t hlen = head_len(resp, size);
+  char *p, *eol, *end = resp + hlen;
+  long clen = -1;
+  int chunked = 0;
+  header_id_t id;
+
+  if (hlen == 0 || size < 12 || strncmp(resp, "HTTP/1.", 7) || strncmp(resp + 8, " 200", 4))
+    return 0;
+  for (p = resp; p < end; p = eol) {
+    eol = memchr(p, '\n', end - p) + 1;
+    switch (id = header_line_id(p, eol - p)) {
+    case HDR_CONTENT_LENGTH:
+      if (parse_framing(HDR_CONTENT_LENGTH, line_value(p, eol - p), &clen, &chunked) < 0)
+        return 0; // 길이가 이상하면 어디까지가 응답인지 모름
+      break;
+    case HDR_TRANSFER_ENCODING:
+      chunked = 1; // 캐시에는 chunk를 푼 본문만 넣음
+      break;
+    case HDR_SET_COOKIE:
+    case HDR_VARY:
+    case HDR_CACHE_CONTROL:
+      if (private_header(id, line_value(p, eol - p)))
+        return 0;
+      break;
+    default:
+      break;
+    }
+  }
+  return !chunked && (clen < 0 || clen == size - hlen); // 길이가 없으면 원서버가 닫은 곳이 끝
+}
+
+/*
+ * clienterror - 클라이언트에게 HTTP 에러 응답 전송 (tiny의 clienterror 참고)
+ */
+void clienterror(int fd, char *errnum, char *shortmsg, char *longmsg) {
+  char buf[MAXLINE], body[MAXBUF];
+
+  // 응답 본문 작성
+  sprintf(body, "<html><title>Proxy Error</title>"
+                "<body bgcolor=\"ffffff\">\r\n"
+                "%s: %s\r\n<p>%s\r\n"
+                "<hr><em>The Proxy server</em>\r\n</body></html>\r\n",
+          errnum, shortmsg, longmsg);
+
+  // 응답 헤더 + 본문 전송 (실패해도 어차피 닫을 연결이라 무시)
+  sprintf(buf, "HTTP/1.0 %s %s\r\n"
+               "Content-type: text/html\r\n"
+               "Connection: close\r\n"
+               "Content-length: %d\r\n\r\n", errnum, shortmsg, (int)strlen(body));
+  if (rio_writen(fd, buf, strlen(buf)) < 0)
+    return;
+  rio_writen(fd, body, strlen(body));
+}
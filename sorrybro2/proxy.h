@@ -0,0 +1,454 @@
+/*
+ * proxy.h - 프록시의 여러 소스 파일(proxy.c, event.c ...)이 함께 쓰는 선언들
+ */
+#ifndef __PROXY_H__
+#define __PROXY_H__
+
+#include "csapp.h" // CS:APP 교재의 wrapper 함수들 (Open_listenfd, Accept, Rio 등)
+#include "sbuf.h"  // 연결 큐 (생산자-소비자 유한 버퍼)
+#include "cache.h" // 공유 메모리 객체 캐시
+#include "header.h" // 헤더 이름 -> header_id_t (빌드할 때 만든 완전 해시 표)
+
+/* arena.c - 요청 하나 동안 쓰는 bump 할당기 */
+#define ARENA_BLOCK (64 * 1024) // 처음 블록이 넘치면 Malloc하는 블록 크기 (이보다 크게 달라면 그만큼)
+#define REQUEST_ARENA 4096      // request_t 안에 둔 처음 블록 크기 (보통 요청은 이걸로 끝남)
+
+typedef struct {
+  char *buf;                  // 지금 나눠주고 있는 블록
+  size_t size, used;          // 그 블록의 크기와 쓴 만큼
+  char *first;                // 처음 블록 (호출한 쪽 버퍼, 해제 안 함)
+  size_t first_size;
+  struct arena_block *blocks; // 넘쳐서 Malloc한 블록들
+} arena_t;
+
+void arena_init(arena_t *a, void *buf, size_t size);
+/*
+  buf[0..size)를 처음 블록으로 쓰는 arena 준비 (buf는 arena를 다 쓸 때까지 살아 있어야 함)
+*/
+
+void *arena_alloc(arena_t *a, size_t n);
+/*
+  n바이트 할당 (16바이트 정렬), 따로 해제하지 않고 arena_reset 때 한꺼번에
+*/
+
+void arena_reset(arena_t *a);
+/*
+  지금까지 나눠준 것을 모두 돌려받기 (넘쳐서 만든 블록은 해제, 처음 블록은 다시 씀)
+*/
+
+/* parser.c - HTTP 요청 파서 */
+typedef struct {
+  char *p;    // 받은 버퍼 안의 시작 위치
+  size_t len; // 길이 (NUL로 끝나지 않음)
+} slice_t;
+
+typedef struct {
+  slice_t name;  // 헤더 이름
+  slice_t value; // 값 (앞뒤 공백 뺌)
+  slice_t line;  // 줄 전체 (줄바꿈 포함, 그대로 넘길 때)
+  header_id_t id; // 이름으로 알아본 헤더 (headers.def에 없으면 HDR_UNKNOWN)
+} http_header_t;
+
+#define MAX_HEADERS 256 // 요청 하나의 최대 헤더 수 (넘으면 431, 보통은 헤더 크기가 먼저 한계)
+#define MAX_HOST 256   // 원서버 호스트명 최대 길이 (+1)
+#define MAX_PORT 8     // 원서버 포트 최대 길이 (+1)
+
+typedef struct {
+  int state, ustate;   // 이어서 파싱할 상태 (요청 라인/헤더, URI 안)
+  size_t pos;          // 다음에 볼 바이트 (버퍼 시작 기준)
+  size_t mark, umark;  // 지금 보고 있는 토큰 / URI 조각의 시작
+  char *base;          // 지난번 버퍼 (옮겨졌으면 slice들을 따라 옮김)
+  slice_t method, uri, version;
+  slice_t scheme, host, port, path; // URI 조각 (없는 것은 len 0)
+  http_header_t *headers; // 찾은 헤더들 (arena에 두고 모자라면 두 배로 늘림)
+  int nheaders, maxheaders;
+  arena_t *arena;
+} http_parser_t;
+
+#define HTTP_PARSE_AGAIN 0  // http_parse 결과: 헤더가 아직 덜 옴 (더 받고 다시 호출)
+#define HTTP_PARSE_BAD  -1  // 형식 오류 (400)
+#define HTTP_PARSE_LARGE -2 // 헤더가 MAX_HEADERS개보다 많음 (431)
+
+void http_parser_init(http_parser_t *hp, arena_t *arena);
+/*
+  새 요청을 파싱하기 전에 초기화 (헤더 배열은 arena에서 할당, 요청이 끝날 때까지 유지)
+*/
+
+int http_parse(http_parser_t *hp, char *buf, size_t len);
+/*
+  buf[0..len)에 받아둔 요청 헤더 파싱 (지난번에 멈춘 곳부터 이어서, 복사 없이 slice로)
+  buf는 요청 시작부터 지금까지 받은 바이트 (그 사이에 옮겨져도 됨)
+  반환: 다 파싱했으면 빈 줄까지의 길이, 아니면 HTTP_PARSE_AGAIN/BAD/LARGE
+*/
+
+int slice_eq(slice_t s, char *lit);
+/*
+  slice가 lit과 같은지 (대소문자 무시)
+*/
+
+int slice_copy(char *dst, size_t size, slice_t s);
+/*
+  slice를 NUL로 끝나는 문자열로 복사 (size보다 길면 자르지 않고 -1)
+*/
+
+int hexval(char c);
+/*
+  16진수 글자 값 (아니면 -1) %XX 디코딩과 chunk 크기 줄에서 같이 씀
+*/
+
+char *http_cache_key(http_parser_t *hp);
+/*
+  절대 URL을 정규화한 캐시 키를 hp->arena에 만들어서 반환 (요청이 끝날 때까지 유효)
+  scheme과 host는 소문자로, 기본 포트 :80은 빼고, 빈 path는 "/"로,
+  %XX는 unreserved 글자면 풀고 아니면 16진수를 대문자로 (같은 객체가 한 키로 모이게)
+*/
+
+#define KEEPALIVE_TIMEOUT 5000 // keep-alive 연결에서 다음 요청을 기다리는 최대 시간 (ms)
+
+/* 요청 하나를 처리하는 동안의 상태 (handle_request의 단계들이 주고받음) */
+typedef struct {
+  int connfd;               // 클라이언트 소켓
+  int serverfd;             // 원서버 소켓 (connect_server 이후)
+  rio_t rio;                // 클라이언트 소켓의 Rio 버퍼
+  http_parser_t hp;         // 요청 헤더 파싱 결과 (slice들은 rio 버퍼 안을 가리킴)
+  char *method;             // HTTP 메소드 (rio 버퍼 안, 제자리에서 NUL로 끝냄)
+  char *url;                // 요청 URL (로그용, rio 버퍼 안)
+  char *path;               // 요청 경로 (url의 뒷부분)
+  char host[MAX_HOST];      // 원서버 호스트명 (getaddrinfo에 넘기므로 복사)
+  char port[MAX_PORT];      // 원서버 포트
+  slice_t host_header;      // 클라이언트가 보낸 Host 헤더 값 (없으면 len 0)
+  int http11;               // 클라이언트가 HTTP/1.1인지 (chunked 응답을 받을 수 있음)
+  int keepalive;            // 응답 후 연결을 유지할지 (HTTP 버전, Connection 헤더로 결정)
+  int nreq;                 // 이 연결에서 읽은 요청 수
+  int reused;               // serverfd가 upstream 풀에서 꺼낸 연결인지
+  int upstream_keepalive;   // 응답 후 serverfd를 풀에 돌려줘도 되는지
+  long body_clen;           // 요청 본문의 Content-Length (-1이면 없음)
+  int body_chunked;         // 요청 본문이 chunked인지
+  int expect_continue;      // Expect: 100-continue (본문 전에 100 Continue를 보내야 함)
+  int cacheable;            // 본문 없는 GET, Authorization/Cookie 없음 (캐시에서 찾고 캐시에 저장함)
+  char *key;                // 캐시 키 (http_cache_key, arena 안, cacheable일 때만)
+  int retriable;            // 풀에서 꺼낸 연결이 죽었을 때 새 연결로 다시 보내도 되는지
+  arena_t arena;            // 요청 하나(파이프라인이면 한 묶음) 동안 쓰는 메모리, read_request가 비움
+  char arena_buf[REQUEST_ARENA]; // arena의 처음 블록
+} request_t;
+
+/* 함수 선언 */
+int handle_request(int connfd);
+/*
+  클라이언트 요청을 처리하는 함수 (read_request -> connect_server -> forward_response)
+  keep-alive 연결이면 클라이언트가 닫거나 idle timeout이 날 때까지 반복
+  connfd: 클라이언트와의 연결 소켓 디스크립터
+  반환: CONNECT 터널로 connfd를 넘겼으면 1 (닫으면 안 됨), 아니면 0 (호출한 쪽이 닫음)
+*/
+
+int open_tunnel(request_t *rq);
+/*
+  CONNECT 요청: 원서버에 연결하고 200을 보낸 뒤 양쪽 소켓을 터널 스레드에 넘기는 함수
+  반환: 넘겼으면 1, 실패하면 0 (연결 실패면 502를 이미 보냄)
+*/
+
+#define CONN_CLOSE  0 // serve_connection 결과: 호출한 쪽이 connfd를 닫음
+#define CONN_TUNNEL 1 // serve_connection 결과: CONNECT 터널로 connfd를 넘김 (닫으면 안 됨)
+#define CONN_IDLE   2 // serve_connection 결과: 다음 요청이 아직 안 옴 (rq는 그대로, 나중에 이어서)
+
+int serve_connection(request_t *rq, int wait);
+/*
+  request_init한 rq의 연결에서 요청을 읽어 처리하기를 반복 (handle_request의 본체)
+  wait: 1이면 다음 요청을 KEEPALIVE_TIMEOUT까지 기다림 (Rio 대기 hook이 있으면 yield)
+        0이면 다음 요청이 아직 안 와 있을 때 기다리지 않고 CONN_IDLE로 반환
+        (워커 스레드가 idle 소켓을 붙잡지 않게, 호출한 쪽이 idle_park로 맡김)
+  반환: CONN_CLOSE, CONN_TUNNEL, CONN_IDLE
+*/
+
+void request_init(request_t *rq, int connfd);
+/*
+  새 클라이언트 연결로 rq를 초기화 (Rio 버퍼는 연결이 끝날 때까지 요청 사이에 유지)
+*/
+
+void request_deinit(request_t *rq);
+/*
+  연결이 끝날 때 rq가 쓰던 메모리 해제 (request_init과 짝)
+*/
+
+int request_buffered(rio_t *rp);
+/*
+  Rio 버퍼에 빈 줄까지 다 온 요청이 이미 들어 있으면 1 (파이프라인 감지)
+*/
+
+int serve_pipeline(request_t *rq);
+/*
+  read_request로 읽은 rq와 그 뒤로 버퍼에 와 있는 요청들을 한꺼번에 처리
+  (캐시 적중은 미리 꺼내고 미스는 원서버들에 먼저 다 보낸 뒤, 요청 순서대로 응답)
+  CONNECT가 끼어 있으면 거기서 묶음을 끝내고 앞 요청들에 응답한 뒤 터널을 엶
+  반환: 연결을 계속 쓸 수 있으면 0, 닫아야 하면 -1, CONNECT 터널로 connfd를 넘겼으면 1
+*/
+
+int read_request(request_t *rq);
+/*
+  요청 라인과 헤더를 읽어서 파싱하는 단계
+  rq: request_init으로 초기화해서 넘기면 나머지를 채움 (입출력)
+  시작할 때 rq->arena를 비움 (지난 요청이 쓴 헤더 배열 등을 한꺼번에 해제)
+  헤더는 Rio 버퍼 위에서 http_parse로 파싱하므로 rq의 slice와 method, url, path는
+  본문을 읽거나 다음 요청을 읽기 전까지만 유효함
+  CONNECT면 rq->host, rq->port에 터널 목적지를 채움
+  POST/PUT/PATCH/DELETE의 본문은 읽지 않고 Rio 버퍼에 남겨둠 (connect_server가 흘려보냄)
+  반환: 성공 0, 읽기 실패/idle timeout/지원하지 않는 메소드면 -1 (응답 없이 닫으면 됨),
+        형식 오류(400)나 헤더가 너무 큰 요청(431)도 -1 (에러 응답은 이미 보냄)
+*/
+
+int connect_server(request_t *rq);
+/*
+  원서버에 연결하고 요청을 보내는 단계 (upstream 풀에 놀던 연결이 있으면 재사용)
+  요청 본문이 있으면 클라이언트에서 받는 대로 이어서 보냄 (전체를 모아두지 않음)
+  rq: read_request가 채운 요청 (입력), 성공하면 rq->serverfd (출력)
+  반환: 성공 0, 실패 -1 (연결 실패면 클라이언트에 502를 이미 보냄)
+*/
+
+void release_server(request_t *rq);
+/*
+  응답이 끝난 원서버 연결을 upstream 풀에 돌려주거나 닫는 단계
+*/
+
+int forward_request(request_t *rq);
+/*
+  서버(rq->serverfd)로 요청 전달하는 함수
+  요청 라인, Host, User-Agent, Connection은 새로 쓰고, 나머지 헤더는 받은 버퍼의
+  줄들을 그대로 가리켜서 writev 한 번에 보냄 (이어진 줄들은 iovec 하나로)
+  반환: 성공 0, 전송 실패 -1
+*/
+
+#define PREP_CLOSE -1 // prepare_request 결과: 응답 없이 연결만 닫기 (GET 아님 등)
+#define PREP_BAD   -2 // prepare_request 결과: 400 Bad Request
+
+int prepare_request(http_parser_t *hp, char *out, size_t size, char *host, char *port);
+/*
+  다 파싱한 요청으로 원서버에 보낼 요청을 만드는 함수 (이벤트 루프들이 사용, HTTP/1.0 + close)
+  hp: http_parse가 끝까지 파싱한 클라이언트 요청 (입력)
+  out, size: 원서버로 보낼 요청을 쓸 버퍼와 크기 (출력, 요청을 받은 버퍼와 같아도 됨)
+  host, port: 연결할 원서버 이름과 포트 (출력, MAX_HOST, MAX_PORT 이상 크기)
+  반환: 요청 길이, 실패시 PREP_CLOSE 또는 PREP_BAD
+*/
+
+int resolve_server(char *host, char *port, struct addrinfo **res);
+/*
+  open_clientfd와 같은 조건으로 getaddrinfo 호출 (non-blocking connect용)
+  반환: 성공 0 (*res는 freeaddrinfo로 해제), 실패 -1
+*/
+
+int forward_response(request_t *rq);
+/*
+  서버 응답(rq->serverfd)을 클라이언트(rq->connfd)로 전달하는 함수
+  rq->cacheable이면 응답을 rq->key로 캐시에 저장
+  rq->keepalive: 응답을 끝까지 못 보냈거나 끝을 알릴 수 없으면 0으로 (입출력)
+  rq->upstream_keepalive: 원서버 연결을 재사용할 수 있으면 1 (출력)
+  반환: 응답을 보냈으면 0, 원서버에서 응답을 못 받았으면 -1
+*/
+
+int serve_cached(request_t *rq);
+/*
+  rq->cacheable이고 rq->key가 캐시에 있으면 클라이언트에 바로 보내는 함수
+  반환: 캐시에서 응답했으면 1, 없으면 0 (보내다 실패하면 rq->keepalive를 0으로)
+*/
+
+int cached_head(cobj_t *obj, size_t size, int keepalive, char *out, size_t *body);
+/*
+  cache_pin으로 고정한 객체의 헤더를 클라이언트에 보낼 헤더로 고쳐서 out에 쓰는 함수
+  (Content-Length와 keepalive에 맞는 Connection, out은 MAXBUF + MAXLINE 이상)
+  본문은 복사하지 않고 cache_iov(obj, *body, ...)로 캐시 chunk에서 바로 보내면 됨
+  반환: 헤더 길이, 객체 헤더가 이상하면 -1
+*/
+
+int request_cacheable(http_parser_t *hp);
+/*
+  파싱한 요청을 캐시에서 찾고 응답을 캐시에 넣어도 되는지 (event/uring용)
+  http:// 절대 URL의 GET이고 Authorization, Cookie가 없을 때 1
+*/
+
+int response_cacheable(char *resp, size_t size);
+/*
+  원서버가 보낸 응답 그대로(resp[0..size))를 캐시에 넣어도 되는지
+  200이고, chunked가 아니고, Content-Length가 있으면 본문이 그만큼 다 왔을 때 1
+  Set-Cookie, Vary, Cache-Control no-store/private/no-cache가 있으면 0
+*/
+
+void clienterror(int fd, char *errnum, char *shortmsg, char *longmsg);
+/*
+  클라이언트에게 HTTP 에러 응답을 보내는 함수 (tiny의 clienterror와 같은 역할)
+  fd: 클라이언트와의 연결 소켓 디스크립터
+  errnum: 상태 코드 (예: "503")
+  shortmsg: 상태 메세지 (예: "Service Unavailable")
+  longmsg: 본문에 넣을 설명
+*/
+
+/* event.c - epoll 기반 이벤트 루프 */
+void event_loop(int listenfd);
+/*
+  listenfd에서 연결을 받아 모든 요청을 non-blocking 상태 기계로 처리 (반환하지 않음)
+*/
+
+void event_reactors(char *port, int n);
+/*
+  CPU에 하나씩 고정된 이벤트 루프 n개 실행 (반환하지 않음)
+  port: 루프마다 이 포트로 SO_REUSEPORT 듣기 소켓을 따로 연다
+  n: 루프 개수
+*/
+
+/* uring.c - io_uring 엔진 */
+int uring_loop(int listenfd);
+/*
+  listenfd에서 연결을 받아 accept/connect/recv/send를 io_uring으로 처리 (반환하지 않음)
+  반환: 커널이 io_uring(또는 필요한 기능)을 지원하지 않으면 -1
+*/
+
+/* coro.c - 코루틴 엔진 */
+void coro_loop(int listenfd);
+/*
+  listenfd에서 연결을 받아 연결마다 코루틴에서 handle_request 실행 (반환하지 않음)
+  Rio 함수들이 EAGAIN에서 블록하는 대신 epoll 스케줄러로 yield 한다
+*/
+
+/* pool.c - 워커 스레드 풀 */
+void pool_start(sbuf_t *sp, int n, int min, int max);
+/*
+  워커 n개를 만들고 바로 반환, 큐 깊이에 따라 min~max 사이에서 두 배/반으로 조절
+  sp: 호출한 쪽이 accept한 connfd를 넣는 연결 큐
+*/
+
+/* idle.c - 다음 요청을 기다리는 keep-alive 연결을 맡아두는 poller */
+void idle_start(sbuf_t *sp, void (*wake)(void), void (*drop)(void *item));
+/*
+  idle 스레드를 만들고 바로 반환 (pool, steal 엔진이 시작할 때)
+  sp: 읽을 수 있게 된 connfd를 다시 넣을 연결 큐, wake: 넣은 뒤 부를 함수 (NULL 가능)
+  drop: KEEPALIVE_TIMEOUT 안에 다음 요청이 안 온 연결의 상태를 정리하는 함수 (connfd도 닫음)
+*/
+
+void idle_park(int fd, void *item);
+/*
+  다음 요청을 기다리는 연결 fd와 그 상태 item을 idle 스레드에 맡기기 (기다리지 않고 반환)
+  읽을 수 있게 되면 fd가 연결 큐로 돌아오고 idle_claim(fd)가 item을 돌려줌
+*/
+
+void *idle_claim(int fd);
+/*
+  연결 큐에서 꺼낸 fd가 idle 스레드가 돌려보낸 연결이면 맡겼던 item, 새 연결이면 NULL
+*/
+
+void idle_stats(void);
+/*
+  맡은 연결 수와 깨운/시간이 다 된 수 출력 (SIGUSR1 통계에 붙여서)
+*/
+
+/* prefork.c - 멀티 프로세스 모드 */
+void prefork_run(int listenfd, int n);
+/*
+  listenfd를 물려받은 자식 프로세스 n개를 만들고, 죽은 자식은 다시 만든다 (반환하지 않음)
+*/
+
+/* steal.c - work-stealing 스케줄러 */
+void steal_start(sbuf_t *sp, int n);
+/*
+  Chase-Lev 덱을 하나씩 가진 워커 n개를 만들고 바로 반환
+  sp: 호출한 쪽이 accept한 connfd를 넣는 연결 큐 (워커들이 여러 개씩 꺼내감)
+*/
+
+void steal_wake(void);
+/*
+  연결 큐에 connfd를 넣은 뒤 호출: 쉬고 있는 워커 하나 깨우기
+*/
+
+/* tunnel.c - CONNECT 터널 */
+int tunnel_start(int clientfd, int serverfd);
+/*
+  연결이 끝난 터널을 터널 스레드에 넘기기 (처음 부를 때 스레드를 만듦)
+  두 소켓은 이제 터널 스레드가 splice로 양방향 중계하고 다 끝나면 닫는다
+  반환: 성공 0, pipe를 못 얻으면 -1 (소켓은 호출한 쪽 것 그대로)
+*/
+
+void tunnel_stats(void);
+/*
+  터널 상태 출력 (SIGUSR1 통계에 붙여서)
+*/
+
+/* chunked.c - Transfer-Encoding: chunked 스트리밍 디코더/인코더 */
+typedef struct {
+  int state;  // 어디까지 읽었는지 (chunked.c의 CH_*)
+  long size;  // 지금 chunk에서 남은 데이터 바이트 (크기 줄을 읽는 중이면 지금까지 읽은 값)
+  int digits; // 크기 줄에서 읽은 16진수 자리 수
+} chunk_decoder_t;
+
+void chunk_init(chunk_decoder_t *d);
+/*
+  chunked 본문 하나를 읽을 디코더 초기화
+*/
+
+size_t chunk_decode(chunk_decoder_t *d, char *in, size_t len, char **data, size_t *dlen);
+/*
+  in에서 최대 len 바이트를 소비 (크기 줄, CRLF, trailer는 넘기고)
+  본문 데이터가 나오면 복사하지 않고 그 위치를 *data, *dlen에 알려주고 거기서 멈춤
+  반환: 소비한 바이트 수 (끝이나 오류를 만나면 len보다 작을 수 있음)
+*/
+
+int chunk_done(chunk_decoder_t *d);
+/*
+  마지막 0 chunk와 trailer, 빈 줄까지 다 읽었으면 1
+*/
+
+int chunk_error(chunk_decoder_t *d);
+/*
+  chunked 형식이 틀렸으면 1
+*/
+
+int chunk_header(char *buf, size_t n);
+/*
+  n 바이트짜리 chunk의 크기 줄("<16진수>\r\n")을 buf에 쓰기
+  반환: 크기 줄 길이
+*/
+
+/* upstream.c - 원서버 keep-alive 연결 풀 */
+int upstream_get(char *host, char *port);
+/*
+  host:port로 가는 놀던 연결 하나 꺼내기 (살아있는지 확인한 것)
+  반환: 소켓, 없으면 -1
+*/
+
+void upstream_put(char *host, char *port, int fd);
+/*
+  응답을 끝까지 읽은 원서버 연결을 풀에 돌려주기 (원서버별/전체 한도를 넘으면 닫음)
+*/
+
+void upstream_stats(void);
+/*
+  풀 상태 출력 (SIGUSR1 통계에 붙여서)
+*/
+
+/* splice.c - splice와 pipe 풀 */
+int pipe_get(int fds[2]);
+/*
+  빈 pipe 하나 얻기 (풀에 있으면 재사용)
+  반환: 성공 0, 실패 -1
+*/
+
+void pipe_put(int fds[2], int dirty);
+/*
+  다 쓴 pipe 돌려주기 (dirty: 데이터가 남아있으면 1 -> 재사용하지 않고 닫음)
+*/
+
+ssize_t splice_fd(int infd, int outfd, size_t len);
+/*
+  infd에서 outfd로 최대 len 바이트를 커널 안에서 옮기기 (둘 중 하나는 pipe)
+  반환: 옮긴 바이트 수, EOF면 0, 에러면 -1
+*/
+
+/* affinity.c - CPU 관련 도우미 */
+int pin_to_cpu(int cpu);
+/*
+  호출한 스레드를 cpu번 CPU에서만 돌도록 고정
+  반환: 성공 0, 실패시 에러 번호
+*/
+
+int online_cpus(void);
+/*
+  사용 가능한 CPU 개수 반환 (최소 1)
+*/
+
+#endif /* __PROXY_H__ */
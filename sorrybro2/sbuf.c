@@ -0,0 +1,80 @@
+/*
+ * sbuf.c - CS:APP 교재의 sbuf 패키지 (생산자-소비자 유한 버퍼)
+ *
+ * 교재 코드 그대로에 sbuf_tryinsert, sbuf_tryremove만 추가함
+ * (큐가 가득 찼을 때 기다리지 않고 503으로 거절하는 정책용,
+ *  steal 스케줄러 워커가 한 번에 여러 개씩 가져가는 용도)
+ */
+#include "sbuf.h"
+
+/* Create an empty, bounded, shared FIFO buffer with n slots */
+void sbuf_init(sbuf_t *sp, int n)
+{
+  sp->buf = Calloc(n, sizeof(int));
+  sp->n = n;                  // 최대 n개 아이템
+  sp->front = sp->rear = 0;   // front == rear 이면 빈 버퍼
+  Sem_init(&sp->mutex, 0, 1); // 잠금용 이진 세마포어
+  Sem_init(&sp->slots, 0, n); // 처음엔 n개의 빈 슬롯
+  Sem_init(&sp->items, 0, 0); // 처음엔 아이템 0개
+}
+
+/* Clean up buffer sp */
+void sbuf_deinit(sbuf_t *sp)
+{
+  Free(sp->buf);
+}
+
+/* Insert item onto the rear of shared buffer sp */
+void sbuf_insert(sbuf_t *sp, int item)
+{
+  P(&sp->slots);                          // 빈 슬롯 기다리기
+  P(&sp->mutex);                          // 버퍼 잠금
+  sp->buf[(++sp->rear) % (sp->n)] = item; // 아이템 삽입
+  V(&sp->mutex);                          // 버퍼 잠금 해제
+  V(&sp->items);                          // 아이템이 생겼다고 알림
+}
+
+/* Insert item only if a slot is free; returns 0 when the buffer is full */
+int sbuf_tryinsert(sbuf_t *sp, int item)
+{
+  while (sem_trywait(&sp->slots) < 0) { // 빈 슬롯이 없으면 기다리지 않고
+    if (errno == EAGAIN)
+      return 0;                         // 가득 찼다고 반환
+    if (errno != EINTR)
+      unix_error("sbuf_tryinsert error");
+  }
+  P(&sp->mutex);
+  sp->buf[(++sp->rear) % (sp->n)] = item;
+  V(&sp->mutex);
+  V(&sp->items);
+  return 1;
+}
+
+/* Remove and return the first item from buffer sp */
+int sbuf_remove(sbuf_t *sp)
+{
+  int item;
+  P(&sp->items);                           // 아이템 기다리기
+  P(&sp->mutex);                           // 버퍼 잠금
+  item = sp->buf[(++sp->front) % (sp->n)]; // 아이템 꺼내기
+  V(&sp->mutex);                           // 버퍼 잠금 해제
+  V(&sp->slots);                           // 빈 슬롯이 생겼다고 알림
+  return item;
+}
+
+/* Remove up to max items without waiting; returns how many were removed */
+int sbuf_tryremove(sbuf_t *sp, int *items, int max)
+{
+  int i, n = 0;
+  while (n < max && sem_trywait(&sp->items) == 0) // 있는 만큼만 예약
+    n++;
+  if (n == 0)
+    return 0;
+  P(&sp->mutex);
+  for (i = 0; i < n; i++)
+    items[i] = sp->buf[(++sp->front) % (sp->n)];
+  V(&sp->mutex);
+  for (i = 0; i < n; i++)
+    V(&sp->slots);
+  return n;
+}
@@ -0,0 +1,54 @@
+/*
+ * sbuf.h - CS:APP 교재의 sbuf 패키지 (생산자-소비자 유한 버퍼)
+ *
+ * 메인 스레드(생산자)가 accept한 connfd를 넣고,
+ * 워커 스레드(소비자)들이 꺼내서 처리한다.
+ */
+#ifndef __SBUF_H__
+#define __SBUF_H__
+
+#include "csapp.h"
+
+typedef struct {
+  int *buf;    // 버퍼 배열 (connfd 저장)
+  int n;       // 최대 슬롯 개수
+  int front;   // buf[(front+1)%n]이 첫 번째 아이템
+  int rear;    // buf[rear%n]이 마지막 아이템
+  sem_t mutex; // buf 접근 보호
+  sem_t slots; // 빈 슬롯 개수
+  sem_t items; // 채워진 아이템 개수
+} sbuf_t;
+
+void sbuf_init(sbuf_t *sp, int n);
+/*
+  n개의 슬롯을 가진 빈 버퍼 생성
+*/
+
+void sbuf_deinit(sbuf_t *sp);
+/*
+  버퍼 해제
+*/
+
+void sbuf_insert(sbuf_t *sp, int item);
+/*
+  버퍼 뒤에 item 삽입 (빈 슬롯이 없으면 생길 때까지 대기)
+*/
+
+int sbuf_tryinsert(sbuf_t *sp, int item);
+/*
+  빈 슬롯이 있을 때만 item 삽입, 대기하지 않음
+  반환: 삽입했으면 1, 버퍼가 가득 찼으면 0
+*/
+
+int sbuf_remove(sbuf_t *sp);
+/*
+  버퍼 앞의 아이템을 꺼내서 반환 (아이템이 없으면 생길 때까지 대기)
+*/
+
+int sbuf_tryremove(sbuf_t *sp, int *items, int max);
+/*
+  버퍼 앞에서 최대 max개를 한 번의 잠금으로 꺼내기, 대기하지 않음
+  반환: 꺼낸 개수 (비었으면 0)
+*/
+
+#endif /* __SBUF_H__ */
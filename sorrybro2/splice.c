@@ -0,0 +1,69 @@
+/*
+ * splice.c - splice()와 재사용 pipe 풀
+ *
+ * splice, F_SETPIPE_SZ는 _GNU_SOURCE가 필요해서 affinity.c처럼
+ * csapp.h를 include하지 않는 파일로 따로 분리함.
+ * (중계 루프 자체는 proxy.c의 splice_body)
+ *
+ * 소켓 -> pipe -> 소켓으로 옮기면 데이터가 사용자 공간을 거치지 않고 커널 안에서
+ * 페이지 참조만 넘어간다. pipe는 연결마다 만들고 닫으면 syscall이 3번 더 들고
+ * 비싸므로, 다 비운 pipe는 풀에 돌려놨다가 다음 응답에 재사용한다.
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define PIPE_POOL 64           // 풀에 남겨둘 최대 pipe 수
+#define PIPE_SIZE (256 * 1024) // pipe 버퍼 크기 (클수록 splice 한 번에 많이 옮김)
+
+static int pool[PIPE_POOL][2]; // 비어있는 pipe들
+static int npool;              // pool에 든 pipe 수
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * pipe_get - 빈 pipe 하나 얻기 (풀에 있으면 재사용) 성공 0, 실패 -1
+ */
+int pipe_get(int fds[2]) {
+  pthread_mutex_lock(&pool_mutex);
+  if (npool > 0) {
+    npool--;
+    fds[0] = pool[npool][0];
+    fds[1] = pool[npool][1];
+    pthread_mutex_unlock(&pool_mutex);
+    return 0;
+  }
+  pthread_mutex_unlock(&pool_mutex);
+
+  if (pipe(fds) < 0)
+    return -1;
+  fcntl(fds[1], F_SETPIPE_SZ, PIPE_SIZE); // 실패하면 기본 크기(64KB)로 그냥 씀
+  return 0;
+}
+
+/*
+ * pipe_put - 다 쓴 pipe 돌려주기 (데이터가 남아있거나 풀이 가득 차면 닫음)
+ */
+void pipe_put(int fds[2], int dirty) {
+  if (!dirty) {
+    pthread_mutex_lock(&pool_mutex);
+    if (npool < PIPE_POOL) {
+      pool[npool][0] = fds[0];
+      pool[npool][1] = fds[1];
+      npool++;
+      pthread_mutex_unlock(&pool_mutex);
+      return;
+    }
+    pthread_mutex_unlock(&pool_mutex);
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
+
+/*
+ * splice_fd - infd에서 outfd로 최대 len 바이트 옮기기 (둘 중 하나는 pipe)
+ *   반환: read/write처럼 옮긴 바이트 수, EOF면 0, 에러면 -1 (errno 설정)
+ */
+ssize_t splice_fd(int infd, int outfd, size_t len) {
+  return splice(infd, NULL, outfd, NULL, len, SPLICE_F_MOVE | SPLICE_F_MORE);
+}
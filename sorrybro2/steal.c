@@ -0,0 +1,362 @@
+/*
+ * steal.c - work-stealing 스케줄러 (-m steal)
+ *
+ * 워커 풀(-m pool)은 연결 하나를 워커 하나가 처음부터 끝까지 들고 있고,
+ * 모든 워커가 연결 큐(sbuf) 하나의 mutex를 놓고 경쟁한다.
+ * 여기서는 요청 처리를 작업(task) 단계로 나눠서
+ *
+ *   T_READ    요청 라인/헤더 읽고 파싱 (read_request), 캐시에 있으면 여기서 응답
+ *   T_CONNECT 원서버 주소 찾기 + 연결 + 요청 전달 (connect_server)
+ *   T_RELAY   응답 중계 (forward_response)
+ *
+ * keep-alive 연결은 응답이 끝나면 다시 T_READ로 돌아간다. 다음 요청이 아직
+ * 안 와 있으면 작업을 덱에 넣지 않고 idle.c의 poller에 맡기고, 요청이 오면
+ * poller가 connfd를 연결 큐에 다시 넣어서 grab이 맡겼던 작업을 이어받는다.
+ *
+ * 한 단계가 끝나면 다음 단계를 자기 Chase-Lev 덱에 push한다.
+ * 워커는 자기 덱 bottom에서 가장 최근 작업을 꺼내므로(LIFO) 보통은 방금
+ * 끝낸 연결의 다음 단계를 바로 이어서 하고(캐시에 버퍼가 남아있음),
+ * 덱에 남은 오래된 작업은 할 일이 없는 다른 워커가 top에서 훔쳐간다.
+ *
+ * 공용 연결 큐(sbuf)는 새 연결이 들어오는 입구로만 쓰고, 워커는 자기 덱이
+ * 비었을 때만 한 번의 잠금으로 최대 GRAB_BATCH개씩 가져간다.
+ * 큰 응답(burning_godzilla.mp4 등)을 중계하느라 블록된 워커의 덱에 쌓인
+ * 연결은 노는 워커가 훔쳐가므로, 몇몇 워커에 큰 전송이 몰려도 나머지
+ * 코어가 놀지 않는다. SIGUSR1을 보내면 워커별 카운터를 출력한다.
+ */
+#include "proxy.h"
+#include "deque.h"
+
+#define DEQUE_SIZE 64 // 워커 덱의 처음 슬롯 개수
+#define GRAB_BATCH 4  // 연결 큐에서 한 번에 가져올 최대 연결 수
+#define IDLE_MS 10    // 쉬는 워커가 깨우는 신호 없이도 다시 둘러보는 주기
+#define TICK_MS 100   // 감시 스레드가 통계 출력 요청을 확인하는 주기
+
+/* 작업 단계 */
+typedef enum {
+  T_READ,    // 요청 읽고 파싱
+  T_CONNECT, // 원서버 연결 + 요청 전달
+  T_RELAY    // 응답 중계
+} task_stage_t;
+
+/* 작업 하나 = 연결 하나의 다음 단계 */
+typedef struct {
+  task_stage_t stage; // 다음에 할 단계
+  request_t rq;       // 단계들이 주고받는 요청 상태
+} task_t;
+
+/* 워커 하나 (카운터는 그 워커만 쓰고, 통계 출력 때만 다른 스레드가 읽음) */
+typedef struct {
+  int id;               // 워커 번호
+  deque_t dq;           // 이 워커의 작업 덱
+  unsigned int seed;    // 훔칠 상대를 고르는 난수 상태
+  unsigned long tasks;  // 실행한 작업 수
+  unsigned long grabs;  // 연결 큐에서 가져온 연결 수
+  unsigned long steals; // 다른 워커에게서 훔친 작업 수
+} __attribute__((aligned(64))) worker_t; // 워커끼리 같은 캐시 라인을 쓰지 않도록
+
+/* 카운터 증감: 쓰는 스레드는 하나뿐이라 lock 없는 relaxed store로 충분 */
+#define STAT_ADD(x, d) __atomic_store_n(&(x), (x) + (d), __ATOMIC_RELAXED)
+
+static worker_t *workers; // 모든 워커
+static int nworkers;      // 워커 개수
+static sbuf_t *inject;    // 새 연결이 들어오는 공용 연결 큐
+static int nidle;         // 쉬고 있는 워커 수
+static pthread_mutex_t idle_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idle_cond = PTHREAD_COND_INITIALIZER;
+static volatile sig_atomic_t stats_requested; // SIGUSR1을 받으면 1
+
+/*
+ * wake_one - 쉬고 있는 워커가 있으면 하나 깨우기
+ *   (작업을 내놓은 뒤 nidle을 읽고, 쉬는 쪽은 nidle을 올린 뒤 작업을 확인하므로
+ *    둘 중 하나는 반드시 상대를 본다)
+ */
+static void wake_one(void) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&nidle, __ATOMIC_RELAXED) > 0) {
+    pthread_mutex_lock(&idle_mutex);
+    pthread_cond_signal(&idle_cond);
+    pthread_mutex_unlock(&idle_mutex);
+  }
+}
+
+/*
+ * work_visible - 연결 큐나 어느 덱에든 가져갈 작업이 보이는지
+ */
+static int work_visible(void) {
+  int i, items;
+
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (sem_getvalue(&inject->items, &items) == 0 && items > 0)
+    return 1;
+  for (i = 0; i < nworkers; i++)
+    if (deque_size(&workers[i].dq) > 0)
+      return 1;
+  return 0;
+}
+
+/*
+ * spawn - 작업을 자기 덱에 넣기, 훔쳐갈 만큼 쌓였으면 쉬는 워커를 깨움
+ *   (하나뿐이면 어차피 곧 자기가 꺼내므로 깨우지 않음)
+ */
+static void spawn(worker_t *w, task_t *t) {
+  deque_push(&w->dq, t);
+  if (deque_size(&w->dq) > 1)
+    wake_one();
+}
+
+/*
+ * grab - 연결 큐에서 최대 GRAB_BATCH개를 가져와 작업으로 만들고 하나 꺼내기
+ */
+static task_t *grab(worker_t *w) {
+  int fds[GRAB_BATCH];
+  int i, n;
+  task_t *t;
+
+  if ((n = sbuf_tryremove(inject, fds, GRAB_BATCH)) == 0)
+    return NULL;
+  STAT_ADD(w->grabs, n);
+  for (i = n - 1; i >= 0; i--) { // 거꾸로 넣어서 가장 먼저 온 연결을 자기가 꺼냄
+    if ((t = idle_claim(fds[i])) == NULL) { // 새 연결 (poller에서 돌아왔으면 맡겼던 T_READ 작업)
+      t = Malloc(sizeof(task_t));
+      t->stage = T_READ;
+      request_init(&t->rq, fds[i]);
+    }
+    deque_push(&w->dq, t);
+  }
+  if (n > 1) // 나머지는 다른 워커가 훔쳐가도록
+    wake_one();
+  return deque_take(&w->dq);
+}
+
+/*
+ * steal - 다른 워커의 덱에서 가장 오래된 작업 훔치기
+ *   난수로 고른 워커부터 한 바퀴 돌고, 경쟁에서 진 덱이 있었으면 한 바퀴 더
+ */
+static task_t *steal(worker_t *w) {
+  int i, start, round, lost;
+  void *item;
+  worker_t *v;
+
+  for (round = 0; round < 2; round++) {
+    lost = 0;
+    start = rand_r(&w->seed) % nworkers;
+    for (i = 0; i < nworkers; i++) {
+      v = &workers[(start + i) % nworkers];
+      if (v == w)
+        continue;
+      switch (deque_steal(&v->dq, &item)) {
+      case 1:
+        STAT_ADD(w->steals, 1);
+        return item;
+      case -1:
+        lost = 1;
+        break;
+      }
+    }
+    if (!lost)
+      break;
+  }
+  return NULL;
+}
+
+/*
+ * print_stats - 워커별 카운터 출력 (작업이 워커들에 얼마나 고르게 퍼졌는지)
+ */
+static void print_stats(void) {
+  int i;
+
+  printf("worker    tasks    grabs   steals  queued\n");
+  for (i = 0; i < nworkers; i++)
+    printf("%6d %8lu %8lu %8lu %7ld\n", workers[i].id,
+           __atomic_load_n(&workers[i].tasks, __ATOMIC_RELAXED),
+           __atomic_load_n(&workers[i].grabs, __ATOMIC_RELAXED),
+           __atomic_load_n(&workers[i].steals, __ATOMIC_RELAXED),
+           deque_size(&workers[i].dq));
+  idle_stats();
+  upstream_stats();
+  tunnel_stats();
+  cache_stats();
+  fflush(stdout);
+}
+
+/*
+ * sigusr1_handler - 통계 출력 요청 표시만 하고, 출력은 감시 스레드가
+ */
+static void sigusr1_handler(int sig) {
+  stats_requested = 1;
+}
+
+/*
+ * monitor - 감시 스레드: TICK_MS마다 통계 출력 요청을 확인
+ *   (워커가 모두 큰 전송에 묶여 있어도 SIGUSR1에 바로 답하도록 워커와 따로 둠)
+ */
+static void *monitor(void *vargp) {
+  Pthread_detach(pthread_self());
+  while (1) {
+    usleep(TICK_MS * 1000);
+    if (stats_requested) {
+      stats_requested = 0;
+      print_stats();
+    }
+  }
+  return NULL;
+}
+
+/*
+ * idle_wait - 할 일이 없을 때 깨워줄 때까지(최대 IDLE_MS) 쉬기
+ */
+static void idle_wait(void) {
+  struct timespec ts;
+
+  pthread_mutex_lock(&idle_mutex);
+  __atomic_add_fetch(&nidle, 1, __ATOMIC_SEQ_CST);
+  if (!work_visible()) {
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += IDLE_MS * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&idle_cond, &idle_mutex, &ts);
+  }
+  __atomic_sub_fetch(&nidle, 1, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&idle_mutex);
+}
+
+/*
+ * drop_task - 다음 요청 없이 시간이 다 된 연결의 작업 정리 (idle 스레드가 호출)
+ */
+static void drop_task(void *item) {
+  task_t *t = item;
+
+  Close(t->rq.connfd);
+  request_deinit(&t->rq);
+  Free(t);
+}
+
+/*
+ * next_request - keep-alive: 다음 요청이 와 있으면 T_READ를 덱에 넣고, 아니면 poller에 맡기기
+ *   (워커가 놀고 있는 소켓을 기다리며 블록하지 않도록)
+ */
+static void next_request(worker_t *w, task_t *t) {
+  t->stage = T_READ;
+  if (rio_readable(&t->rq.rio, 0) == 0)
+    idle_park(t->rq.connfd, t);
+  else
+    spawn(w, t);
+}
+
+/*
+ * run_task - 작업의 현재 단계를 실행하고, 다음 단계가 있으면 덱에 넣기
+ */
+static void run_task(worker_t *w, task_t *t) {
+  int rc;
+
+  STAT_ADD(w->tasks, 1);
+  switch (t->stage) {
+  case T_READ:
+    if (rio_readable(&t->rq.rio, 0) == 0) { // 새 연결인데 요청이 아직 안 옴
+      idle_park(t->rq.connfd, t);
+      return;
+    }
+    if (read_request(&t->rq) < 0)
+      break;
+    if (!strcasecmp(t->rq.method, "CONNECT")) { // 터널은 터널 스레드로
+      if (!open_tunnel(&t->rq))
+        break;
+      request_deinit(&t->rq);
+      Free(t);
+      return;
+    }
+    if (t->rq.keepalive && request_buffered(&t->rq.rio)) { // 파이프라인은 한꺼번에
+      if ((rc = serve_pipeline(&t->rq)) < 0)
+        break;
+      if (rc > 0) { // 묶음 끝의 CONNECT를 터널로 넘김
+        request_deinit(&t->rq);
+        Free(t);
+        return;
+      }
+      next_request(w, t);
+      return;
+    }
+    if (serve_cached(&t->rq)) {
+      if (!t->rq.keepalive)
+        break;
+      next_request(w, t); // 같은 연결의 다음 요청
+      return;
+    }
+    t->stage = T_CONNECT;
+    spawn(w, t);
+    return;
+  case T_CONNECT:
+    if (connect_server(&t->rq) < 0)
+      break;
+    t->stage = T_RELAY;
+    spawn(w, t);
+    return;
+  case T_RELAY:
+    forward_response(&t->rq);
+    release_server(&t->rq);
+    if (!t->rq.keepalive)
+      break;
+    next_request(w, t); // keep-alive: 같은 연결의 다음 요청
+    return;
+  }
+  Close(t->rq.connfd); // 마지막 단계이거나 중간에 실패
+  request_deinit(&t->rq);
+  Free(t);
+}
+
+/*
+ * steal_worker - 워커 스레드: 자기 덱 -> 연결 큐 -> 훔치기 순서로 작업을 찾아 실행
+ */
+static void *steal_worker(void *vargp) {
+  worker_t *w = vargp;
+  task_t *t;
+
+  Pthread_detach(pthread_self());
+  while (1) {
+    if ((t = deque_take(&w->dq)) == NULL &&
+        (t = grab(w)) == NULL &&
+        (t = steal(w)) == NULL) {
+      idle_wait();
+      continue;
+    }
+    run_task(w, t);
+  }
+  return NULL;
+}
+
+/*
+ * steal_start - 워커 n개를 만들고 반환 (연결은 호출한 쪽이 inject 큐에 넣음)
+ */
+void steal_start(sbuf_t *sp, int n) {
+  pthread_t tid;
+  void *p;
+  int i, rc;
+
+  if ((rc = posix_memalign(&p, 64, n * sizeof(worker_t))) != 0)
+    posix_error(rc, "posix_memalign error");
+  workers = p;
+  nworkers = n;
+  inject = sp;
+  for (i = 0; i < n; i++) { // 스레드를 만들기 전에 모든 덱을 준비 (서로 훔쳐보므로)
+    memset(&workers[i], 0, sizeof(worker_t));
+    workers[i].id = i;
+    workers[i].seed = i + 1;
+    deque_init(&workers[i].dq, DEQUE_SIZE);
+  }
+  idle_start(sp, wake_one, drop_task);
+  for (i = 0; i < n; i++)
+    Pthread_create(&tid, NULL, steal_worker, &workers[i]);
+  Signal(SIGUSR1, sigusr1_handler);
+  Pthread_create(&tid, NULL, monitor, NULL);
+}
+
+/*
+ * steal_wake - 연결 큐에 연결을 넣은 뒤 쉬고 있는 워커 하나 깨우기
+ */
+void steal_wake(void) {
+  wake_one();
+}
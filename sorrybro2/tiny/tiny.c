@@ -13,6 +13,7 @@
  *
  */
 #include "csapp.h"
+#include "../header.h" // 헤더 이름 -> header_id_t (프록시와 같은 완전 해시 표)
 
 void doit(int fd);
 void read_requesthdrs(rio_t *rp);
@@ -173,6 +174,7 @@ void clienterror(int fd, char *cause, char *errnum, char *shortmsg, char *longms
 // 요청 헤더만 읽음
 void read_requesthdrs(rio_t *rp){
   char buf[MAXLINE];
+  header_id_t id;
 
   //소켓에서 헤드 줄을 한줄씩 읽어 buf에 담음
   Rio_readlineb(rp, buf, MAXLINE);
@@ -180,6 +182,9 @@ void read_requesthdrs(rio_t *rp){
   // "\r\n" <- 빈줄을 만날 때까지 계속 읽
   while(strcmp(buf, "\r\n")) {
     Rio_readlineb(rp, buf, MAXLINE);
+    // 알아본 헤더는 표준 이름을 붙여서 찍음 (해시 한 번으로 분류)
+    if ((id = header_line_id(buf, strlen(buf))) != HDR_UNKNOWN)
+      printf("[%s] ", header_names[id]);
     printf("%s", buf);
   }
   // 서버 로그에만 찍음 -> 요청 헤더를 읽고 무시
@@ -0,0 +1,291 @@
+/*
+ * tunnel.c - CONNECT 터널 (HTTPS 등)
+ *
+ * CONNECT 요청을 받아 원서버에 연결하고 "200 Connection established"를 보낸 뒤에는
+ * 양쪽 소켓을 이 파일의 epoll 스레드 하나에 넘긴다. TLS 세션은 몇 분씩 열려
+ * 있을 수 있는데, 그동안 워커 스레드나 코루틴을 붙잡지 않으려는 것.
+ * (스레드는 프로세스마다 처음 터널이 생길 때 하나 만든다)
+ * 넘겨받을 터널은 mutex로 보호되는 목록에 넣고 eventfd로 깨워서, 등록부터
+ * 정리까지 터널 상태는 터널 스레드만 만진다.
+ *
+ * 방향마다 pipe 하나를 두고 소켓 -> pipe -> 소켓을 splice로 옮기므로 데이터는
+ * 사용자 공간을 거치지 않는다. 두 방향은 서로 독립이라 한쪽이 막혀도 다른 쪽은 흐른다.
+ *
+ *   - 한쪽이 EOF를 보내면 pipe를 다 비운 뒤 반대쪽에 shutdown(SHUT_WR)으로 전달
+ *     (half-close), 두 방향이 다 닫히면 터널을 정리한다.
+ *   - 어느 방향으로도 TUNNEL_IDLE_MS 동안 아무것도 안 흐르면 닫는다. 터널들은
+ *     마지막으로 데이터가 흐른 순서대로 목록에 있어서 맨 앞만 보면 된다.
+ */
+#include "proxy.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+
+#define TUNNEL_IDLE_MS (5 * 60 * 1000) // 이만큼 아무것도 안 흐르면 닫음
+#define TUNNEL_CHUNK (256 * 1024)      // splice 한 번에 옮길 최대 바이트
+#define MAXEVENTS 256
+
+struct tunnel;
+
+/* 터널의 한쪽 끝 (epoll에는 이 구조체 주소를 등록) */
+typedef struct {
+  int fd;
+  struct tunnel *t;
+} tend_t;
+
+/* 한 방향의 중계 상태 */
+typedef struct {
+  int pipe[2];  // 중간 pipe
+  size_t inpipe; // pipe에 들어있는 바이트 수
+  int eof;      // 읽는 쪽이 EOF를 보냄
+  int shut;     // 쓰는 쪽에 shutdown(SHUT_WR)까지 전달함
+} tdir_t;
+
+typedef struct tunnel {
+  tend_t client, server;
+  tdir_t up, down;   // up: 클라이언트 -> 원서버, down: 원서버 -> 클라이언트
+  long last;         // 마지막으로 데이터가 흐른 시각 (ms)
+  int linked;        // idle 목록에 들어 있는지
+  struct tunnel *prev, *next; // idle 목록 (last 순), 넘겨받기 전에는 pending 링크
+} tunnel_t;
+
+static int epfd = -1;
+static int wakefd;                      // 새 터널이 왔다고 터널 스레드 깨우기 (eventfd)
+static tend_t wake_end;                 // epoll에 wakefd를 등록할 때 쓰는 표시
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static tunnel_t *pending;               // 넘겨받을 터널들 (pending_mutex)
+static pthread_mutex_t pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+static tunnel_t *idle_head, *idle_tail; // 터널 스레드만 만짐
+static unsigned long opened, closed, timeouts; // 통계
+
+/*
+ * now_ms - 단조 시계 (ms)
+ */
+static long now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * unlink_tunnel / touch - idle 목록에서 빼기 / 맨 뒤로 옮기기 (데이터가 흘렀음)
+ */
+static void unlink_tunnel(tunnel_t *t) {
+  if (!t->linked)
+    return;
+  if (t->prev)
+    t->prev->next = t->next;
+  else
+    idle_head = t->next;
+  if (t->next)
+    t->next->prev = t->prev;
+  else
+    idle_tail = t->prev;
+  t->linked = 0;
+}
+
+static void touch(tunnel_t *t, long now) {
+  unlink_tunnel(t);
+  t->last = now;
+  t->prev = idle_tail;
+  t->next = NULL;
+  if (idle_tail)
+    idle_tail->next = t;
+  else
+    idle_head = t;
+  idle_tail = t;
+  t->linked = 1;
+}
+
+/*
+ * tunnel_close - 양쪽 소켓 닫고 정리 (닫힌 fd는 epoll에서 자동으로 빠짐)
+ */
+static void tunnel_close(tunnel_t *t) {
+  unlink_tunnel(t);
+  close(t->client.fd);
+  close(t->server.fd);
+  pipe_put(t->up.pipe, t->up.inpipe != 0);
+  pipe_put(t->down.pipe, t->down.inpipe != 0);
+  Free(t);
+  __atomic_add_fetch(&closed, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * pump - 한 방향으로 옮길 수 있는 만큼 옮기기 (EAGAIN이 날 때까지)
+ *   반환: 0 계속, -1 에러 (터널을 닫아야 함)
+ *   moved: 데이터가 조금이라도 흘렀으면 1로 (출력)
+ */
+static int pump(tdir_t *d, int in, int out, int *moved) {
+  ssize_t n;
+
+  while (1) {
+    if (d->inpipe > 0) { // pipe -> 쓰는 쪽
+      if ((n = splice_fd(d->pipe[0], out, d->inpipe)) < 0)
+        return errno == EAGAIN || errno == EINTR ? 0 : -1; // 쓰는 쪽이 차면 EPOLLOUT을 기다림
+      d->inpipe -= n;
+      *moved = 1;
+      continue;
+    }
+    if (d->eof) { // 다 보냈으면 EOF 전달 (half-close)
+      if (!d->shut) {
+        shutdown(out, SHUT_WR);
+        d->shut = 1;
+      }
+      return 0;
+    }
+    if ((n = splice_fd(in, d->pipe[1], TUNNEL_CHUNK)) < 0) // 읽는 쪽 -> pipe
+      return errno == EAGAIN || errno == EINTR ? 0 : -1;
+    if (n == 0)
+      d->eof = 1;
+    else {
+      d->inpipe = n;
+      *moved = 1;
+    }
+  }
+}
+
+/*
+ * add_end - 터널 한쪽 소켓을 non-blocking으로 바꿔서 epoll에 등록
+ */
+static int add_end(tend_t *e) {
+  struct epoll_event ev;
+
+  fcntl(e->fd, F_SETFL, fcntl(e->fd, F_GETFL, 0) | O_NONBLOCK);
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+  ev.data.ptr = e;
+  return epoll_ctl(epfd, EPOLL_CTL_ADD, e->fd, &ev);
+}
+
+/*
+ * adopt - 넘겨받은 터널들을 epoll에 등록 (등록하자마자 쓸 수 있으므로 EPOLLOUT이 옴)
+ */
+static void adopt(long now) {
+  uint64_t cnt;
+  tunnel_t *t, *next;
+
+  if (read(wakefd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN)
+    unix_error("eventfd read error");
+  pthread_mutex_lock(&pending_mutex);
+  t = pending;
+  pending = NULL;
+  pthread_mutex_unlock(&pending_mutex);
+
+  for (; t; t = next) {
+    next = t->next;
+    if (add_end(&t->client) < 0 || add_end(&t->server) < 0) {
+      tunnel_close(t);
+      continue;
+    }
+    touch(t, now);
+  }
+}
+
+/*
+ * tunnel_loop - 터널 스레드: 준비된 소켓이 있는 터널을 양방향으로 펌프
+ */
+static void *tunnel_loop(void *vargp) {
+  struct epoll_event events[MAXEVENTS];
+  tunnel_t *t;
+  long now, left;
+  int i, j, n, moved;
+
+  Pthread_detach(pthread_self());
+  while (1) {
+    left = idle_head ? idle_head->last + TUNNEL_IDLE_MS - now_ms() : -1;
+    n = epoll_wait(epfd, events, MAXEVENTS, idle_head ? (left > 0 ? (int)left : 0) : -1);
+    if (n < 0 && errno != EINTR)
+      unix_error("epoll_wait error");
+    now = now_ms();
+    for (i = 0; i < n; i++) {
+      if (events[i].data.ptr == NULL) // 같은 묶음에서 이미 닫은 터널 (아래 참고)
+        continue;
+      if (events[i].data.ptr == &wake_end) {
+        adopt(now);
+        continue;
+      }
+      t = ((tend_t *)events[i].data.ptr)->t;
+      moved = 0;
+      if (pump(&t->up, t->client.fd, t->server.fd, &moved) < 0 ||
+          pump(&t->down, t->server.fd, t->client.fd, &moved) < 0 ||
+          (t->up.shut && t->down.shut)) {
+        // 같은 묶음에 이 터널의 다른 쪽 이벤트가 남아있을 수 있으므로 지워두고 정리
+        for (j = i + 1; j < n; j++)
+          if (events[j].data.ptr == &t->client || events[j].data.ptr == &t->server)
+            events[j].data.ptr = NULL;
+        tunnel_close(t);
+        continue;
+      }
+      if (moved)
+        touch(t, now);
+    }
+    while ((t = idle_head) != NULL && now - t->last >= TUNNEL_IDLE_MS) { // idle timeout
+      __atomic_add_fetch(&timeouts, 1, __ATOMIC_RELAXED);
+      tunnel_close(t);
+    }
+  }
+  return NULL;
+}
+
+/*
+ * tunnel_init - epoll 인스턴스, eventfd, 터널 스레드 만들기 (프로세스마다 한 번)
+ */
+static void tunnel_init(void) {
+  struct epoll_event ev;
+  pthread_t tid;
+
+  if ((epfd = epoll_create1(0)) < 0)
+    unix_error("epoll_create1 error");
+  if ((wakefd = eventfd(0, EFD_NONBLOCK)) < 0)
+    unix_error("eventfd error");
+  ev.events = EPOLLIN;
+  ev.data.ptr = &wake_end;
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev) < 0)
+    unix_error("epoll_ctl error");
+  Pthread_create(&tid, NULL, tunnel_loop, NULL);
+}
+
+/*
+ * tunnel_start - 연결이 끝난 터널을 터널 스레드에 넘기기 (이제 두 소켓은 터널 스레드 것)
+ *   반환: 성공 0, pipe를 못 얻으면 -1 (소켓은 호출한 쪽 것 그대로)
+ */
+int tunnel_start(int clientfd, int serverfd) {
+  uint64_t one = 1;
+  tunnel_t *t;
+
+  pthread_once(&once, tunnel_init);
+  t = Calloc(1, sizeof(tunnel_t));
+  t->client.fd = clientfd;
+  t->client.t = t;
+  t->server.fd = serverfd;
+  t->server.t = t;
+  if (pipe_get(t->up.pipe) < 0) {
+    Free(t);
+    return -1;
+  }
+  if (pipe_get(t->down.pipe) < 0) {
+    pipe_put(t->up.pipe, 0);
+    Free(t);
+    return -1;
+  }
+  __atomic_add_fetch(&opened, 1, __ATOMIC_RELAXED);
+
+  pthread_mutex_lock(&pending_mutex);
+  t->next = pending;
+  pending = t;
+  pthread_mutex_unlock(&pending_mutex);
+  if (write(wakefd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    unix_error("eventfd write error");
+  return 0;
+}
+
+/*
+ * tunnel_stats - 터널 카운터 출력 (열린 수, 닫은 수, idle timeout)
+ */
+void tunnel_stats(void) {
+  unsigned long o = __atomic_load_n(&opened, __ATOMIC_RELAXED);
+  unsigned long c = __atomic_load_n(&closed, __ATOMIC_RELAXED);
+
+  printf("tunnels: %lu open, %lu closed, %lu idle timeouts\n", o - c, c,
+         __atomic_load_n(&timeouts, __ATOMIC_RELAXED));
+}
@@ -0,0 +1,165 @@
+/*
+ * upstream.c - 원서버 keep-alive 연결 풀
+ *
+ * 캐시 미스마다 getaddrinfo + socket + connect를 새로 하고 응답 하나 뒤에
+ * 닫으면, 자주 가는 원서버에도 매번 왕복(handshake) 한 번이 더 든다.
+ * 응답을 끝까지 받았고 원서버도 연결을 유지하겠다고 한 소켓은 닫지 않고
+ * host:port 별로 여기 모아뒀다가 다음 요청에 재사용한다.
+ *
+ *   - 꺼낼 때 recv(MSG_PEEK | MSG_DONTWAIT)로 살아있는지 확인 (원서버가 닫았으면
+ *     EOF, 요청도 안 했는데 데이터가 와 있으면 이상한 연결이므로 버림)
+ *   - 원서버 하나당 UPSTREAM_PER_ORIGIN개, 전체 UPSTREAM_MAX개까지만 보관
+ *   - UPSTREAM_IDLE_MS보다 오래 논 연결은 UPSTREAM_REAP_MS마다 정리 (reaper)
+ *
+ * 풀은 프로세스마다 따로다 (소켓은 공유 메모리에 넣을 수 없으므로 prefork
+ * 자식들은 각자 자기 풀을 가짐). 잠금은 pipe 풀처럼 mutex 하나.
+ */
+#include "proxy.h"
+#include <time.h>
+
+#define UPSTREAM_MAX 256        // 풀에 보관할 최대 연결 수
+#define UPSTREAM_PER_ORIGIN 8   // 원서버 하나당 보관할 최대 연결 수
+#define UPSTREAM_IDLE_MS 15000  // 이보다 오래 논 연결은 닫음
+#define UPSTREAM_REAP_MS 1000   // 오래된 연결을 정리하는 최소 간격
+
+/* 놀고 있는 원서버 연결 하나 */
+typedef struct {
+  int fd;             // 원서버 소켓 (-1이면 빈 칸)
+  unsigned int hash;  // key 해시 (비교 전에 빠르게 거르기)
+  char *key;          // "host:port"
+  long since;         // 풀에 들어온 시각 (ms)
+} idle_conn_t;
+
+static idle_conn_t idle[UPSTREAM_MAX];
+static int nidle;       // idle에 든 연결 수
+static long last_reap;  // 마지막으로 정리한 시각
+static unsigned long reused, reaped; // 재사용한 / 정리한 연결 수
+static pthread_mutex_t upstream_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * now_ms - 단조 시계 (ms)
+ */
+static long now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * make_key - "host:port" 키와 해시 만들기 (key는 MAXLINE 크기)
+ */
+static unsigned int make_key(char *key, char *host, char *port) {
+  unsigned int h = 2166136261u;
+  char *p;
+
+  snprintf(key, MAXLINE, "%s:%s", host, port);
+  for (p = key; *p; p++)
+    h = (h ^ (unsigned char)*p) * 16777619u;
+  return h;
+}
+
+/*
+ * drop - i번 칸 비우기 (잠근 상태에서, 소켓은 호출한 쪽이 처리)
+ */
+static void drop(int i) {
+  Free(idle[i].key);
+  idle[i].key = NULL;
+  idle[i].fd = -1;
+  nidle--;
+}
+
+/*
+ * reap - UPSTREAM_IDLE_MS보다 오래 논 연결 닫기 (잠근 상태에서, 너무 자주는 안 함)
+ */
+static void reap(long now) {
+  int i;
+
+  if (now - last_reap < UPSTREAM_REAP_MS)
+    return;
+  last_reap = now;
+  for (i = 0; i < UPSTREAM_MAX && nidle > 0; i++)
+    if (idle[i].key && now - idle[i].since > UPSTREAM_IDLE_MS) {
+      close(idle[i].fd);
+      drop(i);
+      reaped++;
+    }
+}
+
+/*
+ * alive - 놀던 연결이 아직 쓸 만한지 (원서버가 닫지 않았고 남은 데이터도 없음)
+ */
+static int alive(int fd) {
+  char c;
+  ssize_t n = recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+
+  return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/*
+ * upstream_get - host:port로 가는 놀던 연결 하나 꺼내기 (죽은 연결은 닫고 다음 것 확인)
+ *   반환: 소켓, 없으면 -1
+ */
+int upstream_get(char *host, char *port) {
+  char key[MAXLINE];
+  unsigned int h = make_key(key, host, port);
+  int i, fd;
+
+  pthread_mutex_lock(&upstream_mutex);
+  reap(now_ms());
+  for (i = 0; i < UPSTREAM_MAX && nidle > 0; i++) {
+    if (idle[i].key == NULL || idle[i].hash != h || strcmp(idle[i].key, key))
+      continue;
+    fd = idle[i].fd;
+    drop(i);
+    if (alive(fd)) {
+      reused++;
+      pthread_mutex_unlock(&upstream_mutex);
+      return fd;
+    }
+    close(fd); // 원서버가 그새 닫음: 다음 것 확인
+  }
+  pthread_mutex_unlock(&upstream_mutex);
+  return -1;
+}
+
+/*
+ * upstream_put - 응답이 끝난 원서버 연결을 풀에 돌려주기 (원서버별/전체 한도를 넘으면 닫음)
+ */
+void upstream_put(char *host, char *port, int fd) {
+  char key[MAXLINE];
+  unsigned int h = make_key(key, host, port);
+  int i, slot = -1, same = 0;
+
+  pthread_mutex_lock(&upstream_mutex);
+  reap(now_ms());
+  for (i = 0; i < UPSTREAM_MAX; i++) {
+    if (idle[i].key == NULL) {
+      if (slot < 0)
+        slot = i;
+    }
+    else if (idle[i].hash == h && !strcmp(idle[i].key, key))
+      same++;
+  }
+  if (slot < 0 || same >= UPSTREAM_PER_ORIGIN) {
+    pthread_mutex_unlock(&upstream_mutex);
+    close(fd);
+    return;
+  }
+  idle[slot].fd = fd;
+  idle[slot].hash = h;
+  idle[slot].key = Malloc(strlen(key) + 1);
+  strcpy(idle[slot].key, key);
+  idle[slot].since = now_ms();
+  nidle++;
+  pthread_mutex_unlock(&upstream_mutex);
+}
+
+/*
+ * upstream_stats - 풀 상태 출력 (놀던 연결 수, 재사용/정리한 수)
+ */
+void upstream_stats(void) {
+  pthread_mutex_lock(&upstream_mutex);
+  printf("upstream: %d idle, %lu reused, %lu reaped\n", nidle, reused, reaped);
+  pthread_mutex_unlock(&upstream_mutex);
+}
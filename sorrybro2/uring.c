@@ -0,0 +1,616 @@
+/*
+ * uring.c - io_uring 기반 단일 스레드 엔진 (-m uring)
+ *
+ * epoll 루프는 "준비됐다"는 알림을 받은 뒤 read/write를 직접 부르므로
+ * 연결마다, 줄마다 syscall이 생긴다. 여기서는 accept, connect, recv, send를
+ * 전부 제출 큐(SQ)에 쌓아두고, 루프 한 바퀴에 io_uring_enter 한 번으로
+ * "쌓인 것 제출 + 완료 기다리기"를 같이 한다.
+ *
+ *   - multishot accept: accept SQE 하나로 연결이 올 때마다 CQE가 계속 나옴
+ *   - provided buffer ring: recv가 버퍼를 미리 지정하지 않고 커널이 공용
+ *     버퍼 풀에서 골라 씀 -> 연결마다 응답 버퍼를 들고 있지 않아도 됨
+ *   - linked SQE: connect -> 요청 send -> 응답 recv, 응답 send -> 다음 recv를
+ *     IOSQE_IO_LINK로 묶어서 한 번에 제출 (앞이 실패하면 뒤는 -ECANCELED)
+ *
+ * GET 응답은 받은 조각을 MAX_OBJECT_SIZE까지 복사해 두었다가(tee) 원서버가 닫을 때
+ * 온전한 200이면 공유 캐시에 넣고, 다음 같은 요청은 connect 없이 응답한다. 적중한 객체는
+ * 고정(pin)해 두고, 고친 헤더와 캐시 chunk들을 가리키는 iovec으로 sendmsg 하나를 건다.
+ *
+ * liburing 없이 <linux/io_uring.h>와 syscall만으로 작성했다.
+ * 커널이 io_uring이나 위 기능을 지원하지 않으면 uring_loop가 -1을 반환하고
+ * 호출한 쪽(main)이 epoll 이벤트 루프로 대신 돈다.
+ */
+#include "proxy.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define RING_ENTRIES 256  // 제출 큐 크기 (완료 큐는 그 4배)
+#define NBUFS 256         // provided buffer 개수 (2의 거듭제곱)
+#define UBUFSIZE MAXBUF   // provided buffer 하나의 크기
+#define BGID 0            // buffer group 번호
+
+/* user_data 아래 3비트에 어떤 요청인지 표시 (uconn_t는 8바이트 이상 정렬) */
+enum {
+  OP_ACCEPT = 1, // multishot accept
+  OP_RECV_REQ,   // 클라이언트 요청 헤더 recv
+  OP_CONNECT,    // 원서버 connect
+  OP_SEND_REQ,   // 원서버로 요청 send
+  OP_RECV_RESP,  // 원서버 응답 recv
+  OP_SEND_RESP,  // 클라이언트로 응답 send
+  OP_SEND_CACHED // 클라이언트로 캐시 응답 sendmsg (끝나면 닫음)
+};
+#define OP_MASK 7
+
+/* 연결 하나 (응답 중계 버퍼는 공용 buffer ring에서 빌려 씀) */
+typedef struct uconn {
+  int clientfd;              // 클라이언트 소켓
+  int serverfd;              // 원서버 소켓 (-1이면 아직 없음)
+  int inflight;              // 커널에 걸려 있는 SQE 수 (0이 돼야 해제 가능)
+  int closing;               // 닫는 중이면 1
+  int bid;                   // 클라이언트로 보내는 중인 buffer 번호 (-1이면 없음)
+  int starved;               // 버퍼가 없어서(-ENOBUFS) 다시 걸어야 하는 recv op (0이면 없음)
+  struct uconn *next_starved;
+  struct addrinfo *ailist;   // getaddrinfo 결과
+  struct addrinfo *ai;       // 지금 connect 시도 중인 주소
+  size_t len;                // buf에 들어있는 바이트 수
+  http_parser_t hp;          // 요청 헤더 파서 (받은 조각마다 이어서 파싱)
+  char *key;                 // 캐시 키 (arena 안, 캐시할 수 없는 요청이면 NULL)
+  char *obj;                 // 캐시에 넣으려고 모으는 응답, 적중이면 iovec 배열 + 고친 헤더
+  size_t objlen;             // obj에 들어있는 바이트 수
+  cobj_t *hit;               // 캐시에서 고정한 응답 (sendmsg가 끝나서 해제할 때 놓음)
+  struct msghdr msg;         // 캐시 응답 sendmsg
+  arena_t arena;             // 파싱한 헤더 배열 (연결을 닫을 때 한꺼번에 해제)
+  char buf[MAXBUF];          // 요청 헤더 모으기 -> 원서버로 보낼 요청
+  char arena_buf[REQUEST_ARENA]; // arena의 처음 블록
+} uconn_t;
+
+/* mmap한 SQ/CQ 링 */
+static struct {
+  int fd;
+  unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+  unsigned sq_entries;
+  unsigned sq_local_tail;     // 채워 놓았지만 아직 커널에 알리지 않은 tail
+  struct io_uring_sqe *sqes;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_cqe *cqes;
+  void *sq_ptr, *cq_ptr;
+  size_t sq_sz, cq_sz, sqes_sz;
+} ring;
+
+static struct io_uring_buf_ring *br; // provided buffer ring (커널과 공유)
+static unsigned short br_tail;       // 우리가 채운 buffer ring tail
+static int nfree;                    // 커널이 쓸 수 있는 buffer 수
+static char *bufpool;                // NBUFS * UBUFSIZE 버퍼 본체
+static uconn_t *starved_list;        // 버퍼가 돌아오면 recv를 다시 걸 연결들
+static unsigned long nconns;         // 지금 살아있는 연결 수 (accept 지원 확인용)
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+  return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                              unsigned flags) {
+  return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr) {
+  return syscall(__NR_io_uring_register, fd, opcode, arg, nr);
+}
+
+/*
+ * ring_teardown - 링과 버퍼 해제 (지원 안 될 때 epoll로 넘어가기 전에 호출)
+ */
+static void ring_teardown(void) {
+  if (ring.sqes)
+    munmap(ring.sqes, ring.sqes_sz);
+  if (ring.cq_ptr && ring.cq_ptr != ring.sq_ptr)
+    munmap(ring.cq_ptr, ring.cq_sz);
+  if (ring.sq_ptr)
+    munmap(ring.sq_ptr, ring.sq_sz);
+  if (br)
+    munmap(br, NBUFS * sizeof(struct io_uring_buf));
+  if (ring.fd > 0)
+    close(ring.fd); // 등록된 buffer ring도 같이 정리됨
+  Free(bufpool);
+  memset(&ring, 0, sizeof(ring));
+  br = NULL;
+  bufpool = NULL;
+}
+
+/*
+ * ring_probe - 필요한 opcode를 커널이 지원하는지 확인
+ */
+static int ring_probe(void) {
+  static const int need[] = { IORING_OP_ACCEPT, IORING_OP_CONNECT,
+                              IORING_OP_SEND, IORING_OP_RECV, IORING_OP_SENDMSG };
+  struct io_uring_probe *probe;
+  size_t sz = sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op);
+  int i, ok = 1;
+
+  probe = Calloc(1, sz);
+  if (sys_io_uring_register(ring.fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+    ok = 0;
+  for (i = 0; ok && i < (int)(sizeof(need) / sizeof(need[0])); i++)
+    if (need[i] > probe->last_op || !(probe->ops[need[i]].flags & IO_URING_OP_SUPPORTED))
+      ok = 0;
+  Free(probe);
+  return ok;
+}
+
+/*
+ * ring_setup - io_uring 만들고 SQ/CQ/SQE 배열 mmap, buffer ring 등록
+ *   반환: 성공 0, 지원 안 되면 -1
+ */
+static int ring_setup(void) {
+  struct io_uring_params p;
+  struct io_uring_buf_reg reg;
+  int i;
+
+  memset(&p, 0, sizeof(p));
+  p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+  p.cq_entries = RING_ENTRIES * 4; // 완료가 몰려도 넘치지 않도록 넉넉히
+  if ((ring.fd = sys_io_uring_setup(RING_ENTRIES, &p)) < 0) {
+    memset(&p, 0, sizeof(p)); // 옛날 커널: 최적화 플래그 없이 다시 시도
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = RING_ENTRIES * 4;
+    if ((ring.fd = sys_io_uring_setup(RING_ENTRIES, &p)) < 0)
+      return -1;
+  }
+
+  // SQ 링, CQ 링 (IORING_FEAT_SINGLE_MMAP이면 하나의 mmap에 같이 있음)
+  ring.sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  ring.cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (ring.cq_sz > ring.sq_sz)
+      ring.sq_sz = ring.cq_sz;
+    ring.cq_sz = ring.sq_sz;
+  }
+  ring.sq_ptr = mmap(NULL, ring.sq_sz, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+  if (ring.sq_ptr == MAP_FAILED)
+    goto fail;
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    ring.cq_ptr = ring.sq_ptr;
+  else {
+    ring.cq_ptr = mmap(NULL, ring.cq_sz, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+    if (ring.cq_ptr == MAP_FAILED)
+      goto fail;
+  }
+  ring.sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+  ring.sqes = mmap(NULL, ring.sqes_sz, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+  if (ring.sqes == MAP_FAILED) {
+    ring.sqes = NULL;
+    goto fail;
+  }
+  ring.sq_head = (unsigned *)((char *)ring.sq_ptr + p.sq_off.head);
+  ring.sq_tail = (unsigned *)((char *)ring.sq_ptr + p.sq_off.tail);
+  ring.sq_mask = (unsigned *)((char *)ring.sq_ptr + p.sq_off.ring_mask);
+  ring.sq_array = (unsigned *)((char *)ring.sq_ptr + p.sq_off.array);
+  ring.sq_entries = p.sq_entries;
+  ring.sq_local_tail = *ring.sq_tail;
+  ring.cq_head = (unsigned *)((char *)ring.cq_ptr + p.cq_off.head);
+  ring.cq_tail = (unsigned *)((char *)ring.cq_ptr + p.cq_off.tail);
+  ring.cq_mask = (unsigned *)((char *)ring.cq_ptr + p.cq_off.ring_mask);
+  ring.cqes = (struct io_uring_cqe *)((char *)ring.cq_ptr + p.cq_off.cqes);
+
+  if (!ring_probe())
+    goto fail;
+
+  // provided buffer ring: 링 메모리는 페이지 정렬이어야 해서 mmap으로 할당
+  br = mmap(NULL, NBUFS * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (br == MAP_FAILED) {
+    br = NULL;
+    goto fail;
+  }
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (unsigned long)br;
+  reg.ring_entries = NBUFS;
+  reg.bgid = BGID;
+  if (sys_io_uring_register(ring.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    goto fail;
+
+  bufpool = Malloc((size_t)NBUFS * UBUFSIZE);
+  br_tail = 0;
+  for (i = 0; i < NBUFS; i++) { // 처음엔 모든 버퍼를 커널에 빌려줌
+    struct io_uring_buf *b = &br->bufs[br_tail++ & (NBUFS - 1)];
+    b->addr = (unsigned long)(bufpool + (size_t)i * UBUFSIZE);
+    b->len = UBUFSIZE;
+    b->bid = i;
+  }
+  __atomic_store_n(&br->tail, br_tail, __ATOMIC_RELEASE);
+  nfree = NBUFS;
+  return 0;
+
+fail:
+  ring_teardown();
+  return -1;
+}
+
+/*
+ * buf_recycle - 다 쓴 buffer를 buffer ring에 돌려주기
+ */
+static void buf_recycle(int bid) {
+  struct io_uring_buf *b = &br->bufs[br_tail & (NBUFS - 1)];
+  b->addr = (unsigned long)(bufpool + (size_t)bid * UBUFSIZE);
+  b->len = UBUFSIZE;
+  b->bid = bid;
+  br_tail++;
+  nfree++;
+  __atomic_store_n(&br->tail, br_tail, __ATOMIC_RELEASE);
+}
+
+/*
+ * ring_submit - 쌓인 SQE를 커널에 알리고 wait개 이상 완료될 때까지 대기
+ */
+static int ring_submit(unsigned wait) {
+  unsigned to_submit;
+  int rc;
+
+  __atomic_store_n(ring.sq_tail, ring.sq_local_tail, __ATOMIC_RELEASE);
+  to_submit = ring.sq_local_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+  do {
+    rc = sys_io_uring_enter(ring.fd, to_submit, wait, wait ? IORING_ENTER_GETEVENTS : 0);
+  } while (rc < 0 && errno == EINTR);
+  return rc;
+}
+
+/*
+ * get_sqe - 빈 SQE 하나 얻기 (SQ가 가득 차 있으면 먼저 제출)
+ */
+static struct io_uring_sqe *get_sqe(uconn_t *c, int op) {
+  struct io_uring_sqe *sqe;
+  unsigned idx;
+
+  while (ring.sq_local_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE)
+         >= ring.sq_entries)
+    if (ring_submit(0) < 0 && errno != EAGAIN && errno != EBUSY)
+      unix_error("io_uring_enter error");
+  idx = ring.sq_local_tail & *ring.sq_mask;
+  sqe = &ring.sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  ring.sq_array[idx] = idx;
+  ring.sq_local_tail++;
+  sqe->user_data = (uint64_t)(uintptr_t)c | op;
+  if (c)
+    c->inflight++;
+  return sqe;
+}
+
+static void prep_recv(uconn_t *c, int fd, int op, unsigned flags) {
+  struct io_uring_sqe *sqe = get_sqe(c, op);
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->len = UBUFSIZE;
+  sqe->flags = IOSQE_BUFFER_SELECT | flags; // 커널이 buffer ring에서 골라 씀
+  sqe->buf_group = BGID;
+}
+
+static void prep_send(uconn_t *c, int fd, void *buf, size_t len, int op, unsigned flags) {
+  struct io_uring_sqe *sqe = get_sqe(c, op);
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = fd;
+  sqe->addr = (unsigned long)buf;
+  sqe->len = len;
+  sqe->msg_flags = MSG_WAITALL; // 짧게 보내고 끝나지 않도록 (링크 체인이 끊기지 않게)
+  sqe->flags = flags;
+}
+
+static void prep_sendmsg(uconn_t *c, int fd, struct msghdr *msg, int op) {
+  struct io_uring_sqe *sqe = get_sqe(c, op);
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = fd;
+  sqe->addr = (unsigned long)msg;
+  sqe->len = 1;
+  sqe->msg_flags = MSG_WAITALL;
+}
+
+static void arm_accept(int listenfd) {
+  struct io_uring_sqe *sqe = get_sqe(NULL, OP_ACCEPT);
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = listenfd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT; // 한 번 걸어두면 연결마다 CQE
+}
+
+/*
+ * conn_close - 소켓을 닫고, 걸려있는 SQE가 다 끝나면 해제
+ */
+static void conn_close(uconn_t *c) {
+  if (!c->closing) {
+    c->closing = 1;
+    close(c->clientfd);
+    if (c->serverfd >= 0)
+      close(c->serverfd);
+    if (c->ailist)
+      freeaddrinfo(c->ailist);
+    c->ailist = NULL;
+    arena_reset(&c->arena);
+    nconns--;
+  }
+  if (c->inflight == 0 && !c->starved) {
+    if (c->obj) // 캐시 응답의 iovec과 고정은 sendmsg가 끝난 뒤에 해제
+      Free(c->obj);
+    if (c->hit)
+      cache_unpin(c->hit);
+    Free(c);
+  }
+}
+
+static void conn_error(uconn_t *c, char *errnum, char *shortmsg, char *longmsg) {
+  clienterror(c->clientfd, errnum, shortmsg, longmsg);
+  conn_close(c);
+}
+
+/*
+ * start_connect - c->ai 주소로 connect -> 요청 send -> 응답 recv를 링크로 묶어 제출
+ */
+static void start_connect(uconn_t *c) {
+  struct io_uring_sqe *sqe;
+
+  for (; c->ai; c->ai = c->ai->ai_next)
+    if ((c->serverfd = socket(c->ai->ai_family, c->ai->ai_socktype,
+                              c->ai->ai_protocol)) >= 0)
+      break;
+  if (!c->ai) {
+    printf("Error connecting to server\n");
+    conn_error(c, "502", "Bad Gateway", "Proxy could not connect to the server");
+    return;
+  }
+  sqe = get_sqe(c, OP_CONNECT);
+  sqe->opcode = IORING_OP_CONNECT;
+  sqe->fd = c->serverfd;
+  sqe->addr = (unsigned long)c->ai->ai_addr;
+  sqe->off = c->ai->ai_addrlen;
+  sqe->flags = IOSQE_IO_LINK;
+  prep_send(c, c->serverfd, c->buf, c->len, OP_SEND_REQ, IOSQE_IO_LINK);
+  prep_recv(c, c->serverfd, OP_RECV_RESP, 0);
+}
+
+/*
+ * tee - 받은 응답 조각을 캐시에 넣으려고 obj에 모으기 (MAX_OBJECT_SIZE를 넘으면 포기)
+ */
+static void tee(uconn_t *c, char *p, size_t n) {
+  if (c->objlen + n > MAX_OBJECT_SIZE) {
+    Free(c->obj);
+    c->obj = NULL;
+    return;
+  }
+  memcpy(c->obj + c->objlen, p, n);
+  c->objlen += n;
+}
+
+/*
+ * send_hit - 캐시에 있으면 고정하고 헤더 + 캐시 chunk을 sendmsg 하나로 제출 (반환: 적중이면 1)
+ *   iovec과 헤더는 sendmsg가 끝날 때까지 있어야 하므로 obj에 Malloc (arena는 닫을 때 바로 비워짐)
+ */
+static int send_hit(uconn_t *c) {
+  struct iovec *iov;
+  size_t size, body;
+  char *head;
+  int n;
+
+  if ((c->hit = cache_pin(c->key, &size)) == NULL)
+    return 0;
+  c->obj = Malloc(sizeof(struct iovec) * (1 + CACHE_MAX_IOV) + MAXBUF + MAXLINE);
+  iov = (struct iovec *)c->obj;
+  head = c->obj + sizeof(struct iovec) * (1 + CACHE_MAX_IOV);
+  if ((n = cached_head(c->hit, size, 0, head, &body)) < 0) {
+    Free(c->obj);
+    c->obj = NULL;
+    cache_unpin(c->hit);
+    c->hit = NULL;
+    return 0;
+  }
+  printf("Cache hit: %s\n", c->key);
+  iov[0].iov_base = head;
+  iov[0].iov_len = n;
+  c->msg.msg_iov = iov;
+  c->msg.msg_iovlen = 1 + cache_iov(c->hit, body, iov + 1, CACHE_MAX_IOV);
+  prep_sendmsg(c, c->clientfd, &c->msg, OP_SEND_CACHED);
+  return 1;
+}
+
+/*
+ * start_request - 모인 요청 헤더로 원서버 요청을 만들고 connect 체인 제출 (캐시에 있으면 바로 응답)
+ */
+static void start_request(uconn_t *c) {
+  char host[MAX_HOST], port[MAX_PORT];
+  int n;
+
+  // 캐시 키는 요청을 덮어쓰기 전에 (prepare_request가 GET이 아니면 거름)
+  if (request_cacheable(&c->hp))
+    c->key = http_cache_key(&c->hp);
+  n = prepare_request(&c->hp, c->buf, sizeof(c->buf), host, port);
+  if (n == PREP_CLOSE) {
+    conn_close(c);
+    return;
+  }
+  if (n == PREP_BAD) {
+    conn_error(c, "400", "Bad Request", "Proxy could not parse the request");
+    return;
+  }
+  if (c->key && send_hit(c))
+    return;
+  c->len = n;
+  if (c->key) // 응답을 캐시에 넣을 수 있게 모으기
+    c->obj = Malloc(MAX_OBJECT_SIZE);
+  if (resolve_server(host, port, &c->ailist) < 0) { // 블록됨 (event.c와 같은 한계)
+    c->ailist = NULL;
+    conn_error(c, "502", "Bad Gateway", "Proxy could not resolve the server");
+    return;
+  }
+  c->ai = c->ailist;
+  start_connect(c);
+}
+
+/*
+ * handle_cqe - 완료 하나 처리
+ */
+static void handle_cqe(struct io_uring_cqe *cqe, int listenfd) {
+  uconn_t *c = (uconn_t *)(uintptr_t)(cqe->user_data & ~(uint64_t)OP_MASK);
+  int op = cqe->user_data & OP_MASK;
+  int res = cqe->res;
+  int bid = (cqe->flags & IORING_CQE_F_BUFFER) ? cqe->flags >> IORING_CQE_BUFFER_SHIFT : -1;
+
+  if (bid >= 0) // 커널이 buffer 하나를 골라 썼음
+    nfree--;
+
+  if (op == OP_ACCEPT) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) // multishot이 끝났으면 다시 걸기
+      arm_accept(listenfd);
+    if (res < 0) {
+      fprintf(stderr, "accept error: %s\n", strerror(-res));
+      return;
+    }
+    c = Malloc(sizeof(uconn_t));
+    memset(c, 0, offsetof(uconn_t, buf));
+    c->clientfd = res;
+    c->serverfd = -1;
+    c->bid = -1;
+    arena_init(&c->arena, c->arena_buf, sizeof(c->arena_buf));
+    http_parser_init(&c->hp, &c->arena);
+    nconns++;
+    prep_recv(c, c->clientfd, OP_RECV_REQ, 0);
+    return;
+  }
+
+  c->inflight--;
+  if (c->closing) { // 닫힌 뒤에 도착한 완료 (링크가 취소된 것 등)
+    if (bid >= 0)
+      buf_recycle(bid);
+    conn_close(c);
+    return;
+  }
+  if (res == -ENOBUFS && (op == OP_RECV_REQ || op == OP_RECV_RESP)) {
+    c->starved = op; // 버퍼가 돌아오면 다시 걸기
+    c->next_starved = starved_list;
+    starved_list = c;
+    return;
+  }
+
+  switch (op) {
+  case OP_RECV_REQ: // 요청 헤더 조각 도착
+    if (res <= 0) {
+      conn_close(c);
+      return;
+    }
+    if (c->len + res > sizeof(c->buf) - 1) { // 헤더가 버퍼보다 큼
+      buf_recycle(bid);
+      conn_error(c, "431", "Request Header Fields Too Large", "Request headers too large");
+      return;
+    }
+    memcpy(c->buf + c->len, bufpool + (size_t)bid * UBUFSIZE, res);
+    buf_recycle(bid);
+    c->len += res;
+    res = http_parse(&c->hp, c->buf, c->len); // 새로 받은 부분만 이어서 파싱
+    if (res > 0)
+      start_request(c);
+    else if (res == HTTP_PARSE_BAD)
+      conn_error(c, "400", "Bad Request", "Proxy could not parse the request");
+    else if (res == HTTP_PARSE_LARGE)
+      conn_error(c, "431", "Request Header Fields Too Large", "Request headers too large");
+    else
+      prep_recv(c, c->clientfd, OP_RECV_REQ, 0);
+    return;
+
+  case OP_CONNECT:
+    if (res == 0) {
+      freeaddrinfo(c->ailist);
+      c->ailist = c->ai = NULL;
+      return; // 링크된 send가 이어서 실행됨
+    }
+    // 이 주소는 실패 -> 링크된 send/recv는 -ECANCELED로 돌아옴, 다음 주소로
+    close(c->serverfd);
+    c->serverfd = -1;
+    c->ai = c->ai->ai_next;
+    start_connect(c);
+    return;
+
+  case OP_SEND_REQ:
+    if (res == -ECANCELED)
+      return; // connect 실패로 취소됨 (다른 주소로 이미 재시도 중)
+    if (res < 0)
+      conn_close(c);
+    else
+      printf("Request forwarded to server\n");
+    return;
+
+  case OP_RECV_RESP: // 응답 조각 도착 -> 클라이언트로 send, 그 다음 recv를 링크로
+    if (res == -ECANCELED)
+      return;
+    if (res <= 0) {
+      if (res == 0) {
+        printf("Response forwarded to client\n");
+        if (c->obj && response_cacheable(c->obj, c->objlen)) // 끝까지 받은 200만
+          cache_put(c->key, c->obj, c->objlen);
+      }
+      conn_close(c);
+      return;
+    }
+    if (c->obj)
+      tee(c, bufpool + (size_t)bid * UBUFSIZE, res);
+    c->bid = bid;
+    prep_send(c, c->clientfd, bufpool + (size_t)bid * UBUFSIZE, res,
+              OP_SEND_RESP, IOSQE_IO_LINK);
+    prep_recv(c, c->serverfd, OP_RECV_RESP, 0);
+    return;
+
+  case OP_SEND_RESP:
+    buf_recycle(c->bid); // 보냈으니 버퍼 반납
+    c->bid = -1;
+    if (res < 0) // 클라이언트가 끊음 -> 링크된 recv는 취소됨
+      conn_close(c);
+    return;
+
+  case OP_SEND_CACHED: // 캐시 응답을 다 보냄 (MSG_WAITALL), HTTP/1.0 close와 같게 닫음
+    conn_close(c);
+    return;
+  }
+}
+
+/*
+ * uring_loop - io_uring 엔진 본체
+ *   반환: io_uring을 쓸 수 없으면 -1 (호출한 쪽이 epoll로 대신 처리), 그 외엔 반환하지 않음
+ */
+int uring_loop(int listenfd) {
+  unsigned head, tail;
+  uconn_t *c;
+  int first = 1;
+
+  if (ring_setup() < 0)
+    return -1;
+  printf("io_uring: %zu bytes per connection + %d shared %d-byte buffers\n",
+         sizeof(uconn_t), NBUFS, UBUFSIZE);
+  arm_accept(listenfd);
+
+  while (1) {
+    if (ring_submit(1) < 0 && errno != EBUSY && errno != EAGAIN)
+      unix_error("io_uring_enter error");
+
+    head = *ring.cq_head;
+    tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+      struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+      // 첫 accept가 EINVAL이면 multishot accept를 지원하지 않는 커널 -> epoll로
+      if (first && (cqe->user_data & OP_MASK) == OP_ACCEPT && cqe->res == -EINVAL &&
+          nconns == 0) {
+        ring_teardown();
+        return -1;
+      }
+      first = 0;
+      handle_cqe(cqe, listenfd);
+    }
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+    while (starved_list && nfree > 0) { // 버퍼가 돌아왔으면 멈췄던 recv 다시 걸기
+      c = starved_list;
+      starved_list = c->next_starved;
+      prep_recv(c, c->starved == OP_RECV_REQ ? c->clientfd : c->serverfd, c->starved, 0);
+      c->starved = 0;
+    }
+  }
+}